@@ -1,12 +1,21 @@
 
 /*
- * ESP-01 Node Firmware for Greenhouse Automation System
- * 
+ * ESP-01 Node Firmware for Greenhouse Automation System - Complete Version
+ *
  * This firmware runs on ESP-01 modules, one in each greenhouse, to:
  * - Read temperature, humidity and pressure from BME280 sensor
  * - Control vent motor via dual-channel relay (open/close)
  * - Communicate with central ESP32 hub via ESP-NOW
  * - Apply local control logic when operating autonomously
+ *
+ * The node logic lives in the GreenhouseNodeCore library, shared with the
+ * ESP32 node; this sketch supplies the board traits and the ESP8266 ESP-NOW glue.
+ *
+ * Hardware Connections:
+ * - GPIO0: SDA for BME280 + Relay Open (via level shifter)
+ * - GPIO2: SCL for BME280 + Relay Close (via level shifter)
+ * - VCC: 3.3V from AMS1117 regulator
+ * - GND: Common ground
  */
 
 #include <ESP8266WiFi.h>
@@ -14,296 +23,165 @@
 #include <Wire.h>
 #include <Adafruit_Sensor.h>
 #include <Adafruit_BME280.h>
+#include <EEPROM.h>
+
+// Serial logging, see greenhouse_log.h; LOG_LEVEL_WARN or LOG_LEVEL_NONE in production
+#define LOG_MAX_LEVEL LOG_LEVEL_INFO
+
+#include <greenhouse_protocol.h>
+#include <node_core.h>
+
+// =============================================================================
+// CONFIGURATION CONSTANTS
+// =============================================================================
+#define NODE_ID 1                     // Change this for each ESP-01 node (1-6)
+#define RELAY_OPEN_PIN 0              // GPIO0 for OPEN relay
+#define RELAY_CLOSE_PIN 2             // GPIO2 for CLOSE relay
+#define RELAY_ACTIVE_TIME 5000        // 5 seconds activation time for relay (full travel)
+#define MIN_RELAY_WAIT_TIME 120000    // 2 minutes between actions
+#define SENSOR_READ_INTERVAL 10000    // Read sensor every 10 seconds
+#define CONTROL_CHECK_INTERVAL 1000   // Evaluate vent control every second
+#define MAX_OFFLINE_TIME 300000       // 5 minutes before going autonomous
+#define PREDICTIVE_CONTROL 0          // 1: trend-based control with partial vent positions
+
+// ESP-NOW communication; the hub's address and channel are found over the
+// air, see node_core.h
+uint8_t hubMacAddress[6];
+uint8_t broadcastMac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+bool setHubPeer(const uint8_t *mac, uint8_t channel);
+
+// =============================================================================
+// BOARD TRAITS
+// =============================================================================
+
+struct Esp01Board {
+  static constexpr uint8_t nodeId = NODE_ID;
+  static constexpr uint8_t relayOpenPin = RELAY_OPEN_PIN;
+  static constexpr uint8_t relayClosePin = RELAY_CLOSE_PIN;
+  static constexpr uint8_t sdaPin = 0;  // Shared with the relays
+  static constexpr uint8_t sclPin = 2;
+  static constexpr int8_t limitOpenPin = -1;  // No spare GPIO for limit switches
+  static constexpr int8_t limitClosedPin = -1;
+  static constexpr uint32_t motorTravelTime = RELAY_ACTIVE_TIME;
+  static constexpr uint32_t motorCooldownTime = MIN_RELAY_WAIT_TIME;
+  static constexpr uint32_t sensorReadInterval = SENSOR_READ_INTERVAL;
+  static constexpr uint32_t controlCheckInterval = CONTROL_CHECK_INTERVAL;
+  static constexpr uint32_t hubTimeout = MAX_OFFLINE_TIME;
+  static constexpr bool predictiveControl = PREDICTIVE_CONTROL;
+
+  static unsigned long now() {
+    return millis();
+  }
 
-// ----- CONFIGURATION -----
-#define NODE_ID 1                  // Change this for each ESP-01 node (1-6)
-#define RELAY_OPEN_PIN 0           // GPIO0 for OPEN relay
-#define RELAY_CLOSE_PIN 2          // GPIO2 for CLOSE relay
-#define RELAY_ACTIVE_TIME 5000     // 5 seconds activation time for relay
-#define MIN_RELAY_WAIT_TIME 120000 // 2 minutes between actions
-#define DEFAULT_TEMP_THRESHOLD 25.0
-#define DEFAULT_HYSTERESIS 0.5
-
-// ----- GLOBAL VARIABLES -----
-// BME280 sensor
-Adafruit_BME280 bme;
-bool sensorInitialized = false;
-
-// ESP-NOW communication
-uint8_t hubMacAddress[] = {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF}; // Replace with actual ESP32 MAC
-
-// Timing control
-unsigned long lastSensorRead = 0;
-unsigned long lastActionTime = 0;
-unsigned long sensorReadInterval = 10000;  // Read every 10 seconds
-
-// Vent control state
-enum VentStatus {CLOSED, OPENING, OPEN, CLOSING};
-VentStatus currentVentStatus = CLOSED;
-bool relayActive = false;
-unsigned long relayStartTime = 0;
-
-// Control settings (updated from hub or using defaults)
-struct Settings {
-  float temperatureThreshold = DEFAULT_TEMP_THRESHOLD;
-  float hysteresis = DEFAULT_HYSTERESIS;
-  bool autoMode = true;
-  char manualCommand = 0;  // 0:none, 'O':open, 'C':close, 'S':stop
-} settings;
-
-// Sensor data structure
-struct SensorData {
-  uint8_t nodeId;
-  float temperature;
-  float humidity;
-  float pressure;
-  uint8_t ventStatus; // 0:closed, 1:opening, 2:open, 3:closing
-  uint32_t timestamp;
-} sensorData;
-
-// Structure for incoming control messages from hub
-struct ControlMessage {
-  uint8_t targetNodeId;
-  float tempThreshold;
-  float hysteresis;
-  bool autoMode;
-  char manualCommand;
-} incomingControl;
-
-// ----- FUNCTION DECLARATIONS -----
-void initBME280();
-void readSensorData();
-void processVentControl();
-void applyManualCommand();
-void activateRelay(uint8_t relayPin);
-void deactivateRelays();
-void sendDataToHub();
-void onDataReceived(uint8_t *mac, uint8_t *data, uint8_t len);
-
-// ----- SETUP -----
-void setup() {
-  // Initialize serial for debugging (can be removed in final deployment)
-  Serial.begin(115200);
-  Serial.println("ESP-01 Greenhouse Node Starting...");
-  Serial.println("Node ID: " + String(NODE_ID));
-
-  // Initialize GPIO pins
-  pinMode(RELAY_OPEN_PIN, OUTPUT);
-  pinMode(RELAY_CLOSE_PIN, OUTPUT);
-  digitalWrite(RELAY_OPEN_PIN, LOW);
-  digitalWrite(RELAY_CLOSE_PIN, LOW);
-
-  // Initialize WiFi in station mode
-  WiFi.mode(WIFI_STA);
-  Serial.print("Node MAC: ");
-  Serial.println(WiFi.macAddress());
-
-  // Initialize ESP-NOW
-  if (esp_now_init() != 0) {
-    Serial.println("ESP-NOW initialization failed");
-    return;
+  static bool send(const uint8_t *data, size_t len) {
+    return esp_now_send(hubMacAddress, (uint8_t *)data, len) == 0;
   }
-  
-  // Register callback for incoming messages
-  esp_now_register_recv_cb(onDataReceived);
-  
-  // Add hub as peer
-  esp_now_add_peer(hubMacAddress, ESP_NOW_ROLE_COMBO, 1, NULL, 0);
-  
-  // Initialize BME280 sensor
-  initBME280();
-  
-  // Initialize node data
-  sensorData.nodeId = NODE_ID;
-  sensorData.ventStatus = (uint8_t)currentVentStatus;
-}
 
-// ----- MAIN LOOP -----
-void loop() {
-  unsigned long currentMillis = millis();
-  
-  // Read sensor data at specified interval
-  if (currentMillis - lastSensorRead >= sensorReadInterval) {
-    readSensorData();
-    sendDataToHub();
-    lastSensorRead = currentMillis;
-    
-    // Process vent control logic if in auto mode
-    if (settings.autoMode) {
-      processVentControl();
-    }
+  static bool broadcast(const uint8_t *data, size_t len) {
+    return esp_now_send(broadcastMac, (uint8_t *)data, len) == 0;
   }
-  
-  // Process manual command if available
-  if (!settings.autoMode && settings.manualCommand != 0) {
-    applyManualCommand();
+
+  static void setChannel(uint8_t channel) {
+    wifi_set_channel(channel);
   }
-  
-  // Check if relay needs to be turned off
-  if (relayActive && (currentMillis - relayStartTime >= RELAY_ACTIVE_TIME)) {
-    deactivateRelays();
-    relayActive = false;
-    
-    // Update vent status after relay action completes
-    if (currentVentStatus == OPENING) {
-      currentVentStatus = OPEN;
-    } else if (currentVentStatus == CLOSING) {
-      currentVentStatus = CLOSED;
-    }
-    sensorData.ventStatus = (uint8_t)currentVentStatus;
-    sendDataToHub(); // Send updated status
+
+  static bool setHub(const uint8_t *mac, uint8_t channel) {
+    return setHubPeer(mac, channel);
   }
-  
-  // Light sleep to save power (but still wake for time checks)
-  delay(100);
-}
 
-// ----- FUNCTIONS -----
-void initBME280() {
-  Wire.begin(0, 2);  // Use GPIO0(SDA) and GPIO2(SCL) for I2C
-  
-  // Try 0x76 and 0x77 addresses
-  if (bme.begin(0x76)) {
-    sensorInitialized = true;
-    Serial.println("BME280 initialized at 0x76");
-  } else if (bme.begin(0x77)) {
-    sensorInitialized = true;
-    Serial.println("BME280 initialized at 0x77");
-  } else {
-    Serial.println("BME280 initialization failed!");
+  static void indicate(uint8_t blinks) {
+    // No spare GPIO for a status LED on the ESP-01
   }
+};
+
+NodeCore<Esp01Board> node;
+
+// =============================================================================
+// ESP-NOW CALLBACKS
+// =============================================================================
+
+void onDataReceived(uint8_t *mac, uint8_t *data, uint8_t len) {
+  node.onFrame(mac, data, len);
 }
 
-void readSensorData() {
-  if (!sensorInitialized) {
-    // Try to re-initialize
-    initBME280();
-    if (!sensorInitialized) {
-      return;
-    }
-  }
-  
-  sensorData.temperature = bme.readTemperature();
-  sensorData.humidity = bme.readHumidity();
-  sensorData.pressure = bme.readPressure() / 100.0F;  // hPa
-  sensorData.timestamp = millis();
-  
-  Serial.print("Temperature: "); Serial.print(sensorData.temperature);
-  Serial.print(" °C, Humidity: "); Serial.print(sensorData.humidity);
-  Serial.print(" %, Pressure: "); Serial.print(sensorData.pressure);
-  Serial.println(" hPa");
+void onDataSent(uint8_t *mac, uint8_t status) {
+  node.onSendResult(mac, status == 0);
 }
 
-void processVentControl() {
-  unsigned long currentMillis = millis();
-  
-  // Check if minimum wait time has passed since last action
-  if (currentMillis - lastActionTime < MIN_RELAY_WAIT_TIME || relayActive) {
-    return;
+bool setHubPeer(const uint8_t *mac, uint8_t channel) {
+  wifi_set_channel(channel);
+
+  if (memcmp(hubMacAddress, mac, 6) != 0 && esp_now_is_peer_exist(hubMacAddress) > 0) {
+    esp_now_del_peer(hubMacAddress);
   }
-  
-  float currentTemp = sensorData.temperature;
-  
-  // Decide action based on temperature relative to threshold
-  if (currentTemp > settings.temperatureThreshold && currentVentStatus == CLOSED) {
-    // Too hot, need to open vent
-    currentVentStatus = OPENING;
-    sensorData.ventStatus = (uint8_t)currentVentStatus;
-    activateRelay(RELAY_OPEN_PIN);
-    lastActionTime = currentMillis;
-    Serial.println("Opening vent - Temperature above threshold");
-  } 
-  else if (currentTemp < (settings.temperatureThreshold - settings.hysteresis) && currentVentStatus == OPEN) {
-    // Cool enough to close vent (with hysteresis)
-    currentVentStatus = CLOSING;
-    sensorData.ventStatus = (uint8_t)currentVentStatus;
-    activateRelay(RELAY_CLOSE_PIN);
-    lastActionTime = currentMillis;
-    Serial.println("Closing vent - Temperature below threshold minus hysteresis");
+  memcpy(hubMacAddress, mac, 6);
+  if (esp_now_is_peer_exist(hubMacAddress) > 0) {
+    return esp_now_set_peer_channel(hubMacAddress, channel) == 0;
   }
+  return esp_now_add_peer(hubMacAddress, ESP_NOW_ROLE_COMBO, channel, NULL, 0) == 0;
 }
 
-void applyManualCommand() {
-  unsigned long currentMillis = millis();
-  
-  // Only process if not currently active and wait time passed
-  if (relayActive || currentMillis - lastActionTime < MIN_RELAY_WAIT_TIME) {
-    return;
+// =============================================================================
+// SETUP FUNCTION
+// =============================================================================
+
+void setup() {
+  // Initialize serial communication
+  Serial.begin(115200);
+  delay(1000);
+  LOGI(LogNode, "=== ESP-01 Greenhouse Node Starting ===");
+  LOGI(LogNode, "Node ID: %d", NODE_ID);
+
+  // Initialize WiFi in station mode for ESP-NOW
+  WiFi.mode(WIFI_STA);
+  WiFi.disconnect();
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  LOGI(LogNode, "Node MAC Address: %02X:%02X:%02X:%02X:%02X:%02X",
+       mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+  // Initialize ESP-NOW
+  if (esp_now_init() != 0) {
+    LOGE(LogLink, "ESP-NOW initialization failed!");
+    logFlush();
+    ESP.restart();
   }
-  
-  switch (settings.manualCommand) {
-    case 'O': // Open command
-      if (currentVentStatus != OPEN && currentVentStatus != OPENING) {
-        currentVentStatus = OPENING;
-        sensorData.ventStatus = (uint8_t)currentVentStatus;
-        activateRelay(RELAY_OPEN_PIN);
-        lastActionTime = currentMillis;
-        Serial.println("Manual open command executed");
-      }
-      break;
-      
-    case 'C': // Close command
-      if (currentVentStatus != CLOSED && currentVentStatus != CLOSING) {
-        currentVentStatus = CLOSING;
-        sensorData.ventStatus = (uint8_t)currentVentStatus;
-        activateRelay(RELAY_CLOSE_PIN);
-        lastActionTime = currentMillis;
-        Serial.println("Manual close command executed");
-      }
-      break;
-      
-    case 'S': // Stop command - just deactivate relays
-      deactivateRelays();
-      Serial.println("Manual stop command executed");
-      break;
+  LOGI(LogLink, "ESP-NOW initialized");
+
+  // Register ESP-NOW callbacks
+  esp_now_register_recv_cb(onDataReceived);
+  esp_now_register_send_cb(onDataSent);
+
+  // Hub discovery; the hub itself is added once a beacon names it
+  if (esp_now_add_peer(broadcastMac, ESP_NOW_ROLE_COMBO, 1, NULL, 0) != 0) {
+    LOGE(LogLink, "Failed to add broadcast peer");
   }
-  
-  // Clear the command after processing
-  settings.manualCommand = 0;
-}
 
-void activateRelay(uint8_t relayPin) {
-  // Safety check - deactivate all relays first
-  deactivateRelays();
-  
-  // Activate requested relay
-  digitalWrite(relayPin, HIGH);
-  relayActive = true;
-  relayStartTime = millis();
-  Serial.println("Relay activated: " + String(relayPin));
-}
+  // Settings, relays, sensor and the first reading
+  node.begin(false);
 
-void deactivateRelays() {
-  digitalWrite(RELAY_OPEN_PIN, LOW);
-  digitalWrite(RELAY_CLOSE_PIN, LOW);
+  LOGI(LogNode, "=== Node initialization complete ===");
+  node.printStatus();
 }
 
-void sendDataToHub() {
-  esp_now_send(hubMacAddress, (uint8_t*)&sensorData, sizeof(sensorData));
-  Serial.println("Data sent to hub");
-}
+// =============================================================================
+// MAIN LOOP
+// =============================================================================
 
-void onDataReceived(uint8_t *mac, uint8_t *data, uint8_t len) {
-  if (len == sizeof(ControlMessage)) {
-    memcpy(&incomingControl, data, sizeof(ControlMessage));
-    
-    // Only process messages targeted for this node
-    if (incomingControl.targetNodeId == NODE_ID || incomingControl.targetNodeId == 0) {
-      // Update local settings
-      settings.temperatureThreshold = incomingControl.tempThreshold;
-      settings.hysteresis = incomingControl.hysteresis;
-      settings.autoMode = incomingControl.autoMode;
-      settings.manualCommand = incomingControl.manualCommand;
-      
-      Serial.println("Received control update:");
-      Serial.print("Threshold: "); Serial.print(settings.temperatureThreshold);
-      Serial.print(", Hysteresis: "); Serial.print(settings.hysteresis);
-      Serial.print(", Mode: "); Serial.print(settings.autoMode ? "Auto" : "Manual");
-      if (settings.manualCommand) {
-        Serial.print(", Command: "); Serial.println(settings.manualCommand);
-      } else {
-        Serial.println();
-      }
-    }
+void loop() {
+  node.loop();
+
+  // Print system status every 5 minutes
+  static unsigned long lastStatusPrint = 0;
+  if (millis() - lastStatusPrint >= 300000) {
+    node.printStatus();
+    lastStatusPrint = millis();
   }
+
+  // Queued log lines go out here, never from the ESP-NOW callbacks
+  logService();
+
+  // Light sleep to save power
+  delay(100);
 }
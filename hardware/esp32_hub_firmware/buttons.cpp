@@ -0,0 +1,125 @@
+#include "buttons.h"
+#include "config.h"
+#include <ring_buffer.h>
+#include <Arduino.h>
+
+enum ButtonIndex : uint8_t {
+  BUTTON_UP,
+  BUTTON_SELECT,
+  BUTTON_DOWN,
+  BUTTON_COUNT
+};
+
+struct ButtonEdge {
+  uint8_t button;
+  bool pressed;
+  uint32_t time;
+};
+
+struct ButtonState {
+  uint8_t pin;
+  bool pressed;            // Debounced state
+  uint32_t lastChange;     // Time of the last accepted transition
+  uint32_t pressedAt;
+  bool longPressReported;
+};
+
+// Filled by the pin interrupts, drained by the main loop
+static SpscRing<ButtonEdge, BUTTON_QUEUE_SIZE> edgeQueue;
+static volatile uint32_t edgesDropped = 0;
+
+static ButtonState buttons[BUTTON_COUNT] = {
+  {BUTTON_UP_PIN, false, 0, 0, false},
+  {BUTTON_SELECT_PIN, false, 0, 0, false},
+  {BUTTON_DOWN_PIN, false, 0, 0, false}
+};
+
+static void IRAM_ATTR onButtonEdge(void *arg) {
+  uint8_t button = (uint8_t)(uintptr_t)arg;
+
+  ButtonEdge edge;
+  edge.button = button;
+  edge.pressed = digitalRead(buttons[button].pin) == LOW;  // Active low with pull-up
+  edge.time = millis();
+
+  if (!edgeQueue.push(edge)) {
+    edgesDropped++;
+  }
+}
+
+void initButtons() {
+  for (uint8_t i = 0; i < BUTTON_COUNT; i++) {
+    pinMode(buttons[i].pin, INPUT_PULLUP);
+    attachInterruptArg(digitalPinToInterrupt(buttons[i].pin), onButtonEdge,
+                       (void *)(uintptr_t)i, CHANGE);
+  }
+}
+
+// Applies one edge to the button's state machine. The first edge after a
+// quiet period is taken as the transition; bounces inside
+// BUTTON_DEBOUNCE_DELAY of it are ignored.
+static bool applyEdge(const ButtonEdge &edge, ButtonEvent &event) {
+  ButtonState &state = buttons[edge.button];
+
+  if (edge.pressed == state.pressed || edge.time - state.lastChange < BUTTON_DEBOUNCE_DELAY) {
+    return false;
+  }
+
+  state.pressed = edge.pressed;
+  state.lastChange = edge.time;
+
+  if (edge.pressed) {
+    state.pressedAt = edge.time;
+    state.longPressReported = false;
+
+    // Up and down act on press; select waits to tell short from long
+    if (edge.button == BUTTON_UP) {
+      event = BUTTON_EVENT_UP;
+      return true;
+    }
+    if (edge.button == BUTTON_DOWN) {
+      event = BUTTON_EVENT_DOWN;
+      return true;
+    }
+    return false;
+  }
+
+  if (edge.button == BUTTON_SELECT && !state.longPressReported) {
+    event = BUTTON_EVENT_SELECT;
+    return true;
+  }
+  return false;
+}
+
+bool nextButtonEvent(ButtonEvent &event) {
+  ButtonEdge edge;
+  while (edgeQueue.pop(edge)) {
+    if (applyEdge(edge, event)) {
+      return true;
+    }
+  }
+
+  uint32_t now = millis();
+
+  // A bounce can end inside the debounce window with the pin at the other
+  // level; resync from the pin once it has been quiet for a while
+  for (uint8_t i = 0; i < BUTTON_COUNT; i++) {
+    ButtonState &state = buttons[i];
+    if (now - state.lastChange >= BUTTON_DEBOUNCE_DELAY * 4) {
+      edge.button = i;
+      edge.pressed = digitalRead(state.pin) == LOW;
+      edge.time = now;
+      if (applyEdge(edge, event)) {
+        return true;
+      }
+    }
+  }
+
+  ButtonState &select = buttons[BUTTON_SELECT];
+  if (select.pressed && !select.longPressReported && now - select.pressedAt >= BUTTON_LONG_PRESS_TIME) {
+    select.longPressReported = true;
+    event = BUTTON_EVENT_LONG_SELECT;
+    return true;
+  }
+  return false;
+}
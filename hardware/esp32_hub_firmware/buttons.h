@@ -0,0 +1,20 @@
+#ifndef BUTTONS_H
+#define BUTTONS_H
+
+#include <stdint.h>
+
+// Interrupt-driven button input. Pin change interrupts queue timestamped
+// edges; nextButtonEvent() debounces them and classifies presses on the
+// main loop, so presses are not lost while the loop is busy.
+
+enum ButtonEvent : uint8_t {
+  BUTTON_EVENT_UP,
+  BUTTON_EVENT_DOWN,
+  BUTTON_EVENT_SELECT,
+  BUTTON_EVENT_LONG_SELECT  // Reported once the hold time is reached, before release
+};
+
+void initButtons();
+bool nextButtonEvent(ButtonEvent &event);
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// ----- CONFIGURATION -----
+#define WDT_TIMEOUT 30
+#define WIFI_RECONNECT_INITIAL 5000  // Reconnect backoff, doubles per failed attempt
+#define WIFI_RECONNECT_MAX 60000
+#define BUTTON_DEBOUNCE_DELAY 50
+#define BUTTON_LONG_PRESS_TIME 1000
+#define BUTTON_QUEUE_SIZE 32          // Pin edges buffered between the interrupts and the loop
+#define MAX_GREENHOUSES 20          // Highest nodeId; ESP-NOW allows 20 peers, see ensurePeer()
+#define NODE_TIMEOUT 300000
+#define FIREBASE_SYNC_INTERVAL 30000
+#define DISPLAY_UPDATE_INTERVAL 1000
+#define MENU_TIMEOUT 30000
+#define CONTROL_RETRY_INITIAL 500   // First retransmit delay, doubles per attempt
+#define CONTROL_MAX_ATTEMPTS 5
+#define GROUP_MAX_ATTEMPTS 3        // Broadcasts before the unacked nodes get it by unicast
+#define GROUP_SLOTS 2               // Group commands tracked in flight at once
+#define RX_QUEUE_SIZE 64            // ESP-NOW frames buffered between callback and loop (boot sync burst)
+#define RX_FRAME_MAX 32             // Longest frame prefix kept per received frame
+#define SENT_QUEUE_SIZE 32          // Unicast frames awaiting their send callback
+#define BEACON_INTERVAL 30000       // Hub beacon for node discovery, also sent on a channel change
+
+// Report-by-exception policy sent to the nodes in every ControlFrame: a node
+// reports when a reading moves past its deadband, when the vent status
+// changes, and at least once per heartbeat
+#define REPORT_DEADBAND_TEMPERATURE 0.2   // °C
+#define REPORT_DEADBAND_HUMIDITY 1.0      // %RH
+#define REPORT_DEADBAND_PRESSURE 0.5      // hPa
+#define REPORT_HEARTBEAT_INTERVAL 120     // Seconds
+#define POLICY_LEASE 600                  // Seconds a node follows it without hearing the hub
+
+// Cloud sync task (Firebase and WiFi run on core 0, UI and control on core 1)
+#define CLOUD_TASK_CORE 0
+#define CLOUD_TASK_PRIORITY 1
+#define CLOUD_TASK_STACK_SIZE 16384
+#define CLOUD_TASK_PERIOD 100
+#define CLOUD_QUEUE_SIZE 16
+
+// Sensor history kept on the hub and uploaded in batches (see sensor_history.h)
+#define HISTORY_MINUTE_ROLLUPS 1440   // 24 hours of 1-minute rollups
+#define HISTORY_QUARTER_ROLLUPS 672   // 7 days of 15-minute rollups
+#define HISTORY_QUEUE_SIZE 32
+#define HISTORY_HEAP_RESERVE 65536    // Internal heap left free for TLS on boards without PSRAM
+#define HISTORY_UPLOAD_INTERVAL 900000
+#define HISTORY_BATCH_MAX 240         // Entries per upload; larger backlogs go out in several batches
+
+// Store-and-forward outbox for /log (see outbox.h)
+#define OUTBOX_RAM_RECORDS 128
+#define OUTBOX_BATCH_RECORDS 50
+#define OUTBOX_FILE_MAX 524288        // Spill file limit, about 13 hours of 20 nodes
+#define OUTBOX_FLUSH_INTERVAL 60000   // Longest a record waits in RAM while online
+#define OUTBOX_DRAIN_INTERVAL 2000    // Minimum gap between batch uploads
+
+// Field metrics (see metrics.h), uploaded to /system/metrics and served locally
+#define METRICS_HISTOGRAM_BUCKETS 24  // Log2 microsecond buckets, the last one is about 4 s and up
+#define METRICS_JSON_MAX 6144
+#define METRICS_UPLOAD_INTERVAL 60000
+
+// Local HTTP/WebSocket API (see local_server.h)
+#define LOCAL_SERVER_PORT 80
+#define LOCAL_STATE_REFRESH 1000      // Full snapshot refresh, picks up menu edits and timeouts
+
+// Wall clock for the vent schedules (see schedule.h)
+#define NTP_SERVER "pool.ntp.org"
+#define TIME_ZONE "UTC0"              // POSIX TZ of the site, e.g. "CET-1CEST,M3.5.0,M10.5.0/3"
+#define SCHEDULE_RECHECK_MAX 60000    // Longest wait between clock reads, follows SNTP corrections
+
+// Flash partition holding the settings journal (see partitions.csv)
+#define SETTINGS_PARTITION_LABEL "settings"
+
+// Serial logging (see greenhouse_log.h). Lines above LOG_MAX_LEVEL or their
+// module's level are compiled out; production builds use LOG_LEVEL_WARN
+#define LOG_MAX_LEVEL LOG_LEVEL_INFO
+#define LOG_SYSTEM_LEVEL LOG_LEVEL_INFO
+#define LOG_ESPNOW_LEVEL LOG_LEVEL_INFO
+#define LOG_CLOUD_LEVEL LOG_LEVEL_INFO
+#define LOG_STORAGE_LEVEL LOG_LEVEL_INFO
+#define LOG_TASK_CORE 0               // Drain task runs at idle priority next to the cloud task
+
+// Display configuration
+#define SCREEN_WIDTH 128
+#define SCREEN_HEIGHT 64
+#define OLED_RESET -1
+#define SCREEN_ADDRESS 0x3C
+#define OVERVIEW_ROWS 6             // Greenhouses per overview page
+
+// Button pins
+#define BUTTON_UP_PIN 32
+#define BUTTON_SELECT_PIN 33
+#define BUTTON_DOWN_PIN 25
+
+// WiFi and Firebase credentials - UPDATE THESE
+#define WIFI_SSID "YOUR_WIFI_SSID"
+#define WIFI_PASSWORD "YOUR_WIFI_PASSWORD"
+#define API_KEY "YOUR_FIREBASE_API_KEY"
+#define DATABASE_URL "YOUR_FIREBASE_DATABASE_URL"
+#define LOCAL_API_TOKEN "YOUR_LOCAL_API_TOKEN"  // Shared secret for the local API, see local_server.h
+
+#endif
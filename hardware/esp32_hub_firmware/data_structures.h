@@ -3,6 +3,8 @@
 #define DATA_STRUCTURES_H
 
 #include <stdint.h>
+#include <string.h>
+#include <greenhouse_protocol.h>
 
 // Menu system states
 enum MenuState {
@@ -12,7 +14,7 @@ enum MenuState {
   MANUAL_CONTROL_ALL
 };
 
-// Data structures for nodes
+// Latest readings from a node, decoded from its SensorFrame
 struct SensorData {
   uint8_t nodeId;
   float temperature;
@@ -20,8 +22,38 @@ struct SensorData {
   float pressure;
   uint8_t ventStatus; // 0:closed, 1:opening, 2:open, 3:closing
   uint32_t timestamp;
+  uint8_t ventPosition;   // Percent open, from the node's run-time estimate
+  uint32_t motorSeconds;  // Total motor run time
+  uint32_t motorCycles;   // Total motor starts
 };
 
+// Names used in Firebase and the local API, indexed by the firmware value
+static constexpr const char *ventStatusNames[] = {"closed", "opening", "open", "closing"};
+
+struct ManualCommandName {
+  const char *name;
+  char command;
+};
+
+static constexpr ManualCommandName manualCommandNames[] = {
+  {"open", 'O'}, {"close", 'C'}, {"stop", 'S'}
+};
+
+inline const char* ventStatusName(uint8_t ventStatus) {
+  return ventStatus < sizeof(ventStatusNames) / sizeof(ventStatusNames[0]) ?
+         ventStatusNames[ventStatus] : "unknown";
+}
+
+// Manual command for a name such as "open", or 0 if there is none
+inline char manualCommandFor(const char *name) {
+  for (const ManualCommandName &entry : manualCommandNames) {
+    if (strcmp(name, entry.name) == 0) {
+      return entry.command;
+    }
+  }
+  return 0;
+}
+
 struct ScheduleSettings {
   uint8_t openHour = 8;    // Default open at 8 AM
   uint8_t openMinute = 0;
@@ -30,12 +62,40 @@ struct ScheduleSettings {
   bool scheduleEnabled = false;
 };
 
+inline bool sameSchedule(const ScheduleSettings &a, const ScheduleSettings &b) {
+  return a.openHour == b.openHour && a.openMinute == b.openMinute &&
+         a.closeHour == b.closeHour && a.closeMinute == b.closeMinute &&
+         a.scheduleEnabled == b.scheduleEnabled;
+}
+
+inline bool isValidSchedule(const ScheduleSettings &schedule) {
+  return schedule.openHour < 24 && schedule.openMinute < 60 &&
+         schedule.closeHour < 24 && schedule.closeMinute < 60;
+}
+
 struct GreenhouseSettings {
   float temperatureThreshold = 25.0;
   float hysteresis = 0.5;
   bool autoMode = true;
   char manualCommand = 0;
   ScheduleSettings schedule;
+  uint8_t ventTarget = 0;  // Percent open for manualCommand 'P', transient like it
+};
+
+// Fields changed since the last successful Firebase sync
+enum DirtyField : uint16_t {
+  DIRTY_TEMPERATURE   = 1 << 0,
+  DIRTY_HUMIDITY      = 1 << 1,
+  DIRTY_PRESSURE      = 1 << 2,
+  DIRTY_VENT_STATUS   = 1 << 3,
+  DIRTY_TIMESTAMP     = 1 << 4,
+  DIRTY_THRESHOLD     = 1 << 5,
+  DIRTY_HYSTERESIS    = 1 << 6,
+  DIRTY_MODE          = 1 << 7,
+  DIRTY_SCHEDULE      = 1 << 8,
+  DIRTY_VENT_POSITION = 1 << 9,
+  DIRTY_MOTOR_STATS   = 1 << 10,
+  DIRTY_ALL           = 0x07FF
 };
 
 struct GreenhouseData {
@@ -43,15 +103,39 @@ struct GreenhouseData {
   GreenhouseSettings settings;
   bool isOnline;
   unsigned long lastSeen;
+  uint16_t dirtyFields;  // DirtyField bits pending upload
 };
 
-// Structure for outgoing control messages to nodes
-struct ControlMessage {
-  uint8_t targetNodeId;
-  float tempThreshold;
-  float hysteresis;
+// Snapshot of one greenhouse handed from the main loop to the cloud sync task
+struct TelemetryUpdate {
+  uint8_t nodeId;
+  uint16_t fields;  // DirtyField bits carried by this snapshot
+  SensorData sensor;
+  GreenhouseSettings settings;
+};
+
+// Setting change or command downloaded from Firebase, applied by the main loop
+enum CloudCommandType : uint8_t {
+  CLOUD_SET_THRESHOLD,
+  CLOUD_SET_HYSTERESIS,
+  CLOUD_SET_MODE,
+  CLOUD_MANUAL_COMMAND,
+  CLOUD_SET_SCHEDULE
+};
+
+struct CloudCommand {
+  uint8_t nodeId;
+  CloudCommandType type;
+  float value;             // Threshold, hysteresis, or vent position for manualCommand 'P'
   bool autoMode;
   char manualCommand;
+  ScheduleSettings schedule;
+};
+
+// "Control all" action recorded to Firebase by the cloud sync task
+struct ControlAllEvent {
+  char command;
+  uint32_t timestamp;
 };
 
 #endif
@@ -0,0 +1,19 @@
+#ifndef DELTA_COLUMN_H
+#define DELTA_COLUMN_H
+
+#include <Firebase_ESP_Client.h>
+
+// Column of delta-encoded integers for batched uploads, the first entry
+// being absolute. Slowly changing readings turn into runs of small numbers,
+// which keeps batches short.
+struct DeltaColumn {
+  FirebaseJsonArray values;
+  int32_t previous = 0;
+
+  void add(int32_t value) {
+    values.add((int)(value - previous));
+    previous = value;
+  }
+};
+
+#endif
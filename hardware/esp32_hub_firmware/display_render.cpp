@@ -0,0 +1,70 @@
+#include "display_render.h"
+#include "config.h"
+#include <Wire.h>
+
+#define DISPLAY_PAGES (SCREEN_HEIGHT / 8)
+#define DISPLAY_CHUNK 32  // Data bytes per I2C transaction, fits the Wire buffer
+
+// Copy of what the panel currently shows
+static uint8_t shadow[SCREEN_WIDTH * DISPLAY_PAGES];
+static bool shadowValid = false;
+
+static void sendCommand(uint8_t command) {
+  Wire.beginTransmission(SCREEN_ADDRESS);
+  Wire.write((uint8_t)0x00);  // Co = 0, D/C = 0: command stream
+  Wire.write(command);
+  Wire.endTransmission();
+}
+
+static void sendSpan(uint8_t page, uint8_t first, uint8_t last, const uint8_t *data) {
+  // The controller is in horizontal addressing mode; restricting the window
+  // to one page and the changed columns makes the data land in place
+  sendCommand(SSD1306_PAGEADDR);
+  sendCommand(page);
+  sendCommand(page);
+  sendCommand(SSD1306_COLUMNADDR);
+  sendCommand(first);
+  sendCommand(last);
+
+  uint16_t remaining = last - first + 1;
+  while (remaining > 0) {
+    uint16_t count = remaining < DISPLAY_CHUNK ? remaining : DISPLAY_CHUNK;
+    Wire.beginTransmission(SCREEN_ADDRESS);
+    Wire.write((uint8_t)0x40);  // Co = 0, D/C = 1: data stream
+    Wire.write(data, count);
+    Wire.endTransmission();
+    data += count;
+    remaining -= count;
+  }
+}
+
+void pushDisplayChanges(Adafruit_SSD1306 &display) {
+  const uint8_t *frame = display.getBuffer();
+
+  Wire.setClock(400000);  // Same bus speed Adafruit_SSD1306 uses for display()
+
+  for (uint8_t page = 0; page < DISPLAY_PAGES; page++) {
+    const uint8_t *row = frame + page * SCREEN_WIDTH;
+    uint8_t *shadowRow = shadow + page * SCREEN_WIDTH;
+
+    int first = 0;
+    int last = SCREEN_WIDTH - 1;
+    if (shadowValid) {
+      while (first < SCREEN_WIDTH && row[first] == shadowRow[first]) first++;
+      if (first == SCREEN_WIDTH) {
+        continue;  // Page unchanged
+      }
+      while (row[last] == shadowRow[last]) last--;
+    }
+
+    sendSpan(page, first, last, row + first);
+    memcpy(shadowRow + first, row + first, last - first + 1);
+  }
+
+  Wire.setClock(100000);
+  shadowValid = true;
+}
+
+void invalidateDisplayShadow() {
+  shadowValid = false;
+}
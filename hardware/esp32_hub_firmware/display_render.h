@@ -0,0 +1,16 @@
+#ifndef DISPLAY_RENDER_H
+#define DISPLAY_RENDER_H
+
+#include <Adafruit_SSD1306.h>
+
+// Incremental SSD1306 updates. Screens are still drawn into the Adafruit
+// framebuffer, but instead of display.display() pushing all 1 KB, only the
+// changed column span of each 8-pixel page is sent over I2C.
+
+// Sends the changes since the last push (everything on the first call)
+void pushDisplayChanges(Adafruit_SSD1306 &display);
+
+// Forces the next push to resend the whole frame, e.g. after display.display()
+void invalidateDisplayShadow();
+
+#endif
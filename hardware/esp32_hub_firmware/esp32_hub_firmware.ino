@@ -9,7 +9,6 @@
  */
 
 #include <Wire.h>
-#include <EEPROM.h>
 #include <esp_task_wdt.h>
 #include <WiFi.h>
 #include <esp_now.h>
@@ -19,116 +18,36 @@
 #include <addons/TokenHelper.h>
 #include <addons/RTDBHelper.h>
 
-// ----- CONFIGURATION -----
-#define WDT_TIMEOUT 30
-#define WIFI_RETRY_LIMIT 20
-#define WIFI_RETRY_DELAY 500
-#define BUTTON_DEBOUNCE_DELAY 50
-#define MAX_GREENHOUSES 6
-#define NODE_TIMEOUT 300000
-#define FIREBASE_SYNC_INTERVAL 30000
-#define DISPLAY_UPDATE_INTERVAL 1000
-#define MENU_TIMEOUT 30000
-
-// Display configuration
-#define SCREEN_WIDTH 128
-#define SCREEN_HEIGHT 64
-#define OLED_RESET -1
-#define SCREEN_ADDRESS 0x3C
-
-// Button pins
-#define BUTTON_UP_PIN 32
-#define BUTTON_SELECT_PIN 33
-#define BUTTON_DOWN_PIN 25
-
-// WiFi and Firebase credentials - UPDATE THESE
-#define WIFI_SSID "YOUR_WIFI_SSID"
-#define WIFI_PASSWORD "YOUR_WIFI_PASSWORD"
-#define API_KEY "YOUR_FIREBASE_API_KEY"
-#define DATABASE_URL "YOUR_FIREBASE_DATABASE_URL"
-
-// ----- DATA STRUCTURES -----
-enum MenuState {
-  OVERVIEW, 
-  GREENHOUSE_DETAIL, 
-  SCHEDULE_SETTING, 
-  MANUAL_CONTROL_ALL
-};
-
-struct SensorData {
-  uint8_t nodeId;
-  float temperature;
-  float humidity;
-  float pressure;
-  uint8_t ventStatus; // 0:closed, 1:opening, 2:open, 3:closing
-  uint32_t timestamp;
-};
-
-struct ScheduleSettings {
-  uint8_t openHour = 8;
-  uint8_t openMinute = 0;
-  uint8_t closeHour = 18;
-  uint8_t closeMinute = 0;
-  bool scheduleEnabled = false;
-};
-
-struct GreenhouseSettings {
-  float temperatureThreshold = 25.0;
-  float hysteresis = 0.5;
-  bool autoMode = true;
-  char manualCommand = 0;
-  ScheduleSettings schedule;
-};
-
-struct GreenhouseData {
-  SensorData sensor;
-  GreenhouseSettings settings;
-  bool isOnline;
-  unsigned long lastSeen;
-};
-
-struct ControlMessage {
-  uint8_t targetNodeId;
-  float tempThreshold;
-  float hysteresis;
-  bool autoMode;
-  char manualCommand;
-};
+#include "config.h"
+#include "data_structures.h"
+#include "globals.h"
+#include "esp_now_comm.h"
+#include "wifi_firebase.h"
+#include "settings_eeprom.h"
+#include "node_registry.h"
+#include "display_render.h"
+#include "buttons.h"
+#include "metrics.h"
+#include "local_server.h"
+#include "schedule.h"
+#include "log_modules.h"
 
 // ----- GLOBAL VARIABLES -----
 // Display object
 Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
 
-// Firebase objects
-FirebaseData fbdo;
-FirebaseAuth auth;
-FirebaseConfig config;
-
 // Timing control
-unsigned long lastFirebaseSync = 0;
-unsigned long lastButtonCheck = 0;
 unsigned long lastDisplayUpdate = 0;
 unsigned long lastMenuActivity = 0;
-unsigned long selectPressStart = 0;
 unsigned long lastWatchdogFeed = 0;
-
-// Button state
-bool buttonUpPressed = false;
-bool buttonSelectPressed = false;
-bool buttonDownPressed = false;
-bool buttonUpLast = false;
-bool buttonSelectLast = false;
-bool buttonDownLast = false;
-bool selectLongPressed = false;
-bool selectCurrentlyPressed = false;
+unsigned long errorShownAt = 0;
+bool displayRefreshRequested = false;
 
 // Menu system
 MenuState currentMenu = OVERVIEW;
 uint8_t selectedGreenhouse = 1;
-uint8_t settingSelection = 0;
 uint8_t scheduleSelection = 0;
 uint8_t controlAllSelection = 0;
-bool editingValue = false;
 
 // Data structures for nodes
 GreenhouseData greenhouses[MAX_GREENHOUSES + 1];
@@ -139,19 +58,9 @@ bool hasError = false;
 
 // Function declarations
 void displayError(const char* message);
-bool validateSensorData(const SensorData& data);
 void feedWatchdog();
-void handleWiFiConnection();
 void checkNodeStatus();
 void initDisplay();
-void initButtons();
-void initESPNow();
-void initFirebase();
-void saveSettingsToEEPROM();
-void loadSettingsFromEEPROM();
-void sendControlToNode(uint8_t nodeId);
-void sendControlToAllNodes(char command);
-void syncWithFirebase();
 void checkButtons();
 void resetMenuTimeout();
 void checkMenuTimeout();
@@ -160,45 +69,50 @@ void displayOverview();
 void displayGreenhouseDetail();
 void displayScheduleSettings();
 void displayControlAll();
-void onDataReceived(const uint8_t *mac, const uint8_t *data, int len);
-void onDataSent(const uint8_t *mac_addr, esp_now_send_status_t status);
 void processButtonUp();
 void processButtonDown();
 void processButtonSelect();
 void processButtonLongSelect();
 
 // ----- SETUP -----
+// Staged so the hub listens to the nodes as early as possible: ESP-NOW
+// first (frames queue up until loop() runs), then the settings the frames
+// are processed against, then the UI. Nothing here waits on the network;
+// WiFi and Firebase come up in the cloud task.
 void setup() {
   Serial.begin(115200);
-  Serial.println("ESP32 Greenhouse Hub Starting...");
+  logStartTask(LOG_TASK_CORE);
+  LOGI(LogSystem, "ESP32 Greenhouse Hub Starting...");
   
   esp_task_wdt_init(WDT_TIMEOUT, true);
   esp_task_wdt_add(NULL);
+  initMetrics();
   
-  Wire.begin();
-  initDisplay();
-  initButtons();
+  bool espNowReady = initESPNow();
   
-  EEPROM.begin(512);
+  // Settings keep the values restored here (or their defaults); only
+  // reset the runtime state
   loadSettingsFromEEPROM();
-  
-  initESPNow();
-  handleWiFiConnection();
-  
-  if (WiFi.status() == WL_CONNECTED) {
-    initFirebase();
-  }
-  
   for (int i = 1; i <= MAX_GREENHOUSES; i++) {
     greenhouses[i].isOnline = false;
     greenhouses[i].lastSeen = 0;
-    greenhouses[i].settings.temperatureThreshold = 25.0;
-    greenhouses[i].settings.hysteresis = 0.5;
-    greenhouses[i].settings.autoMode = true;
     greenhouses[i].sensor.nodeId = i;
     greenhouses[i].sensor.ventStatus = 0;
   }
   
+  Wire.begin();
+  initDisplay();
+  initButtons();
+  if (!espNowReady) {
+    displayError("ESP-NOW Init Failed");
+  }
+  
+  // Local API; it serves as soon as the cloud task brings WiFi up
+  initLocalServer();
+  
+  // WiFi and Firebase run on their own task from here on
+  startCloudSyncTask();
+  
   resetMenuTimeout();
   
   display.clearDisplay();
@@ -207,35 +121,42 @@ void setup() {
   display.setCursor(0, 0);
   display.println("Hub initialized!");
   display.println("Waiting for nodes...");
-  display.display();
+  pushDisplayChanges(display);
+  
+  // Last, so the answers find the main loop running
+  requestNodeReports();
+  LOGI(LogSystem, "Hub ready after %lu ms", millis());
 }
 
 // ----- MAIN LOOP -----
 void loop() {
+  SectionTimer loopTimer(SECTION_LOOP);
   unsigned long currentMillis = millis();
   
   feedWatchdog();
   
-  if (currentMillis - lastButtonCheck >= BUTTON_DEBOUNCE_DELAY) {
-    checkButtons();
-    lastButtonCheck = currentMillis;
-  }
+  // Handle ESP-NOW frames queued by the receive callback
+  processReceivedFrames();
+  
+  // Button edges are queued by interrupts, so nothing is lost while the loop is busy
+  checkButtons();
   
   checkMenuTimeout();
   
-  if (currentMillis - lastDisplayUpdate >= DISPLAY_UPDATE_INTERVAL) {
+  // Redraw on state changes right away, otherwise on the refresh timer
+  if (displayRefreshRequested || currentMillis - lastDisplayUpdate >= DISPLAY_UPDATE_INTERVAL) {
     updateDisplay();
     lastDisplayUpdate = currentMillis;
   }
   
-  if (WiFi.status() == WL_CONNECTED && 
-      currentMillis - lastFirebaseSync >= FIREBASE_SYNC_INTERVAL) {
-    syncWithFirebase();
-    lastFirebaseSync = currentMillis;
-  } else if (WiFi.status() != WL_CONNECTED && 
-             currentMillis - lastFirebaseSync >= WIFI_RETRY_DELAY * 10) {
-    handleWiFiConnection();
-  }
+  // Exchange state with the cloud sync task
+  processCloudCommands();
+  publishTelemetry();
+  serviceLocalServer();
+  
+  serviceSchedule();
+  processControlRetransmits();
+  serviceBeacon();
   
   checkNodeStatus();
 }
@@ -243,19 +164,24 @@ void loop() {
 // ----- DISPLAY FUNCTIONS -----
 void initDisplay() {
   if (!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS)) {
-    Serial.println(F("SSD1306 allocation failed"));
+    LOGE(LogSystem, "SSD1306 allocation failed");
+    logFlush();
     for(;;);
   }
-  display.display();
-  delay(2000);
-  display.clearDisplay();
+  display.clearDisplay();  // No splash screen, the first push sends a full frame
 }
 
 void updateDisplay() {
+  SectionTimer timer(SECTION_DISPLAY);
+  
+  // Keep an error on screen for one refresh interval
   if (hasError) {
+    if (millis() - errorShownAt < DISPLAY_UPDATE_INTERVAL) {
+      return;
+    }
     hasError = false;
-    return;
   }
+  displayRefreshRequested = false;
   
   display.clearDisplay();
   display.setTextSize(1);
@@ -276,15 +202,35 @@ void updateDisplay() {
       break;
   }
   
-  display.display();
+  pushDisplayChanges(display);
 }
 
 void displayOverview() {
   display.setCursor(0, 0);
   display.println("Greenhouse Overview");
-  display.println("------------------");
   
-  for (int i = 1; i <= MAX_GREENHOUSES; i++) {
+  if (activeNodeCount == 0) {
+    display.println("------------------");
+    display.println("Waiting for nodes...");
+    return;
+  }
+  
+  // Page through the registered nodes, showing the page with the selection
+  int selectedIndex = activeIndexOf(selectedGreenhouse);
+  if (selectedIndex < 0) {
+    selectedIndex = 0;
+    selectedGreenhouse = activeNodes[0];
+  }
+  int firstIndex = (selectedIndex / OVERVIEW_ROWS) * OVERVIEW_ROWS;
+  int pageCount = (activeNodeCount + OVERVIEW_ROWS - 1) / OVERVIEW_ROWS;
+  
+  display.print("--------------- ");
+  display.print(firstIndex / OVERVIEW_ROWS + 1);
+  display.print("/");
+  display.println(pageCount);
+  
+  for (int n = firstIndex; n < activeNodeCount && n < firstIndex + OVERVIEW_ROWS; n++) {
+    uint8_t i = activeNodes[n];
     if (i == selectedGreenhouse) {
       display.print("> ");
     } else {
@@ -333,11 +279,14 @@ void displayGreenhouseDetail() {
     
     display.print("Vent: ");
     switch (greenhouses[selectedGreenhouse].sensor.ventStatus) {
-      case 0: display.println("CLOSED"); break;
-      case 1: display.println("OPENING"); break;
-      case 2: display.println("OPEN"); break;
-      case 3: display.println("CLOSING"); break;
+      case 0: display.print("CLOSED"); break;
+      case 1: display.print("OPENING"); break;
+      case 2: display.print("OPEN"); break;
+      case 3: display.print("CLOSING"); break;
     }
+    display.print(" ");
+    display.print(greenhouses[selectedGreenhouse].sensor.ventPosition);
+    display.println("%");
     
     display.print("Mode: ");
     display.println(greenhouses[selectedGreenhouse].settings.autoMode ? "AUTO" : "MANUAL");
@@ -386,74 +335,41 @@ void displayControlAll() {
 }
 
 // ----- BUTTON FUNCTIONS -----
-void initButtons() {
-  pinMode(BUTTON_UP_PIN, INPUT_PULLUP);
-  pinMode(BUTTON_SELECT_PIN, INPUT_PULLUP);
-  pinMode(BUTTON_DOWN_PIN, INPUT_PULLUP);
-}
-
 void checkButtons() {
-  bool upCurrent = !digitalRead(BUTTON_UP_PIN);
-  bool selectCurrent = !digitalRead(BUTTON_SELECT_PIN);
-  bool downCurrent = !digitalRead(BUTTON_DOWN_PIN);
-  
-  if (upCurrent && !buttonUpLast) {
-    buttonUpPressed = true;
+  SectionTimer timer(SECTION_BUTTONS);
+  ButtonEvent event;
+  while (nextButtonEvent(event)) {
     resetMenuTimeout();
-  }
-  
-  if (selectCurrent && !buttonSelectLast) {
-    selectCurrentlyPressed = true;
-    selectPressStart = millis();
-    resetMenuTimeout();
-  }
-  
-  if (!selectCurrent && buttonSelectLast && selectCurrentlyPressed) {
-    if (millis() - selectPressStart > 1000) {
-      selectLongPressed = true;
-    } else {
-      buttonSelectPressed = true;
+    
+    switch (event) {
+      case BUTTON_EVENT_UP:
+        processButtonUp();
+        break;
+      case BUTTON_EVENT_DOWN:
+        processButtonDown();
+        break;
+      case BUTTON_EVENT_SELECT:
+        processButtonSelect();
+        break;
+      case BUTTON_EVENT_LONG_SELECT:
+        processButtonLongSelect();
+        break;
     }
-    selectCurrentlyPressed = false;
-  }
-  
-  if (downCurrent && !buttonDownLast) {
-    buttonDownPressed = true;
-    resetMenuTimeout();
-  }
-  
-  if (buttonUpPressed) {
-    processButtonUp();
-    buttonUpPressed = false;
-  }
-  
-  if (buttonSelectPressed) {
-    processButtonSelect();
-    buttonSelectPressed = false;
-  }
-  
-  if (selectLongPressed) {
-    processButtonLongSelect();
-    selectLongPressed = false;
-  }
-  
-  if (buttonDownPressed) {
-    processButtonDown();
-    buttonDownPressed = false;
+    displayRefreshRequested = true;
   }
-  
-  buttonUpLast = upCurrent;
-  buttonSelectLast = selectCurrent;
-  buttonDownLast = downCurrent;
 }
 
 void processButtonUp() {
   switch (currentMenu) {
-    case OVERVIEW:
-      if (selectedGreenhouse > 1) {
-        selectedGreenhouse--;
+    case OVERVIEW: {
+      int index = activeIndexOf(selectedGreenhouse);
+      if (index > 0) {
+        selectedGreenhouse = activeNodes[index - 1];
       }
       break;
+    }
+    case GREENHOUSE_DETAIL:
+      break;  // Nothing to select
     case SCHEDULE_SETTING:
       if (scheduleSelection > 0) {
         scheduleSelection--;
@@ -469,11 +385,15 @@ void processButtonUp() {
 
 void processButtonDown() {
   switch (currentMenu) {
-    case OVERVIEW:
-      if (selectedGreenhouse < MAX_GREENHOUSES) {
-        selectedGreenhouse++;
+    case OVERVIEW: {
+      int index = activeIndexOf(selectedGreenhouse);
+      if (index >= 0 && index + 1 < activeNodeCount) {
+        selectedGreenhouse = activeNodes[index + 1];
       }
       break;
+    }
+    case GREENHOUSE_DETAIL:
+      break;  // Nothing to select
     case SCHEDULE_SETTING:
       if (scheduleSelection < 2) {
         scheduleSelection++;
@@ -490,7 +410,9 @@ void processButtonDown() {
 void processButtonSelect() {
   switch (currentMenu) {
     case OVERVIEW:
-      currentMenu = GREENHOUSE_DETAIL;
+      if (activeIndexOf(selectedGreenhouse) >= 0) {
+        currentMenu = GREENHOUSE_DETAIL;
+      }
       break;
     case GREENHOUSE_DETAIL:
       currentMenu = SCHEDULE_SETTING;
@@ -509,10 +431,7 @@ void processButtonSelect() {
           sendControlToAllNodes('C');
           break;
         case 2:
-          for (int i = 1; i <= MAX_GREENHOUSES; i++) {
-            greenhouses[i].settings.autoMode = true;
-            sendControlToNode(i);
-          }
+          sendAutoModeToAllNodes();
           break;
       }
       currentMenu = OVERVIEW;
@@ -532,297 +451,7 @@ void checkMenuTimeout() {
   if (millis() - lastMenuActivity > MENU_TIMEOUT) {
     currentMenu = OVERVIEW;
     resetMenuTimeout();
-  }
-}
-
-// ----- ESP-NOW COMMUNICATION -----
-void initESPNow() {
-  WiFi.mode(WIFI_AP_STA);
-  
-  if (esp_now_init() != ESP_OK) {
-    displayError("ESP-NOW Init Failed");
-    return;
-  }
-  
-  esp_now_register_recv_cb(onDataReceived);
-  esp_now_register_send_cb(onDataSent);
-  
-  Serial.println("ESP-NOW initialized successfully");
-}
-
-void sendControlToNode(uint8_t nodeId) {
-  if (!greenhouses[nodeId].isOnline) {
-    return;
-  }
-  
-  ControlMessage controlMsg;
-  controlMsg.targetNodeId = nodeId;
-  controlMsg.tempThreshold = greenhouses[nodeId].settings.temperatureThreshold;
-  controlMsg.hysteresis = greenhouses[nodeId].settings.hysteresis;
-  controlMsg.autoMode = greenhouses[nodeId].settings.autoMode;
-  controlMsg.manualCommand = greenhouses[nodeId].settings.manualCommand;
-  
-  // Broadcast to all nodes - they will filter by ID
-  uint8_t broadcastAddress[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-  esp_now_peer_info_t peerInfo = {};
-  memcpy(peerInfo.peer_addr, broadcastAddress, 6);
-  peerInfo.channel = 0;
-  peerInfo.encrypt = false;
-  
-  if (esp_now_is_peer_exist(broadcastAddress) == false) {
-    esp_now_add_peer(&peerInfo);
-  }
-  
-  esp_err_t result = esp_now_send(broadcastAddress, (uint8_t *)&controlMsg, sizeof(controlMsg));
-  
-  if (result == ESP_OK) {
-    Serial.println("Control message sent to node " + String(nodeId));
-  } else {
-    Serial.println("Error sending control message");
-  }
-  
-  greenhouses[nodeId].settings.manualCommand = 0;
-}
-
-void sendControlToAllNodes(char command) {
-  Serial.print("Sending command to all nodes: ");
-  Serial.println(command);
-  
-  for (int i = 1; i <= MAX_GREENHOUSES; i++) {
-    if (!greenhouses[i].isOnline || 
-        (millis() - greenhouses[i].lastSeen > 300000)) {
-      continue;
-    }
-    
-    greenhouses[i].settings.manualCommand = command;
-    
-    if (command == 'O' || command == 'C') {
-      greenhouses[i].settings.autoMode = false;
-    }
-    
-    sendControlToNode(i);
-  }
-  
-  if (WiFi.status() == WL_CONNECTED && Firebase.ready()) {
-    FirebaseJson json;
-    json.set("action", String(command == 'O' ? "open" : "close"));
-    json.set("timestamp", (uint32_t)millis());
-    Firebase.RTDB.setJSON(&fbdo, "/system/lastControlAll", &json);
-  }
-}
-
-void onDataReceived(const uint8_t *mac, const uint8_t *data, int len) {
-  if (len == sizeof(SensorData)) {
-    SensorData* receivedData = (SensorData*)data;
-    
-    if (receivedData->nodeId < 1 || receivedData->nodeId > MAX_GREENHOUSES) {
-      return;
-    }
-    
-    uint8_t nodeId = receivedData->nodeId;
-    
-    greenhouses[nodeId].sensor = *receivedData;
-    greenhouses[nodeId].isOnline = true;
-    greenhouses[nodeId].lastSeen = millis();
-    
-    Serial.print("Data received from node ");
-    Serial.print(nodeId);
-    Serial.print(": Temp=");
-    Serial.print(receivedData->temperature);
-    Serial.print("°C, Humidity=");
-    Serial.print(receivedData->humidity);
-    Serial.print("%, Pressure=");
-    Serial.print(receivedData->pressure);
-    Serial.print("hPa, Vent=");
-    Serial.println(receivedData->ventStatus);
-  }
-}
-
-void onDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
-  Serial.print("ESP-NOW send status: ");
-  Serial.println(status == ESP_NOW_SEND_SUCCESS ? "Success" : "Failed");
-}
-
-// ----- WIFI AND FIREBASE FUNCTIONS -----
-void handleWiFiConnection() {
-  if (WiFi.status() == WL_CONNECTED) return;
-  
-  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-  
-  int retryCount = 0;
-  while (WiFi.status() != WL_CONNECTED && retryCount < WIFI_RETRY_LIMIT) {
-    delay(WIFI_RETRY_DELAY);
-    retryCount++;
-    
-    display.clearDisplay();
-    display.setCursor(0,0);
-    display.println("Connecting WiFi:");
-    display.println(WIFI_SSID);
-    display.print("Attempt: ");
-    display.println(retryCount);
-    display.display();
-  }
-  
-  if (WiFi.status() != WL_CONNECTED) {
-    displayError("WiFi Connection Failed");
-  } else {
-    Serial.println("WiFi Connected");
-    Serial.print("IP: ");
-    Serial.println(WiFi.localIP());
-  }
-}
-
-void initFirebase() {
-  config.api_key = API_KEY;
-  config.database_url = DATABASE_URL;
-  
-  auth.user.email = "";
-  auth.user.password = "";
-  
-  Firebase.begin(&config, &auth);
-  Firebase.reconnectWiFi(true);
-  
-  Serial.println("Firebase initialized");
-}
-
-void syncWithFirebase() {
-  if (!Firebase.ready()) {
-    Serial.println("Firebase not ready");
-    return;
-  }
-
-  for (int i = 1; i <= MAX_GREENHOUSES; i++) {
-    if (greenhouses[i].isOnline && 
-        (millis() - greenhouses[i].lastSeen < 300000)) {
-      
-      FirebaseJson json;
-      json.set("nodeId", greenhouses[i].sensor.nodeId);
-      json.set("temperature", greenhouses[i].sensor.temperature);
-      json.set("humidity", greenhouses[i].sensor.humidity);
-      json.set("pressure", greenhouses[i].sensor.pressure);
-      json.set("ventStatus", greenhouses[i].sensor.ventStatus);
-      json.set("timestamp", greenhouses[i].sensor.timestamp);
-      
-      String path = "/greenhouses/" + String(i) + "/currentData";
-      
-      if (Firebase.RTDB.setJSON(&fbdo, path.c_str(), &json)) {
-        Serial.println("Uploaded data for greenhouse " + String(i));
-      } else {
-        Serial.println("Failed to upload: " + fbdo.errorReason());
-      }
-      
-      FirebaseJson settingsJson;
-      settingsJson.set("temperatureThreshold", greenhouses[i].settings.temperatureThreshold);
-      settingsJson.set("hysteresis", greenhouses[i].settings.hysteresis);
-      settingsJson.set("mode", greenhouses[i].settings.autoMode ? "auto" : "manual");
-      
-      String ventStatus;
-      switch (greenhouses[i].sensor.ventStatus) {
-        case 0: ventStatus = "closed"; break;
-        case 1: ventStatus = "opening"; break;
-        case 2: ventStatus = "open"; break;
-        case 3: ventStatus = "closing"; break;
-        default: ventStatus = "unknown"; break;
-      }
-      settingsJson.set("ventStatus", ventStatus);
-      
-      settingsJson.set("scheduleOpenHour", greenhouses[i].settings.schedule.openHour);
-      settingsJson.set("scheduleOpenMinute", greenhouses[i].settings.schedule.openMinute);
-      settingsJson.set("scheduleCloseHour", greenhouses[i].settings.schedule.closeHour);
-      settingsJson.set("scheduleCloseMinute", greenhouses[i].settings.schedule.closeMinute);
-      settingsJson.set("scheduleEnabled", greenhouses[i].settings.schedule.scheduleEnabled);
-      
-      path = "/greenhouses/" + String(i) + "/settings";
-      Firebase.RTDB.setJSON(&fbdo, path.c_str(), &settingsJson);
-    }
-  }
-  
-  for (int i = 1; i <= MAX_GREENHOUSES; i++) {
-    String path = "/greenhouses/" + String(i) + "/settings";
-    
-    if (Firebase.RTDB.getJSON(&fbdo, path.c_str())) {
-      if (fbdo.dataType() == "json") {
-        FirebaseJson &json = fbdo.jsonObject();
-        FirebaseJsonData result;
-        
-        json.get(result, "temperatureThreshold");
-        if (result.success) {
-          float newThreshold = result.to<float>();
-          if (newThreshold != greenhouses[i].settings.temperatureThreshold) {
-            greenhouses[i].settings.temperatureThreshold = newThreshold;
-            sendControlToNode(i);
-          }
-        }
-        
-        json.get(result, "hysteresis");
-        if (result.success) {
-          float newHysteresis = result.to<float>();
-          if (newHysteresis != greenhouses[i].settings.hysteresis) {
-            greenhouses[i].settings.hysteresis = newHysteresis;
-            sendControlToNode(i);
-          }
-        }
-        
-        json.get(result, "mode");
-        if (result.success) {
-          String mode = result.to<String>();
-          bool newAutoMode = (mode == "auto");
-          if (newAutoMode != greenhouses[i].settings.autoMode) {
-            greenhouses[i].settings.autoMode = newAutoMode;
-            sendControlToNode(i);
-          }
-        }
-        
-        json.get(result, "manualControl");
-        if (result.success) {
-          String command = result.to<String>();
-          char manualCmd = 0;
-          
-          if (command == "open") manualCmd = 'O';
-          else if (command == "close") manualCmd = 'C';
-          else if (command == "stop") manualCmd = 'S';
-          
-          if (manualCmd != 0) {
-            greenhouses[i].settings.manualCommand = manualCmd;
-            sendControlToNode(i);
-            
-            FirebaseJson clearJson;
-            clearJson.set("manualControl", (const char*)NULL);
-            Firebase.RTDB.updateNode(&fbdo, path.c_str(), &clearJson);
-          }
-        }
-        
-        saveSettingsToEEPROM();
-      }
-    }
-  }
-}
-
-// ----- EEPROM FUNCTIONS -----
-void saveSettingsToEEPROM() {
-  for (int i = 1; i <= MAX_GREENHOUSES; i++) {
-    int addr = (i-1) * sizeof(GreenhouseSettings);
-    EEPROM.put(addr, greenhouses[i].settings);
-  }
-  EEPROM.commit();
-}
-
-void loadSettingsFromEEPROM() {
-  for (int i = 1; i <= MAX_GREENHOUSES; i++) {
-    int addr = (i-1) * sizeof(GreenhouseSettings);
-    EEPROM.get(addr, greenhouses[i].settings);
-    
-    if (isnan(greenhouses[i].settings.temperatureThreshold) || 
-        greenhouses[i].settings.temperatureThreshold < 0 ||
-        greenhouses[i].settings.temperatureThreshold > 50) {
-      greenhouses[i].settings.temperatureThreshold = 25.0;
-    }
-    
-    if (isnan(greenhouses[i].settings.hysteresis) ||
-        greenhouses[i].settings.hysteresis < 0 ||
-        greenhouses[i].settings.hysteresis > 5) {
-      greenhouses[i].settings.hysteresis = 0.5;
-    }
+    displayRefreshRequested = true;
   }
 }
 
@@ -830,23 +459,23 @@ void loadSettingsFromEEPROM() {
 void displayError(const char* message) {
   strncpy(lastErrorMessage, message, sizeof(lastErrorMessage) - 1);
   hasError = true;
+  errorShownAt = millis();
   
   display.clearDisplay();
   display.setTextSize(1);
   display.setCursor(0,0);
   display.println("ERROR:");
   display.println(message);
-  display.display();
+  pushDisplayChanges(display);
   
-  Serial.print("Error: ");
-  Serial.println(message);
+  LOGE(LogSystem, "%s", message);
 }
 
 bool validateSensorData(const SensorData& data) {
   if (data.temperature < -40.0 || data.temperature > 80.0) return false;
   if (data.humidity < 0.0 || data.humidity > 100.0) return false;
   if (data.pressure < 800.0 || data.pressure > 1200.0) return false;
-  if (data.timestamp > millis()) return false;
+  if (data.ventPosition > 100) return false;
   return true;
 }
 
@@ -861,7 +490,8 @@ void feedWatchdog() {
 void checkNodeStatus() {
   unsigned long currentMillis = millis();
   
-  for (int i = 1; i <= MAX_GREENHOUSES; i++) {
+  for (uint8_t n = 0; n < activeNodeCount; n++) {
+    uint8_t i = activeNodes[n];
     if (greenhouses[i].isOnline && 
         currentMillis - greenhouses[i].lastSeen > NODE_TIMEOUT) {
       greenhouses[i].isOnline = false;
@@ -2,23 +2,268 @@
 #include "esp_now_comm.h"
 #include "config.h"
 #include "globals.h"
+#include "wifi_firebase.h"
+#include <ring_buffer.h>
+#include "node_registry.h"
+#include "sensor_history.h"
+#include "metrics.h"
+#include "local_server.h"
+#include "schedule.h"
+#include "log_modules.h"
 #include <WiFi.h>
-#include <Firebase_ESP_Client.h>
+#include <esp_wifi.h>
 
 // External references
 extern GreenhouseData greenhouses[];
-extern FirebaseData fbdo;
 
-void initESPNow() {
+// Raw frames copied out of the receive callback (Wi-Fi task -> main loop)
+struct RxFrame {
+  uint8_t mac[6];
+  uint32_t receivedAt;  // micros() in the callback, for round-trip times
+  uint8_t len;
+  uint8_t data[RX_FRAME_MAX];
+};
+
+static SpscRing<RxFrame, RX_QUEUE_SIZE> rxQueue;
+
+// Unicast frames handed to the radio, oldest first, so onDataSent() learns
+// the target node without reading the peer table (main loop -> Wi-Fi task)
+struct SentFrame {
+  uint8_t nodeId;
+  uint8_t mac[6];
+};
+
+static SpscRing<SentFrame, SENT_QUEUE_SIZE> sentFrames;
+
+// Unicast peer table, learned from the source MAC of each node's frames.
+// The MAC is recorded when a frame is processed; the peer is (re)registered
+// with ESP-NOW the next time we send to that node.
+struct NodePeer {
+  uint8_t mac[6];
+  bool known;       // MAC learned from a received frame
+  bool registered;  // MAC added with esp_now_add_peer()
+};
+
+static NodePeer nodePeers[MAX_GREENHOUSES + 1];
+static uint8_t nodeVersions[MAX_GREENHOUSES + 1];  // Protocol version of each node's last report
+
+// Group commands and beacons go to the broadcast address, which takes one
+// entry of the ESP-NOW peer table. Unicast peers come first: with the table
+// full the broadcast peer is removed, group commands go out per node and
+// periodic beacons stop. A searching node that is a registered peer still
+// gets its beacon by unicast, so it finds the hub again after a channel
+// change or a lost link.
+static const uint8_t broadcastMac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+static bool broadcastRegistered = false;
+
+static esp_err_t addPeer(const uint8_t *mac) {
+  esp_now_peer_info_t peerInfo = {};
+  memcpy(peerInfo.peer_addr, mac, 6);
+  peerInfo.channel = 0;
+  peerInfo.encrypt = false;
+  return esp_now_add_peer(&peerInfo);
+}
+
+static bool ensureBroadcastPeer() {
+  if (!broadcastRegistered) {
+    broadcastRegistered = esp_now_is_peer_exist(broadcastMac) || addPeer(broadcastMac) == ESP_OK;
+  }
+  return broadcastRegistered;
+}
+
+static bool ensurePeer(uint8_t nodeId) {
+  NodePeer &peer = nodePeers[nodeId];
+  if (!peer.known) {
+    return false;
+  }
+  if (peer.registered) {
+    return true;
+  }
+  
+  if (esp_now_is_peer_exist(peer.mac)) {
+    peer.registered = true;
+    return true;
+  }
+  
+  esp_err_t result = addPeer(peer.mac);
+  if (result == ESP_ERR_ESPNOW_FULL && broadcastRegistered) {
+    LOGW(LogEspNow, "Peer table full, group commands fall back to unicast");
+    esp_now_del_peer(broadcastMac);
+    broadcastRegistered = false;
+    result = addPeer(peer.mac);
+  }
+  peer.registered = result == ESP_OK;
+  return peer.registered;
+}
+
+// Called with the source address of each valid sensor frame
+static void learnPeer(uint8_t nodeId, const uint8_t *mac) {
+  NodePeer &peer = nodePeers[nodeId];
+  if (peer.known && memcmp(peer.mac, mac, 6) == 0) {
+    return;
+  }
+  
+  // New node or replaced hardware; registration happens on the send path
+  if (peer.registered) {
+    esp_now_del_peer(peer.mac);
+  }
+  memcpy(peer.mac, mac, 6);
+  peer.registered = false;
+  peer.known = true;
+}
+
+// Nodes report at least once per heartbeat; leave room for a lost frame
+static_assert(REPORT_HEARTBEAT_INTERVAL * 1000UL * 2 <= NODE_TIMEOUT,
+              "Heartbeat too slow for NODE_TIMEOUT");
+static_assert(REPORT_HEARTBEAT_INTERVAL * 2 <= POLICY_LEASE,
+              "Heartbeat too slow for POLICY_LEASE");
+
+// Retransmit slot per node holding the newest unacknowledged message.
+// Every ControlFrame carries the node's full settings, so a newer one
+// supersedes an older one, but it keeps any manual command still unacked.
+struct PendingControl {
+  ControlFrame msg;
+  bool active;
+  bool parked;  // Retries used up; resent when the node next reports
+  uint8_t attempts;
+  unsigned long nextRetry;
+};
+
+static PendingControl pendingControls[MAX_GREENHOUSES + 1];
+static uint16_t lastSequence[MAX_GREENHOUSES + 1];  // Random start, like groupSequence
+static uint16_t ackedSequence[MAX_GREENHOUSES + 1];
+
+// Group commands in flight, e.g. a scheduled open and close due together.
+// A node is only ever waiting for one of them: a new command first hands
+// its addressed nodes that still miss an older one over to unicast.
+struct PendingGroup {
+  GroupFrame msg;
+  uint32_t unacked;  // Bit per nodeId that has not acknowledged it yet
+  uint8_t attempts;
+  unsigned long nextRetry;
+};
+
+static uint8_t beaconChannel = 0;  // Channel last announced
+static unsigned long lastBeacon = 0;
+
+static PendingGroup pendingGroups[GROUP_SLOTS];
+static uint16_t groupSequence;  // Random start, so nodes don't drop the first one after a reboot
+
+bool sendFrameToNode(uint8_t nodeId, const uint8_t *data, size_t len) {
+  // Unicast to the node's learned MAC so the radio ACKs and retries
+  if (!ensurePeer(nodeId)) {
+    LOGW(LogEspNow, "No peer registered for node %d", nodeId);
+    return false;
+  }
+  
+  // Queued first, the send callback may run before esp_now_send() returns.
+  // A frame the radio refused leaves an entry behind; onDataSent() skips it.
+  SentFrame sent;
+  sent.nodeId = nodeId;
+  memcpy(sent.mac, nodePeers[nodeId].mac, 6);
+  sentFrames.push(sent);
+  return esp_now_send(nodePeers[nodeId].mac, data, len) == ESP_OK;
+}
+
+uint8_t nodeProtocolVersion(uint8_t nodeId) {
+  return nodeVersions[nodeId];
+}
+
+static bool transmitControl(uint8_t nodeId, const ControlFrame &msg) {
+  if (!sendFrameToNode(nodeId, (const uint8_t *)&msg, sizeof(msg))) {
+    return false;
+  }
+  markControlSent(nodeId, msg.sequence);
+  return true;
+}
+
+static bool transmitGroup(const GroupFrame &msg) {
+  return ensureBroadcastPeer() &&
+         esp_now_send(broadcastMac, (const uint8_t *)&msg, sizeof(msg)) == ESP_OK;
+}
+
+// Asks every node in range to report now, so a restarted hub learns the
+// nodes and hands out its policy without waiting for their heartbeats.
+// No node is known yet, so this is sent once and not tracked.
+void requestNodeReports() {
+  GroupFrame msg;
+  initFrameHeader(msg.header, FRAME_GROUP, 0);
+  msg.targetMask = 0xFFFFFFFEUL;  // Every nodeId
+  msg.manualCommand = 0;
+  msg.flags = GROUP_FLAG_SYNC;
+  if (++groupSequence == 0) {
+    groupSequence = 1;
+  }
+  msg.sequence = groupSequence;
+  transmitGroup(msg);
+}
+
+// Tells the nodes which channel the hub is on. Without the broadcast peer
+// there is nobody to tell; ensurePeer() logged that once.
+static void transmitBeacon(uint8_t channel) {
+  BeaconFrame msg;
+  initFrameHeader(msg.header, FRAME_BEACON, 0);
+  msg.channel = channel;
+  if (ensureBroadcastPeer() &&
+      esp_now_send(broadcastMac, (const uint8_t *)&msg, sizeof(msg)) != ESP_OK) {
+    LOGW(LogEspNow, "Error sending beacon");
+  }
+  beaconChannel = channel;
+  lastBeacon = millis();
+}
+
+// Answers a DiscoverFrame; by unicast when the broadcast peer gave way to
+// the node peers
+static void answerDiscover(uint8_t nodeId, const uint8_t *mac) {
+  if (ensureBroadcastPeer()) {
+    transmitBeacon(WiFi.channel());
+    return;
+  }
+  const NodePeer &peer = nodePeers[nodeId];
+  if (!peer.known || memcmp(peer.mac, mac, 6) != 0) {
+    return;  // Not a peer we can reach without a free table entry
+  }
+  BeaconFrame msg;
+  initFrameHeader(msg.header, FRAME_BEACON, 0);
+  msg.channel = WiFi.channel();
+  if (!sendFrameToNode(nodeId, (const uint8_t *)&msg, sizeof(msg))) {
+    LOGW(LogEspNow, "Error sending beacon to node %d", nodeId);
+  }
+}
+
+// Runs before the display is up, so a failure is only reported to the caller
+bool initESPNow() {
+  // Station only: a soft AP would share the radio and send its own beacons.
+  // ESP-NOW runs on whatever channel the router uses, and the radio stays
+  // awake so frames are not missed between router beacons.
+  WiFi.mode(WIFI_STA);
+  WiFi.setSleep(false);
+  
+  // After a reset, listen on the router's channel right away; the nodes
+  // are still there and the cloud task reconnects without a scan
+  uint8_t channel = cachedWiFiChannel();
+  if (channel != 0) {
+    esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+  }
+  
   // Init ESP-NOW
   if (esp_now_init() != ESP_OK) {
-    Serial.println("Error initializing ESP-NOW");
-    return;
+    LOGE(LogEspNow, "ESP-NOW init failed");
+    return false;
   }
   
   // Register callbacks
   esp_now_register_recv_cb(onDataReceived);
   esp_now_register_send_cb(onDataSent);
+  
+  groupSequence = esp_random();
+  for (int i = 1; i <= MAX_GREENHOUSES; i++) {
+    lastSequence[i] = esp_random();
+  }
+  ensureBroadcastPeer();
+  
+  LOGI(LogEspNow, "ESP-NOW initialized on channel %u", WiFi.channel());
+  return true;
 }
 
 void sendControlToNode(uint8_t nodeId) {
@@ -28,101 +273,480 @@ void sendControlToNode(uint8_t nodeId) {
   }
   
   // Create control message
-  ControlMessage controlMsg;
-  controlMsg.targetNodeId = nodeId;
-  controlMsg.tempThreshold = greenhouses[nodeId].settings.temperatureThreshold;
-  controlMsg.hysteresis = greenhouses[nodeId].settings.hysteresis;
-  controlMsg.autoMode = greenhouses[nodeId].settings.autoMode;
+  ControlFrame controlMsg;
+  initFrameHeader(controlMsg.header, FRAME_CONTROL, nodeId);
+  controlMsg.tempThreshold = toFixed(greenhouses[nodeId].settings.temperatureThreshold, CENTI_SCALE);
+  controlMsg.hysteresis = toFixed(greenhouses[nodeId].settings.hysteresis, CENTI_SCALE);
+  controlMsg.flags = greenhouses[nodeId].settings.autoMode ? CONTROL_FLAG_AUTO_MODE : 0;
+  // Without the hub a manual-mode node follows its cached schedule events,
+  // or keeps the temperature in range if it has none
+  if (!hasActiveSchedule(nodeId)) {
+    controlMsg.flags |= CONTROL_FLAG_FALLBACK_AUTO;
+  }
   controlMsg.manualCommand = greenhouses[nodeId].settings.manualCommand;
+  controlMsg.ventTarget = greenhouses[nodeId].settings.ventTarget;
+  controlMsg.temperatureDeadband = toFixedByte(REPORT_DEADBAND_TEMPERATURE, CENTI_SCALE);
+  controlMsg.humidityDeadband = toFixedByte(REPORT_DEADBAND_HUMIDITY, DECI_SCALE);
+  controlMsg.pressureDeadband = toFixedByte(REPORT_DEADBAND_PRESSURE, DECI_SCALE);
+  controlMsg.heartbeatInterval = REPORT_HEARTBEAT_INTERVAL;
+  controlMsg.policyLease = POLICY_LEASE;
   
-  // ESP-NOW broadcast - the node will filter by ID
-  uint8_t broadcastAddress[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-  esp_now_peer_info_t peerInfo = {};
-  memcpy(peerInfo.peer_addr, broadcastAddress, 6);
-  peerInfo.channel = 0;
-  peerInfo.encrypt = false;
+  // Carry over a manual command the node has not acknowledged yet
+  PendingControl &pending = pendingControls[nodeId];
+  if (controlMsg.manualCommand == 0 && pending.active &&
+      ackedSequence[nodeId] != pending.msg.sequence) {
+    controlMsg.manualCommand = pending.msg.manualCommand;
+    controlMsg.ventTarget = pending.msg.ventTarget;
+  }
+  
+  // Nodes before version 7 only run the vent end to end
+  if (controlMsg.manualCommand == 'P' && nodeVersions[nodeId] < 7) {
+    if (controlMsg.ventTarget == 0) {
+      controlMsg.manualCommand = 'C';
+    } else if (controlMsg.ventTarget >= 100) {
+      controlMsg.manualCommand = 'O';
+    } else {
+      controlMsg.manualCommand = 0;
+      LOGW(LogEspNow, "Node %d cannot move its vent to %u%%", nodeId, controlMsg.ventTarget);
+    }
+  }
   
-  // Add peer
-  if (esp_now_is_peer_exist(broadcastAddress) == false) {
-    esp_now_add_peer(&peerInfo);
+  if (++lastSequence[nodeId] == 0) {
+    lastSequence[nodeId] = 1;
   }
+  controlMsg.sequence = lastSequence[nodeId];
   
-  // Send message
-  esp_err_t result = esp_now_send(broadcastAddress, (uint8_t *)&controlMsg, sizeof(controlMsg));
+  pending.msg = controlMsg;
+  pending.active = true;
+  pending.parked = false;
+  pending.attempts = 1;
+  pending.nextRetry = millis() + CONTROL_RETRY_INITIAL;
   
-  if (result == ESP_OK) {
-    Serial.println("Control message sent to node " + String(nodeId));
+  // Send message
+  if (transmitControl(nodeId, controlMsg)) {
+    LOGI(LogEspNow, "Control message %u sent to node %d", controlMsg.sequence, nodeId);
   } else {
-    Serial.println("Error sending control message");
+    LOGW(LogEspNow, "Error sending control message to node %d", nodeId);
   }
   
-  // Clear manual command after sending
+  // Clear manual command after sending; the retransmit slot keeps it
   greenhouses[nodeId].settings.manualCommand = 0;
+  greenhouses[nodeId].settings.ventTarget = 0;
 }
 
-void sendControlToAllNodes(char command) {
-  Serial.print("Sending command to all nodes: ");
-  Serial.println(command);
+// Hands nodes that have not acknowledged a group command over to the
+// unicast path, which retries per node and waits for duty-cycled nodes.
+// Commands are idempotent, so a node that did get the broadcast after all
+// just runs it again.
+static void sendGroupUnicast(PendingGroup &group, uint32_t nodeMask) {
+  for (uint32_t pending = group.unacked & nodeMask; pending != 0; pending &= pending - 1) {
+    uint8_t i = __builtin_ctz(pending);
+    group.unacked &= ~(1UL << i);
+    greenhouses[i].settings.manualCommand = group.msg.manualCommand;
+    sendControlToNode(i);
+  }
+}
+
+// Free slot, or the one holding the oldest command after handing it over
+static PendingGroup &claimGroupSlot() {
+  PendingGroup *oldest = &pendingGroups[0];
+  for (PendingGroup &group : pendingGroups) {
+    if (group.unacked == 0) {
+      return group;
+    }
+    if ((int16_t)(group.msg.sequence - oldest->msg.sequence) < 0) {
+      oldest = &group;
+    }
+  }
+  sendGroupUnicast(*oldest, 0xFFFFFFFFUL);
+  return *oldest;
+}
+
+void sendGroupCommand(uint32_t nodeMask, char command, GroupMode mode) {
+  // The command must not overtake an older one still on its way to a node
+  for (PendingGroup &group : pendingGroups) {
+    sendGroupUnicast(group, nodeMask);
+  }
   
-  for (int i = 1; i <= MAX_GREENHOUSES; i++) {
-    // Skip nodes that are offline
-    if (!greenhouses[i].isOnline || 
-        (millis() - greenhouses[i].lastSeen > 300000)) {
+  uint32_t groupMask = 0;
+  uint32_t changedMask = 0;
+  for (uint32_t pending = nodeMask; pending != 0; pending &= pending - 1) {
+    uint8_t i = __builtin_ctz(pending);
+    if (!greenhouses[i].isOnline) {
+      continue;
+    }
+    
+    bool autoMode = mode == GROUP_MODE_AUTO || (mode == GROUP_MODE_KEEP && greenhouses[i].settings.autoMode);
+    if (autoMode != greenhouses[i].settings.autoMode) {
+      greenhouses[i].settings.autoMode = autoMode;
+      greenhouses[i].dirtyFields |= DIRTY_MODE;
+      changedMask |= 1UL << i;
+    }
+    
+    // Nodes before version 3 ignore a GroupFrame, and before version 8 its
+    // auto mode flag. A unicast message still in flight would override the
+    // group command when retransmitted, so those nodes get the command (and
+    // the mode, which every ControlFrame carries) in a new unicast message.
+    const PendingControl &control = pendingControls[i];
+    bool controlInFlight = control.active && ackedSequence[i] != control.msg.sequence;
+    uint8_t minVersion = mode == GROUP_MODE_AUTO ? 8 : 3;
+    if (nodeVersions[i] >= minVersion && !controlInFlight) {
+      groupMask |= 1UL << i;
+    } else {
+      greenhouses[i].settings.manualCommand = command;
+      sendControlToNode(i);
+    }
+  }
+  saveChangedSettingsToEEPROM(changedMask);
+  
+  if (groupMask == 0) {
+    return;
+  }
+  
+  if (++groupSequence == 0) {
+    groupSequence = 1;
+  }
+  
+  PendingGroup &group = claimGroupSlot();
+  GroupFrame &msg = group.msg;
+  initFrameHeader(msg.header, FRAME_GROUP, 0);
+  msg.targetMask = groupMask;
+  msg.manualCommand = command;
+  msg.flags = mode == GROUP_MODE_MANUAL ? GROUP_FLAG_MANUAL_MODE :
+              mode == GROUP_MODE_AUTO ? GROUP_FLAG_AUTO_MODE : 0;
+  msg.sequence = groupSequence;
+  group.unacked = groupMask;
+  group.attempts = 1;
+  group.nextRetry = millis() + CONTROL_RETRY_INITIAL;
+  
+  if (transmitGroup(msg)) {
+    LOGI(LogEspNow, "Group command %u (%c) sent to %d nodes", msg.sequence,
+         command != 0 ? command : '-', __builtin_popcount(groupMask));
+  } else {
+    LOGW(LogEspNow, "Error sending group command, using unicast");
+    sendGroupUnicast(group, 0xFFFFFFFFUL);
+  }
+}
+
+// Resends a group command to the nodes that have not acknowledged it,
+// then falls back to unicast for the rest
+static void processGroupRetransmit(PendingGroup &group, unsigned long currentMillis) {
+  if (group.unacked == 0 || (long)(currentMillis - group.nextRetry) < 0) {
+    return;
+  }
+  
+  if (group.attempts >= GROUP_MAX_ATTEMPTS) {
+    LOGW(LogEspNow, "Group command %u not acknowledged by %d nodes, using unicast",
+         group.msg.sequence, __builtin_popcount(group.unacked));
+    sendGroupUnicast(group, 0xFFFFFFFFUL);
+    return;
+  }
+  
+  // Nodes that already acknowledged are left out of the retransmission
+  group.msg.targetMask = group.unacked;
+  if (!transmitGroup(group.msg)) {
+    sendGroupUnicast(group, 0xFFFFFFFFUL);
+    return;
+  }
+  group.nextRetry = currentMillis + ((unsigned long)CONTROL_RETRY_INITIAL << group.attempts);
+  group.attempts++;
+}
+
+// Resends unacknowledged control messages with exponential backoff
+void processControlRetransmits() {
+  unsigned long currentMillis = millis();
+  
+  for (uint8_t n = 0; n < activeNodeCount; n++) {
+    uint8_t i = activeNodes[n];
+    PendingControl &pending = pendingControls[i];
+    if (!pending.active) {
       continue;
     }
     
-    // Set the command for each greenhouse
-    greenhouses[i].settings.manualCommand = command;
+    if (ackedSequence[i] == pending.msg.sequence) {
+      pending.active = false;
+      continue;
+    }
     
-    // Also set to manual mode temporarily if opening/closing all
-    if (command == 'O' || command == 'C') {
-      greenhouses[i].settings.autoMode = false;
+    if ((long)(currentMillis - pending.nextRetry) < 0) {
+      continue;
     }
     
-    // Send the command to the node
-    sendControlToNode(i);
+    if (pending.attempts >= CONTROL_MAX_ATTEMPTS) {
+      if (!pending.parked) {
+        pending.parked = true;
+        LOGW(LogEspNow, "Control message to node %d not acknowledged, holding it", i);
+      }
+      continue;
+    }
+    
+    transmitControl(i, pending.msg);
+    pending.nextRetry = currentMillis + ((unsigned long)CONTROL_RETRY_INITIAL << pending.attempts);
+    pending.attempts++;
   }
   
-  // Update Firebase with new states
-  if (WiFi.status() == WL_CONNECTED && Firebase.ready()) {
-    FirebaseJson json;
-    json.set("action", String(command == 'O' ? "open" : "close"));
-    json.set("timestamp", (uint32_t)millis());
-    Firebase.RTDB.setJSON(&fbdo, "/system/lastControlAll", &json);
+  for (PendingGroup &group : pendingGroups) {
+    processGroupRetransmit(group, currentMillis);
   }
 }
 
-void onDataReceived(const uint8_t *mac, const uint8_t *data, int len) {
-  if (len == sizeof(SensorData)) {
-    // Copy data
-    SensorData* receivedData = (SensorData*)data;
+// Resends a still unacknowledged control message as soon as its node reports.
+// Duty-cycled nodes only listen briefly after sending, so this is the one
+// moment they are sure to hear it.
+static void deliverPendingControl(uint8_t nodeId) {
+  PendingControl &pending = pendingControls[nodeId];
+  if (!pending.active || ackedSequence[nodeId] == pending.msg.sequence) {
+    return;
+  }
+  
+  transmitControl(nodeId, pending.msg);
+  pending.parked = false;
+  pending.attempts = 1;
+  pending.nextRetry = millis() + CONTROL_RETRY_INITIAL;
+}
+
+static uint32_t onlineNodeMask() {
+  uint32_t nodeMask = 0;
+  for (uint8_t n = 0; n < activeNodeCount; n++) {
+    uint8_t i = activeNodes[n];
+    // Skip nodes that are offline
+    if (!greenhouses[i].isOnline || 
+        (millis() - greenhouses[i].lastSeen > 300000)) {
+      continue;
+    }
+    nodeMask |= 1UL << i;
+  }
+  return nodeMask;
+}
+
+void sendControlToAllNodes(char command) {
+  LOGI(LogEspNow, "Sending command to all nodes: %c", command);
+  
+  // One broadcast for every vent; opening or closing all also leaves
+  // automatic mode
+  sendGroupCommand(onlineNodeMask(), command,
+                   command == 'O' || command == 'C' ? GROUP_MODE_MANUAL : GROUP_MODE_KEEP);
+  
+  // Record the action in Firebase from the cloud sync task
+  ControlAllEvent event;
+  event.command = command;
+  event.timestamp = millis();
+  controlAllQueue.push(event);
+}
+
+// Offline nodes are switched too; they get the mode with the full policy
+// when they next report
+void sendAutoModeToAllNodes() {
+  LOGI(LogEspNow, "Switching all nodes to automatic mode");
+  
+  uint32_t changedMask = 0;
+  for (uint8_t n = 0; n < activeNodeCount; n++) {
+    uint8_t i = activeNodes[n];
+    if (!greenhouses[i].settings.autoMode) {
+      greenhouses[i].settings.autoMode = true;
+      greenhouses[i].dirtyFields |= DIRTY_MODE;
+      changedMask |= 1UL << i;
+    }
+  }
+  saveChangedSettingsToEEPROM(changedMask);
+  sendGroupCommand(onlineNodeMask(), 0, GROUP_MODE_AUTO);
+}
+
+// The station moves to the router's channel when it (re)connects, so the
+// channel is checked every pass and announced at once when it changed.
+// Reconnect attempts scan all channels, so changes in between are not
+// announced.
+void serviceBeacon() {
+  uint8_t channel = WiFi.channel();
+  if (channel != beaconChannel && isWiFiConnected()) {
+    LOGI(LogEspNow, "ESP-NOW on channel %u", channel);
+    transmitBeacon(channel);
+  } else if (millis() - lastBeacon >= BEACON_INTERVAL) {
+    transmitBeacon(channel);
+  }
+}
+
+// Decodes one queued frame; runs in the main loop, which owns greenhouses[]
+static void processFrame(const RxFrame &rx) {
+  const uint8_t *data = rx.data;
+  uint8_t frameType = parseFrameType(data, rx.len);
+  
+  // A node searching the channels; the beacon tells it where the hub is
+  if (frameType == FRAME_DISCOVER) {
+    DiscoverFrame discover;
+    readFrame(&discover, sizeof(discover), data, rx.len);
+    if (!isValidNodeId(discover.header.nodeId)) {
+      countFrameRejected(0);
+      return;
+    }
+    countFrameReceived(discover.header.nodeId);
+    LOGD(LogEspNow, "Node %d searching for the hub", discover.header.nodeId);
+    answerDiscover(discover.header.nodeId, rx.mac);
+    return;
+  }
+  
+  if (frameType == FRAME_ACK) {
+    AckFrame ack;
+    readFrame(&ack, sizeof(ack), data, rx.len);
+    if (!isValidNodeId(ack.header.nodeId)) {
+      countFrameRejected(0);
+    } else if (ack.acked == FRAME_GROUP) {
+      for (PendingGroup &group : pendingGroups) {
+        if (ack.sequence == group.msg.sequence) {
+          group.unacked &= ~(1UL << ack.header.nodeId);
+        }
+      }
+      countFrameReceived(ack.header.nodeId);
+    } else if (ack.acked == FRAME_SCHEDULE) {
+      onScheduleAck(ack.header.nodeId, ack.sequence);
+      countFrameReceived(ack.header.nodeId);
+    } else {
+      ackedSequence[ack.header.nodeId] = ack.sequence;
+      countFrameReceived(ack.header.nodeId);
+      markControlAcked(ack.header.nodeId, ack.sequence, rx.receivedAt);
+    }
+    return;
+  }
+  
+  if (frameType == FRAME_SENSOR) {
+    SensorFrame frame;
+    readFrame(&frame, sizeof(frame), data, rx.len);
     
     // Validate node ID
-    if (receivedData->nodeId < 1 || receivedData->nodeId > MAX_GREENHOUSES) {
+    if (!isValidNodeId(frame.header.nodeId)) {
+      countFrameRejected(0);
+      return;
+    }
+    
+    uint8_t nodeId = frame.header.nodeId;
+    
+    // Decode fixed-point readings
+    SensorData received;
+    received.nodeId = nodeId;
+    received.temperature = fromFixed(frame.temperature, CENTI_SCALE);
+    received.humidity = fromFixed(frame.humidity, CENTI_SCALE);
+    received.pressure = fromFixed(frame.pressure, DECI_SCALE);
+    received.ventStatus = frame.ventStatus;
+    received.timestamp = frame.timestamp;
+    received.ventPosition = frame.ventPosition;
+    received.motorSeconds = frame.motorSeconds;
+    received.motorCycles = frame.motorCycles;
+    if (frame.header.version < 7) {
+      // No position estimate before version 7; the status is all there is
+      received.ventPosition = frame.ventStatus == 0 ? 0 : 100;
+    }
+    
+    if (!validateSensorData(received)) {
+      countFrameRejected(nodeId);
+      LOGW(LogEspNow, "Rejected implausible data from node %d", nodeId);
       return;
     }
     
-    uint8_t nodeId = receivedData->nodeId;
+    // Flag changed fields for the next Firebase delta sync
+    const SensorData &previous = greenhouses[nodeId].sensor;
+    bool cameOnline = !greenhouses[nodeId].isOnline;
+    uint16_t changed = 0;
+    if (cameOnline) {
+      changed = DIRTY_ALL;  // First frame after going online, upload everything
+    } else {
+      if (received.temperature != previous.temperature) changed |= DIRTY_TEMPERATURE;
+      if (received.humidity != previous.humidity) changed |= DIRTY_HUMIDITY;
+      if (received.pressure != previous.pressure) changed |= DIRTY_PRESSURE;
+      if (received.ventStatus != previous.ventStatus) changed |= DIRTY_VENT_STATUS;
+      if (received.ventPosition != previous.ventPosition) changed |= DIRTY_VENT_POSITION;
+      if (received.motorSeconds != previous.motorSeconds ||
+          received.motorCycles != previous.motorCycles) changed |= DIRTY_MOTOR_STATS;
+      if (changed != 0) changed |= DIRTY_TIMESTAMP;
+    }
+    
+    countFrameReceived(nodeId);
+    if (registerNode(nodeId)) {
+      LOGI(LogEspNow, "Registered node %d", nodeId);
+    }
+    learnPeer(nodeId, rx.mac);
+    nodeVersions[nodeId] = frame.header.version;
+    ackedSequence[nodeId] = frame.ackSequence;
+    deliverPendingControl(nodeId);
+    
+    // The node is listening now but missed a group command
+    for (PendingGroup &group : pendingGroups) {
+      sendGroupUnicast(group, 1UL << nodeId);
+    }
     
     // Update data
-    greenhouses[nodeId].sensor = *receivedData;
+    greenhouses[nodeId].sensor = received;
+    greenhouses[nodeId].dirtyFields |= changed;
     greenhouses[nodeId].isOnline = true;
     greenhouses[nodeId].lastSeen = millis();
+    queueHistorySample(nodeId, received);
+    pushLocalSensorUpdate(nodeId);
+    displayRefreshRequested = true;
+    
+    // A node that (re)joins, or asks to reconcile after its lease lapsed or
+    // a reset, gets the whole policy in answer to this one report
+    bool reconcile = cameOnline || (frame.flags & SENSOR_FLAG_RECONCILE);
+    if (reconcile) {
+      sendControlToNode(nodeId);
+    }
+    deliverSchedule(nodeId, reconcile);
     
-    Serial.print("Data received from node ");
-    Serial.print(nodeId);
-    Serial.print(": Temp=");
-    Serial.print(receivedData->temperature);
-    Serial.print("°C, Humidity=");
-    Serial.print(receivedData->humidity);
-    Serial.print("%, Pressure=");
-    Serial.print(receivedData->pressure);
-    Serial.print("hPa, Vent=");
-    Serial.println(receivedData->ventStatus);
+    LOGD(LogEspNow, "Data from node %d: Temp=%.2f°C, Humidity=%.2f%%, Pressure=%.1fhPa, Vent=%u",
+         nodeId, received.temperature, received.humidity, received.pressure, received.ventStatus);
+    return;
+  }
+  
+  // Unknown type, or a frame too short for its header
+  countFrameRejected(0);
+}
+
+// Runs in the Wi-Fi task: only copy the frame out, all work happens in
+// processReceivedFrames() on the main loop
+void onDataReceived(const uint8_t *mac, const uint8_t *data, int len) {
+  SectionTimer timer(SECTION_ESPNOW_RX);
+  if (len <= 0) {
+    return;
+  }
+  
+  RxFrame rx;
+  memcpy(rx.mac, mac, 6);
+  rx.receivedAt = micros();
+  rx.len = len < RX_FRAME_MAX ? len : RX_FRAME_MAX;  // Newer versions only append fields
+  memcpy(rx.data, data, rx.len);
+  
+  if (!rxQueue.push(rx)) {
+    countFrameDropped();
+  }
+}
+
+void processReceivedFrames() {
+  SectionTimer timer(SECTION_FRAME_PROCESS);
+  RxFrame rx;
+  while (rxQueue.pop(rx)) {
+    processFrame(rx);
   }
 }
 
 void onDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
-  Serial.print("ESP-NOW send status: ");
-  Serial.println(status == ESP_NOW_SEND_SUCCESS ? "Success" : "Failed");
+  // Broadcasts are not acknowledged by the radio, GroupFrame ACKs cover them
+  if (memcmp(mac_addr, broadcastMac, 6) == 0) {
+    return;
+  }
+  
+  // Unicast status reflects the MAC-layer ACK after hardware retries
+  int nodeId = 0;
+  SentFrame sent;
+  while (sentFrames.pop(sent)) {
+    if (memcmp(sent.mac, mac_addr, 6) == 0) {
+      nodeId = sent.nodeId;
+      break;
+    }
+  }
+  bool delivered = status == ESP_NOW_SEND_SUCCESS;
+  countSendResult(nodeId, delivered);
+  
+  if (delivered) {
+    LOGD(LogEspNow, "ESP-NOW send to node %d delivered", nodeId);
+  } else {
+    LOGW(LogEspNow, "ESP-NOW send to node %d failed", nodeId);
+  }
 }
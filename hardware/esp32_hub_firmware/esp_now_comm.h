@@ -0,0 +1,29 @@
+#ifndef ESP_NOW_COMM_H
+#define ESP_NOW_COMM_H
+
+#include <esp_now.h>
+#include "data_structures.h"
+
+// Mode change carried by a group command
+enum GroupMode : uint8_t {
+  GROUP_MODE_KEEP,
+  GROUP_MODE_MANUAL,  // Open/close all: the nodes leave automatic mode
+  GROUP_MODE_AUTO     // Auto mode all
+};
+
+// Function declarations
+bool initESPNow();
+void requestNodeReports();  // Hub start: every node in range reports at once
+void sendControlToNode(uint8_t nodeId);
+void sendControlToAllNodes(char command);
+void sendAutoModeToAllNodes();
+void sendGroupCommand(uint32_t nodeMask, char command, GroupMode mode);  // Bit per nodeId, one broadcast
+bool sendFrameToNode(uint8_t nodeId, const uint8_t *data, size_t len);    // Unicast, no retransmits
+uint8_t nodeProtocolVersion(uint8_t nodeId);                              // From its last report, 0 if none
+void processControlRetransmits();
+void serviceBeacon();  // Main loop, announces the channel to the nodes
+void processReceivedFrames();
+void onDataReceived(const uint8_t *mac, const uint8_t *data, int len);
+void onDataSent(const uint8_t *mac_addr, esp_now_send_status_t status);
+
+#endif
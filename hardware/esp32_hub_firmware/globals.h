@@ -6,37 +6,25 @@
 #include "config.h"
 
 // Timing control
-extern unsigned long lastFirebaseSync;
-extern unsigned long lastButtonCheck;
 extern unsigned long lastDisplayUpdate;
 extern unsigned long lastMenuActivity;
-extern unsigned long selectPressStart;
-
-// Button state
-extern bool buttonUpPressed;
-extern bool buttonSelectPressed;
-extern bool buttonDownPressed;
-extern bool buttonUpLast;
-extern bool buttonSelectLast;
-extern bool buttonDownLast;
-extern bool selectLongPressed;
-extern bool selectCurrentlyPressed;
+extern bool displayRefreshRequested;  // Redraw on the next loop pass
 
 // Menu system
 extern MenuState currentMenu;
 extern uint8_t selectedGreenhouse;
-extern uint8_t settingSelection;
 extern uint8_t scheduleSelection;
 extern uint8_t controlAllSelection;
-extern bool editingValue;
 
 // Greenhouse data
 extern GreenhouseData greenhouses[MAX_GREENHOUSES + 1];
 
 // Function declarations from other modules
-void saveSettingsToEEPROM();
+void saveChangedSettingsToEEPROM(uint32_t nodeMask);
 void loadSettingsFromEEPROM();
 void sendControlToNode(uint8_t nodeId);
 void sendControlToAllNodes(char command);
+void displayError(const char* message);
+bool validateSensorData(const SensorData& data);
 
 #endif
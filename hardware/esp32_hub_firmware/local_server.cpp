@@ -0,0 +1,362 @@
+#include "local_server.h"
+#include "globals.h"
+#include "metrics.h"
+#include "node_registry.h"
+#include "log_modules.h"
+#include <ESPAsyncWebServer.h>
+
+#define API_GREENHOUSES "/api/greenhouses"
+
+SpscRing<CloudCommand, CLOUD_QUEUE_SIZE> localCommandQueue;
+
+static AsyncWebServer server(LOCAL_SERVER_PORT);
+static AsyncWebSocket ws("/ws");
+
+// Copy of greenhouses[] for the handlers. The main loop writes it and the
+// handlers read it under the lock, one greenhouse at a time.
+static GreenhouseData localState[MAX_GREENHOUSES + 1];
+static uint32_t localRegistered = 0;  // Bit per registered nodeId
+static portMUX_TYPE localStateLock = portMUX_INITIALIZER_UNLOCKED;
+static unsigned long lastStateRefresh = 0;
+
+// ----- ASYNCTCP TASK -----
+static bool readGreenhouse(uint8_t nodeId, GreenhouseData &out) {
+  portENTER_CRITICAL(&localStateLock);
+  bool registered = (localRegistered & (1UL << nodeId)) != 0;
+  if (registered) {
+    out = localState[nodeId];
+  }
+  portEXIT_CRITICAL(&localStateLock);
+  return registered;
+}
+
+static int formatGreenhouse(char *buffer, size_t size, uint8_t nodeId, const GreenhouseData &gh) {
+  const GreenhouseSettings &settings = gh.settings;
+  return snprintf(buffer, size,
+                  "{\"id\":%u,\"online\":%s,\"lastSeen\":%lu,"
+                  "\"temperature\":%.2f,\"humidity\":%.2f,\"pressure\":%.1f,\"ventStatus\":\"%s\","
+                  "\"ventPosition\":%u,\"motorSeconds\":%lu,\"motorCycles\":%lu,"
+                  "\"settings\":{\"temperatureThreshold\":%.2f,\"hysteresis\":%.2f,\"mode\":\"%s\","
+                  "\"schedule\":{\"openHour\":%u,\"openMinute\":%u,\"closeHour\":%u,\"closeMinute\":%u,"
+                  "\"enabled\":%s}}}",
+                  nodeId, gh.isOnline ? "true" : "false", (unsigned long)gh.lastSeen,
+                  gh.sensor.temperature, gh.sensor.humidity, gh.sensor.pressure,
+                  ventStatusName(gh.sensor.ventStatus), gh.sensor.ventPosition,
+                  (unsigned long)gh.sensor.motorSeconds, (unsigned long)gh.sensor.motorCycles,
+                  settings.temperatureThreshold, settings.hysteresis, settings.autoMode ? "auto" : "manual",
+                  settings.schedule.openHour, settings.schedule.openMinute,
+                  settings.schedule.closeHour, settings.schedule.closeMinute,
+                  settings.schedule.scheduleEnabled ? "true" : "false");
+}
+
+static void sendError(AsyncWebServerRequest *request, int code, const char *message) {
+  char body[64];
+  snprintf(body, sizeof(body), "{\"error\":\"%s\"}", message);
+  request->send(code, "application/json", body);
+}
+
+// Query string first, then a form-encoded body
+static const AsyncWebParameter *findParam(AsyncWebServerRequest *request, const char *name) {
+  if (request->hasParam(name)) {
+    return request->getParam(name);
+  }
+  if (request->hasParam(name, true)) {
+    return request->getParam(name, true);
+  }
+  return NULL;
+}
+
+// Compares every byte, so the time taken does not tell how much matched
+static bool tokenMatches(const char *given) {
+  static const char expected[] = LOCAL_API_TOKEN;
+  size_t length = strlen(given);
+  uint8_t difference = length != sizeof(expected) - 1;
+  for (size_t i = 0; i < sizeof(expected) - 1; i++) {
+    difference |= expected[i] ^ (i < length ? given[i] : 0);
+  }
+  return difference == 0;
+}
+
+static bool authorized(AsyncWebServerRequest *request) {
+  if (request->hasHeader("Authorization")) {
+    const String &value = request->header("Authorization");
+    return strncmp(value.c_str(), "Bearer ", 7) == 0 && tokenMatches(value.c_str() + 7);
+  }
+  const AsyncWebParameter *param = findParam(request, "token");
+  return param != NULL && tokenMatches(param->value().c_str());
+}
+
+static bool parseFloat(const AsyncWebParameter *param, float minimum, float maximum, float &value) {
+  const char *text = param->value().c_str();
+  char *end;
+  value = strtof(text, &end);
+  return end != text && *end == '\0' && value >= minimum && value <= maximum;
+}
+
+// "HH:MM"
+static bool parseTimeOfDay(const AsyncWebParameter *param, uint8_t &hour, uint8_t &minute) {
+  unsigned int h, m;
+  char extra;
+  if (sscanf(param->value().c_str(), "%u:%u%c", &h, &m, &extra) != 2 || h > 23 || m > 59) {
+    return false;
+  }
+  hour = h;
+  minute = m;
+  return true;
+}
+
+// All or nothing, so a full queue never leaves an update half applied.
+// This task is the only producer, so the space checked cannot shrink.
+static void queueCommands(AsyncWebServerRequest *request, const CloudCommand *commands, int count) {
+  if (localCommandQueue.space() < (size_t)count) {
+    sendError(request, 503, "busy");
+    return;
+  }
+  for (int n = 0; n < count; n++) {
+    localCommandQueue.push(commands[n]);
+  }
+  request->send(202, "application/json", "{\"queued\":true}");
+}
+
+static void listGreenhouses(AsyncWebServerRequest *request) {
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  char item[384];
+  bool first = true;
+
+  response->print('[');
+  for (int i = 1; i <= MAX_GREENHOUSES; i++) {
+    GreenhouseData gh;
+    if (!readGreenhouse(i, gh)) {
+      continue;
+    }
+    if (!first) {
+      response->print(',');
+    }
+    formatGreenhouse(item, sizeof(item), i, gh);
+    response->print(item);
+    first = false;
+  }
+  response->print(']');
+  request->send(response);
+}
+
+static void updateSettings(AsyncWebServerRequest *request, uint8_t nodeId, const GreenhouseData &gh) {
+  CloudCommand commands[4] = {};
+  int count = 0;
+  const AsyncWebParameter *param;
+
+  // Same limits the nodes apply to stored settings
+  if ((param = findParam(request, "temperatureThreshold")) != NULL) {
+    CloudCommand &command = commands[count++];
+    command.nodeId = nodeId;
+    command.type = CLOUD_SET_THRESHOLD;
+    if (!parseFloat(param, 0, 50, command.value)) {
+      sendError(request, 400, "temperatureThreshold must be 0-50");
+      return;
+    }
+  }
+
+  if ((param = findParam(request, "hysteresis")) != NULL) {
+    CloudCommand &command = commands[count++];
+    command.nodeId = nodeId;
+    command.type = CLOUD_SET_HYSTERESIS;
+    if (!parseFloat(param, 0, 5, command.value)) {
+      sendError(request, 400, "hysteresis must be 0-5");
+      return;
+    }
+  }
+
+  if ((param = findParam(request, "mode")) != NULL) {
+    CloudCommand &command = commands[count++];
+    command.nodeId = nodeId;
+    command.type = CLOUD_SET_MODE;
+    command.autoMode = param->value() == "auto";
+    if (!command.autoMode && param->value() != "manual") {
+      sendError(request, 400, "mode must be auto or manual");
+      return;
+    }
+  }
+
+  // Schedule fields left out keep their current value
+  ScheduleSettings schedule = gh.settings.schedule;
+  bool scheduleGiven = false;
+  if ((param = findParam(request, "scheduleOpen")) != NULL) {
+    scheduleGiven = true;
+    if (!parseTimeOfDay(param, schedule.openHour, schedule.openMinute)) {
+      sendError(request, 400, "scheduleOpen must be HH:MM");
+      return;
+    }
+  }
+  if ((param = findParam(request, "scheduleClose")) != NULL) {
+    scheduleGiven = true;
+    if (!parseTimeOfDay(param, schedule.closeHour, schedule.closeMinute)) {
+      sendError(request, 400, "scheduleClose must be HH:MM");
+      return;
+    }
+  }
+  if ((param = findParam(request, "scheduleEnabled")) != NULL) {
+    scheduleGiven = true;
+    schedule.scheduleEnabled = param->value() == "true";
+    if (!schedule.scheduleEnabled && param->value() != "false") {
+      sendError(request, 400, "scheduleEnabled must be true or false");
+      return;
+    }
+  }
+  if (scheduleGiven) {
+    CloudCommand &command = commands[count++];
+    command.nodeId = nodeId;
+    command.type = CLOUD_SET_SCHEDULE;
+    command.schedule = schedule;
+  }
+
+  if (count == 0) {
+    sendError(request, 400, "no settings given");
+    return;
+  }
+  queueCommands(request, commands, count);
+}
+
+static void runCommand(AsyncWebServerRequest *request, uint8_t nodeId, const GreenhouseData &gh) {
+  const AsyncWebParameter *param = findParam(request, "action");
+  CloudCommand command = {};
+  command.nodeId = nodeId;
+  command.type = CLOUD_MANUAL_COMMAND;
+  command.manualCommand = param != NULL ? manualCommandFor(param->value().c_str()) : 0;
+
+  // A position moves the vent there instead of end to end
+  if (param == NULL && (param = findParam(request, "position")) != NULL) {
+    float position;
+    if (!parseFloat(param, 0, 100, position) || position != (int)position) {
+      sendError(request, 400, "position must be 0-100");
+      return;
+    }
+    command.manualCommand = 'P';
+    command.value = position;
+  }
+
+  if (command.manualCommand == 0) {
+    sendError(request, 400, "action must be open, close or stop");
+    return;
+  }
+  if (!gh.isOnline) {
+    sendError(request, 409, "greenhouse offline");
+    return;
+  }
+  queueCommands(request, &command, 1);
+}
+
+// Routes /api/greenhouses[/<id>[/settings|/command]]
+static void handleGreenhouses(AsyncWebServerRequest *request) {
+  if (!authorized(request)) {
+    sendError(request, 401, "unauthorized");
+    return;
+  }
+  const char *route = request->url().c_str() + strlen(API_GREENHOUSES);
+
+  if (*route == '\0' || strcmp(route, "/") == 0) {
+    if (request->method() != HTTP_GET) {
+      sendError(request, 405, "method not allowed");
+      return;
+    }
+    listGreenhouses(request);
+    return;
+  }
+
+  char *end;
+  long nodeId = strtol(route + 1, &end, 10);
+  GreenhouseData gh;
+  if (end == route + 1 || !isValidNodeId(nodeId) || !readGreenhouse(nodeId, gh)) {
+    sendError(request, 404, "unknown greenhouse");
+    return;
+  }
+
+  if (*end == '\0' && request->method() == HTTP_GET) {
+    char body[384];
+    formatGreenhouse(body, sizeof(body), nodeId, gh);
+    request->send(200, "application/json", body);
+  } else if (strcmp(end, "/settings") == 0 && request->method() == HTTP_POST) {
+    updateSettings(request, nodeId, gh);
+  } else if (strcmp(end, "/command") == 0 && request->method() == HTTP_POST) {
+    runCommand(request, nodeId, gh);
+  } else {
+    sendError(request, 404, "not found");
+  }
+}
+
+static void handleMetrics(AsyncWebServerRequest *request) {
+  if (!authorized(request)) {
+    sendError(request, 401, "unauthorized");
+    return;
+  }
+  static char metrics[METRICS_JSON_MAX];  // Handlers all run in the AsyncTCP task
+  if (formatMetricsJson(metrics, sizeof(metrics)) == 0) {
+    sendError(request, 500, "metrics unavailable");
+    return;
+  }
+  request->send(200, "application/json", metrics);
+}
+
+void initLocalServer() {
+  ws.handleHandshake([](AsyncWebServerRequest *request) {
+    return authorized(request);  // Refused with 401
+  });
+  server.addHandler(&ws);
+  server.on(API_GREENHOUSES, HTTP_ANY, handleGreenhouses);  // Also matches the paths below it
+  server.on("/metrics", HTTP_GET, handleMetrics);
+  server.onNotFound([](AsyncWebServerRequest *request) {
+    sendError(request, 404, "not found");
+  });
+  server.begin();
+  LOGI(LogCloud, "Local HTTP server started on port %d", LOCAL_SERVER_PORT);
+}
+
+// ----- MAIN LOOP -----
+void publishLocalState(uint32_t nodeMask) {
+  uint32_t registered = 0;
+  for (uint8_t n = 0; n < activeNodeCount; n++) {
+    registered |= 1UL << activeNodes[n];
+  }
+
+  for (uint32_t pending = nodeMask & registered; pending != 0; pending &= pending - 1) {
+    int i = __builtin_ctz(pending);
+    portENTER_CRITICAL(&localStateLock);
+    localState[i] = greenhouses[i];
+    portEXIT_CRITICAL(&localStateLock);
+  }
+
+  portENTER_CRITICAL(&localStateLock);
+  localRegistered = registered;
+  portEXIT_CRITICAL(&localStateLock);
+}
+
+void pushLocalSensorUpdate(uint8_t nodeId) {
+  publishLocalState(1UL << nodeId);
+  if (ws.count() == 0) {
+    return;
+  }
+
+  const SensorData &sensor = greenhouses[nodeId].sensor;
+  char message[192];
+  int length = snprintf(message, sizeof(message),
+                        "{\"type\":\"sensor\",\"id\":%u,\"temperature\":%.2f,\"humidity\":%.2f,"
+                        "\"pressure\":%.1f,\"ventStatus\":\"%s\",\"ventPosition\":%u,\"timestamp\":%lu}",
+                        nodeId, sensor.temperature, sensor.humidity, sensor.pressure,
+                        ventStatusName(sensor.ventStatus), sensor.ventPosition,
+                        (unsigned long)sensor.timestamp);
+  if (length > 0 && length < (int)sizeof(message)) {
+    ws.textAll(message, length);
+  }
+}
+
+// Picks up changes the main loop makes without a sensor frame (menu edits,
+// nodes going offline) and drops closed WebSocket clients
+void serviceLocalServer() {
+  unsigned long currentMillis = millis();
+  if (currentMillis - lastStateRefresh < LOCAL_STATE_REFRESH) {
+    return;
+  }
+  lastStateRefresh = currentMillis;
+
+  publishLocalState(0xFFFFFFFFUL);
+  ws.cleanupClients();
+}
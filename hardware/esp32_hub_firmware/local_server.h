@@ -0,0 +1,35 @@
+#ifndef LOCAL_SERVER_H
+#define LOCAL_SERVER_H
+
+#include "config.h"
+#include "data_structures.h"
+#include <ring_buffer.h>
+
+// Local HTTP/WebSocket API on the hub's LAN address, so dashboards on site
+// keep working without internet and skip the Firebase round trip. Handlers run in the AsyncTCP task: they read a snapshot of
+// greenhouses[] published by the main loop and queue changes for it, so
+// commands reach the nodes through sendControlToNode() like cloud commands.
+//
+//   GET  /api/greenhouses               All registered greenhouses
+//   GET  /api/greenhouses/<id>          One greenhouse
+//   POST /api/greenhouses/<id>/settings temperatureThreshold, hysteresis, mode (auto|manual),
+//                                       scheduleOpen, scheduleClose (HH:MM), scheduleEnabled
+//   POST /api/greenhouses/<id>/command  action (open|close|stop), or position (0-100, percent open)
+//   GET  /metrics                       Same JSON as /system/metrics (see metrics.h)
+//   WS   /ws                            Each sensor update as the main loop processes it
+//
+// Parameters are read from the query string or a form-encoded body.
+// Every request needs LOCAL_API_TOKEN, as "Authorization: Bearer <token>"
+// or a token parameter; browsers cannot set headers on a WebSocket, so /ws
+// takes ?token=<token>. Requests without it get 401.
+
+extern SpscRing<CloudCommand, CLOUD_QUEUE_SIZE> localCommandQueue;  // AsyncTCP -> loop
+
+void initLocalServer();
+
+// Main loop side
+void publishLocalState(uint32_t nodeMask);   // Copies these greenhouses into the snapshot
+void pushLocalSensorUpdate(uint8_t nodeId);  // Snapshot and WebSocket push for a new reading
+void serviceLocalServer();                   // Periodic snapshot refresh, WebSocket cleanup
+
+#endif
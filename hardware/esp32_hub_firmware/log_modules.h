@@ -0,0 +1,13 @@
+#ifndef LOG_MODULES_H
+#define LOG_MODULES_H
+
+// Log modules of the hub; levels are set in config.h
+#include "config.h"
+#include <greenhouse_log.h>
+
+LOG_MODULE(LogSystem, "hub", LOG_SYSTEM_LEVEL);        // Startup, display, metrics
+LOG_MODULE(LogEspNow, "espnow", LOG_ESPNOW_LEVEL);     // Node links
+LOG_MODULE(LogCloud, "cloud", LOG_CLOUD_LEVEL);        // WiFi, Firebase, local server
+LOG_MODULE(LogStorage, "storage", LOG_STORAGE_LEVEL);  // Settings, history, outbox
+
+#endif
@@ -0,0 +1,160 @@
+#include "metrics.h"
+#include "log_modules.h"
+#include <stdarg.h>
+
+struct SectionStats {
+  uint32_t count;
+  uint32_t maxMicros;
+  uint32_t buckets[METRICS_HISTOGRAM_BUCKETS];
+};
+
+struct NodeLinkStats {
+  uint32_t framesReceived;
+  uint32_t framesRejected;
+  uint32_t sendOk;
+  uint32_t sendFailures;
+  uint32_t controlSentAt;     // micros() of the last ControlFrame transmission
+  uint16_t controlSequence;   // Its sequence, 0 once the round trip is measured
+  uint32_t rttMicros;         // Smoothed, 1/8 weight per sample
+  uint32_t rttMaxMicros;
+};
+
+static const char *const sectionNames[SECTION_COUNT] = {
+  "loop", "espnowRx", "frames", "buttons", "display", "firebaseSync"
+};
+
+static SectionStats sections[SECTION_COUNT];
+static NodeLinkStats nodeLinks[MAX_GREENHOUSES + 1];
+static volatile uint32_t framesDropped = 0;  // Lost to a full receive queue
+static uint32_t cyclesPerMicro = 240;
+
+void initMetrics() {
+  cyclesPerMicro = getCpuFrequencyMhz();
+}
+
+void recordSectionCycles(MetricSection section, uint32_t cycles) {
+  recordSectionTime(section, cycles / cyclesPerMicro);
+}
+
+void recordSectionTime(MetricSection section, uint32_t micros) {
+  SectionStats &stats = sections[section];
+  uint8_t bucket = micros == 0 ? 0 : 32 - __builtin_clz(micros);
+  if (bucket >= METRICS_HISTOGRAM_BUCKETS) {
+    bucket = METRICS_HISTOGRAM_BUCKETS - 1;
+  }
+
+  stats.buckets[bucket]++;
+  stats.count++;
+  if (micros > stats.maxMicros) {
+    stats.maxMicros = micros;
+  }
+}
+
+void countFrameDropped() {
+  framesDropped++;
+}
+
+void countFrameReceived(uint8_t nodeId) {
+  nodeLinks[nodeId].framesReceived++;
+}
+
+void countFrameRejected(uint8_t nodeId) {
+  nodeLinks[nodeId].framesRejected++;
+}
+
+void countSendResult(uint8_t nodeId, bool delivered) {
+  if (delivered) {
+    nodeLinks[nodeId].sendOk++;
+  } else {
+    nodeLinks[nodeId].sendFailures++;
+  }
+}
+
+void markControlSent(uint8_t nodeId, uint16_t sequence) {
+  nodeLinks[nodeId].controlSentAt = micros();
+  nodeLinks[nodeId].controlSequence = sequence;
+}
+
+void markControlAcked(uint8_t nodeId, uint16_t sequence, uint32_t receivedAt) {
+  NodeLinkStats &link = nodeLinks[nodeId];
+  if (link.controlSequence == 0 || link.controlSequence != sequence) {
+    return;  // Already measured, or an ACK for an older message
+  }
+  link.controlSequence = 0;
+
+  uint32_t rtt = receivedAt - link.controlSentAt;
+  if (link.rttMicros == 0) {
+    link.rttMicros = rtt;
+  } else {
+    link.rttMicros += ((int32_t)rtt - (int32_t)link.rttMicros) / 8;
+  }
+  if (rtt > link.rttMaxMicros) {
+    link.rttMaxMicros = rtt;
+  }
+}
+
+// Formatting target; length runs past size once the buffer overflows
+struct JsonBuffer {
+  char *data;
+  size_t size;
+  size_t length;
+};
+
+static void appendJson(JsonBuffer &out, const char *format, ...) {
+  if (out.length >= out.size) {
+    return;
+  }
+
+  va_list args;
+  va_start(args, format);
+  out.length += vsnprintf(out.data + out.length, out.size - out.length, format, args);
+  va_end(args);
+}
+
+size_t formatMetricsJson(char *buffer, size_t size) {
+  JsonBuffer out = {buffer, size, 0};
+  appendJson(out, "{\"uptime\":%lu,\"freeHeap\":%lu,\"minFreeHeap\":%lu,\"maxAllocHeap\":%lu,"
+             "\"rxDropped\":%lu,\"sections\":{",
+             (unsigned long)(esp_timer_get_time() / 1000000), (unsigned long)ESP.getFreeHeap(),
+             (unsigned long)ESP.getMinFreeHeap(), (unsigned long)ESP.getMaxAllocHeap(),
+             (unsigned long)framesDropped);
+
+  for (uint8_t s = 0; s < SECTION_COUNT; s++) {
+    const SectionStats &stats = sections[s];
+    appendJson(out, "%s\"%s\":{\"n\":%lu,\"max\":%lu,\"hist\":[", s == 0 ? "" : ",",
+               sectionNames[s], (unsigned long)stats.count, (unsigned long)stats.maxMicros);
+
+    // Trailing empty buckets are left out
+    int used = METRICS_HISTOGRAM_BUCKETS;
+    while (used > 0 && stats.buckets[used - 1] == 0) {
+      used--;
+    }
+    for (int b = 0; b < used; b++) {
+      appendJson(out, "%s%lu", b == 0 ? "" : ",", (unsigned long)stats.buckets[b]);
+    }
+    appendJson(out, "]}");
+  }
+
+  appendJson(out, "},\"nodes\":{");
+  bool first = true;
+  for (int i = 0; i <= MAX_GREENHOUSES; i++) {
+    const NodeLinkStats &link = nodeLinks[i];
+    if (link.framesReceived == 0 && link.framesRejected == 0 &&
+        link.sendOk == 0 && link.sendFailures == 0) {
+      continue;
+    }
+    appendJson(out, "%s\"%d\":{\"rx\":%lu,\"rejected\":%lu,\"sent\":%lu,\"sendFailed\":%lu,"
+               "\"rtt\":%lu,\"rttMax\":%lu}", first ? "" : ",", i,
+               (unsigned long)link.framesReceived, (unsigned long)link.framesRejected,
+               (unsigned long)link.sendOk, (unsigned long)link.sendFailures,
+               (unsigned long)link.rttMicros, (unsigned long)link.rttMaxMicros);
+    first = false;
+  }
+  appendJson(out, "}}");
+
+  if (out.length >= out.size) {
+    LOGW(LogSystem, "Metrics do not fit the buffer");
+    return 0;
+  }
+  return out.length;
+}
@@ -0,0 +1,72 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "config.h"
+
+// Field metrics: execution time histograms for the hub's hot paths and
+// link counters per node. Every section and counter has exactly one writer
+// (main loop, Wi-Fi task or cloud task), so recording is a few plain stores
+// without locks; a snapshot read by another task may lag by one update.
+//
+// Histogram bucket 0 counts runs under 1 µs, bucket b covers
+// [2^(b-1), 2^b) µs and the last bucket everything longer.
+
+enum MetricSection : uint8_t {
+  SECTION_LOOP,           // One pass of loop()
+  SECTION_ESPNOW_RX,      // onDataReceived(), Wi-Fi task
+  SECTION_FRAME_PROCESS,  // processReceivedFrames()
+  SECTION_BUTTONS,        // checkButtons()
+  SECTION_DISPLAY,        // updateDisplay()
+  SECTION_FIREBASE_SYNC,  // syncWithFirebase(), cloud task
+  SECTION_COUNT
+};
+
+void initMetrics();
+void recordSectionCycles(MetricSection section, uint32_t cycles);
+void recordSectionTime(MetricSection section, uint32_t micros);
+
+// Times a scope with the CPU cycle counter. The counter wraps after about
+// 17 s at 240 MHz, so use SlowSectionTimer for anything that can block.
+class SectionTimer {
+public:
+  explicit SectionTimer(MetricSection section)
+    : section(section), start(ESP.getCycleCount()) {}
+  ~SectionTimer() { recordSectionCycles(section, ESP.getCycleCount() - start); }
+
+private:
+  MetricSection section;
+  uint32_t start;
+};
+
+// Times a scope that may block on the network, using the microsecond timer
+class SlowSectionTimer {
+public:
+  explicit SlowSectionTimer(MetricSection section)
+    : section(section), start(esp_timer_get_time()) {}
+  ~SlowSectionTimer() { recordSectionTime(section, (uint32_t)(esp_timer_get_time() - start)); }
+
+private:
+  MetricSection section;
+  int64_t start;
+};
+
+// Link counters. nodeId 0 collects frames from senders that are not a
+// known node. Dropped frames and send results are counted in the Wi-Fi
+// task, everything else in the main loop.
+void countFrameDropped();
+void countFrameReceived(uint8_t nodeId);
+void countFrameRejected(uint8_t nodeId);
+void countSendResult(uint8_t nodeId, bool delivered);
+
+// Control round trip: transmission of a ControlFrame to the arrival of its
+// AckFrame. A retransmit restarts the clock.
+void markControlSent(uint8_t nodeId, uint16_t sequence);
+void markControlAcked(uint8_t nodeId, uint16_t sequence, uint32_t receivedAt);
+
+// Formats all metrics as compact JSON; returns the length, or 0 if the
+// metrics did not fit (size METRICS_JSON_MAX is enough for all nodes)
+size_t formatMetricsJson(char *buffer, size_t size);
+
+#endif
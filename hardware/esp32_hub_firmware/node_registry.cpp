@@ -0,0 +1,22 @@
+#include "node_registry.h"
+
+uint8_t activeNodes[MAX_GREENHOUSES];
+uint8_t activeNodeCount = 0;
+
+bool registerNode(uint8_t nodeId) {
+  if (!isValidNodeId(nodeId) || activeIndexOf(nodeId) >= 0) {
+    return false;
+  }
+  
+  activeNodes[activeNodeCount++] = nodeId;
+  return true;
+}
+
+int activeIndexOf(uint8_t nodeId) {
+  for (int n = 0; n < activeNodeCount; n++) {
+    if (activeNodes[n] == nodeId) {
+      return n;
+    }
+  }
+  return -1;
+}
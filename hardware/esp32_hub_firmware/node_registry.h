@@ -0,0 +1,27 @@
+#ifndef NODE_REGISTRY_H
+#define NODE_REGISTRY_H
+
+#include <stdint.h>
+#include "config.h"
+
+// Registry of nodes that have reported at least once. greenhouses[] stays
+// indexed by nodeId (1..MAX_GREENHOUSES) and is allocated up front; the
+// registry lists the ids in use so per-node work scales with active nodes.
+// Only the main loop may modify it.
+
+static_assert(MAX_GREENHOUSES < 32, "Node bitmasks are 32 bits wide");
+
+extern uint8_t activeNodes[MAX_GREENHOUSES];  // nodeIds in registration order
+extern uint8_t activeNodeCount;
+
+// Adds nodeId if it is not registered yet; returns true if it was added
+bool registerNode(uint8_t nodeId);
+
+// Position of nodeId in activeNodes, or -1 if not registered
+int activeIndexOf(uint8_t nodeId);
+
+inline bool isValidNodeId(int nodeId) {
+  return nodeId >= 1 && nodeId <= MAX_GREENHOUSES;
+}
+
+#endif
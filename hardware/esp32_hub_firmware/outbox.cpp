@@ -0,0 +1,253 @@
+#include "outbox.h"
+#include "delta_column.h"
+#include "log_modules.h"
+#include <LittleFS.h>
+#include <esp_timer.h>
+
+#define OUTBOX_FILE "/outbox.bin"
+#define OUTBOX_BOOT_FILE "/outbox.boot"
+#define OUTBOX_MAGIC 0x3158424F  // "OBX1"
+
+// The spill file is this header followed by records, oldest first
+struct OutboxFileHeader {
+  uint32_t magic;
+  uint32_t readOffset;  // First record not yet uploaded
+};
+
+static bool fsReady = false;
+static uint8_t bootId = 0;
+
+// RAM buffer, oldest first; always newer than anything in the spill file
+static OutboxRecord ramRecords[OUTBOX_RAM_RECORDS];
+static uint16_t ramHead = 0;
+static uint16_t ramCount = 0;
+
+static uint32_t fileSize = 0;  // 0 when there is no spill file
+static uint32_t fileReadOffset = 0;
+static uint32_t droppedRecords = 0;
+
+// Vent status last seen per node, to record open/close events
+static uint8_t lastVentStatus[MAX_GREENHOUSES + 1];
+static bool ventStatusKnown[MAX_GREENHOUSES + 1];
+
+// Batch built by buildOutboxBatch(), removed by commitOutboxBatch()
+static OutboxRecord batch[OUTBOX_BATCH_RECORDS];
+static uint16_t batchFromFile = 0;
+static uint16_t batchFromRam = 0;
+
+static uint32_t uptimeSeconds() {
+  return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+static uint32_t fileRecordCount() {
+  return fileSize > fileReadOffset ? (fileSize - fileReadOffset) / sizeof(OutboxRecord) : 0;
+}
+
+void initOutbox() {
+  fsReady = LittleFS.begin(true);  // Formats the partition on first use
+  if (!fsReady) {
+    LOGW(LogStorage, "LittleFS mount failed, outbox is RAM only");
+    return;
+  }
+
+  // Count boots so uptimes recorded before a reboot stay distinguishable
+  File file = LittleFS.open(OUTBOX_BOOT_FILE, "r");
+  if (file) {
+    file.read(&bootId, 1);
+    file.close();
+  }
+  bootId++;
+  file = LittleFS.open(OUTBOX_BOOT_FILE, "w");
+  if (file) {
+    file.write(&bootId, 1);
+    file.close();
+  }
+
+  // Resume a spill file left over from an outage before the reboot
+  file = LittleFS.open(OUTBOX_FILE, "r");
+  if (!file) {
+    return;
+  }
+
+  OutboxFileHeader header;
+  bool valid = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+               header.magic == OUTBOX_MAGIC;
+  fileSize = file.size();
+  file.close();
+
+  if (valid && header.readOffset >= sizeof(header)) {
+    fileReadOffset = header.readOffset;
+  }
+  if (fileRecordCount() == 0) {
+    LittleFS.remove(OUTBOX_FILE);
+    fileSize = 0;
+    fileReadOffset = 0;
+  } else {
+    LOGI(LogStorage, "Outbox resumed with %lu stored records", (unsigned long)fileRecordCount());
+  }
+}
+
+// Moves the whole RAM buffer to the end of the spill file
+static void spillRamToFile() {
+  uint32_t bytes = ramCount * sizeof(OutboxRecord);
+  File file;
+
+  if (fsReady && fileSize + bytes <= OUTBOX_FILE_MAX) {
+    if (fileSize == 0) {
+      file = LittleFS.open(OUTBOX_FILE, "w");
+      OutboxFileHeader header = {OUTBOX_MAGIC, sizeof(OutboxFileHeader)};
+      if (file) {
+        file.write((const uint8_t *)&header, sizeof(header));
+        fileReadOffset = header.readOffset;
+      }
+    } else {
+      file = LittleFS.open(OUTBOX_FILE, "a");
+    }
+  }
+
+  if (!file) {
+    droppedRecords += ramCount;
+    LOGW(LogStorage, "Outbox full, %lu records dropped so far", (unsigned long)droppedRecords);
+  } else {
+    for (uint16_t n = 0; n < ramCount; n++) {
+      file.write((const uint8_t *)&ramRecords[(ramHead + n) % OUTBOX_RAM_RECORDS], sizeof(OutboxRecord));
+    }
+    fileSize = file.size();
+    file.close();
+  }
+
+  ramHead = 0;
+  ramCount = 0;
+}
+
+static void addRecord(const OutboxRecord &record) {
+  if (ramCount == OUTBOX_RAM_RECORDS) {
+    spillRamToFile();
+  }
+
+  ramRecords[(ramHead + ramCount) % OUTBOX_RAM_RECORDS] = record;
+  ramCount++;
+}
+
+void outboxAddSample(const HistorySample &sample) {
+  OutboxRecord record;
+  record.time = sample.time;
+  record.bootId = bootId;
+  record.type = OUTBOX_TELEMETRY;
+  record.nodeId = sample.nodeId;
+  record.ventStatus = sample.ventStatus;
+  record.temperature = sample.temperature;
+  record.humidity = sample.humidity;
+  record.pressure = sample.pressure;
+  addRecord(record);
+
+  if (ventStatusKnown[sample.nodeId] && lastVentStatus[sample.nodeId] != sample.ventStatus) {
+    record.type = OUTBOX_VENT_EVENT;
+    addRecord(record);
+  }
+  lastVentStatus[sample.nodeId] = sample.ventStatus;
+  ventStatusKnown[sample.nodeId] = true;
+}
+
+bool outboxFlushDue() {
+  if (fileRecordCount() > 0 || ramCount >= OUTBOX_BATCH_RECORDS) {
+    return true;
+  }
+  return ramCount > 0 && uptimeSeconds() - ramRecords[ramHead].time >= OUTBOX_FLUSH_INTERVAL / 1000;
+}
+
+// Takes the oldest records, spill file first. A batch never spans two
+// boots, so its single uptime anchor applies to every record in it.
+bool buildOutboxBatch(FirebaseJson &json) {
+  uint16_t count = 0;
+  batchFromFile = 0;
+  batchFromRam = 0;
+
+  uint32_t stored = fileRecordCount();
+  if (stored > 0) {
+    uint32_t wanted = stored < OUTBOX_BATCH_RECORDS ? stored : OUTBOX_BATCH_RECORDS;
+    File file = LittleFS.open(OUTBOX_FILE, "r");
+    if (file && file.seek(fileReadOffset)) {
+      count = file.read((uint8_t *)batch, wanted * sizeof(OutboxRecord)) / sizeof(OutboxRecord);
+    }
+    if (file) {
+      file.close();
+    }
+    if (count < wanted) {
+      return false;  // Read error, try again on the next drain
+    }
+    batchFromFile = count;
+  }
+
+  // RAM records only join once the spill file is fully included
+  if (batchFromFile == stored) {
+    while (count < OUTBOX_BATCH_RECORDS && batchFromRam < ramCount) {
+      batch[count++] = ramRecords[(ramHead + batchFromRam) % OUTBOX_RAM_RECORDS];
+      batchFromRam++;
+    }
+  }
+
+  for (uint16_t n = 1; n < count; n++) {
+    if (batch[n].bootId != batch[0].bootId) {
+      count = n;
+      break;
+    }
+  }
+  if (batchFromFile > count) {
+    batchFromFile = count;
+  }
+  batchFromRam = count - batchFromFile;
+
+  if (count == 0) {
+    return false;
+  }
+
+  DeltaColumn type, node, time, temperature, humidity, pressure, vent;
+  for (uint16_t n = 0; n < count; n++) {
+    type.add(batch[n].type);
+    node.add(batch[n].nodeId);
+    time.add(batch[n].time);
+    temperature.add(batch[n].temperature);
+    humidity.add(batch[n].humidity);
+    pressure.add(batch[n].pressure);
+    vent.add(batch[n].ventStatus);
+  }
+
+  // The uptime anchor only matches records from the current boot
+  json.set("boot", batch[0].bootId);
+  json.set("currentBoot", bootId);
+  json.set("uptime", (int)uptimeSeconds());
+  json.set("uploadedAt/.sv", "timestamp");
+  json.set("records/type", type.values);
+  json.set("records/node", node.values);
+  json.set("records/t", time.values);
+  json.set("records/temperature", temperature.values);
+  json.set("records/humidity", humidity.values);
+  json.set("records/pressure", pressure.values);
+  json.set("records/vent", vent.values);
+  return true;
+}
+
+void commitOutboxBatch() {
+  if (batchFromFile > 0) {
+    fileReadOffset += batchFromFile * sizeof(OutboxRecord);
+
+    if (fileRecordCount() == 0) {
+      LittleFS.remove(OUTBOX_FILE);
+      fileSize = 0;
+      fileReadOffset = 0;
+    } else {
+      File file = LittleFS.open(OUTBOX_FILE, "r+");
+      if (file) {
+        file.seek(offsetof(OutboxFileHeader, readOffset));
+        file.write((const uint8_t *)&fileReadOffset, sizeof(fileReadOffset));
+        file.close();
+      }
+    }
+  }
+
+  ramHead = (ramHead + batchFromRam) % OUTBOX_RAM_RECORDS;
+  ramCount -= batchFromRam;
+  batchFromFile = 0;
+  batchFromRam = 0;
+}
@@ -0,0 +1,36 @@
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <Firebase_ESP_Client.h>
+#include "config.h"
+#include "sensor_history.h"
+
+// Store-and-forward queue for telemetry and vent events bound for /log.
+// Records collect in RAM and go out in batches; while the uplink is down
+// a full RAM buffer spills to a LittleFS file (bounded by OUTBOX_FILE_MAX)
+// that survives reboots. Only the cloud task uses the outbox.
+
+enum OutboxRecordType : uint8_t {
+  OUTBOX_TELEMETRY = 1,
+  OUTBOX_VENT_EVENT = 2
+};
+
+// Same fixed point as HistorySample
+struct OutboxRecord {
+  uint32_t time;   // Hub uptime in seconds
+  uint8_t bootId;  // Boot the uptime belongs to
+  uint8_t type;
+  uint8_t nodeId;
+  uint8_t ventStatus;
+  int16_t temperature;
+  uint16_t humidity;
+  uint16_t pressure;
+};
+
+void initOutbox();
+void outboxAddSample(const HistorySample &sample);
+bool outboxFlushDue();                      // A full batch, a spill file or old records are waiting
+bool buildOutboxBatch(FirebaseJson &json);  // false if the outbox is empty
+void commitOutboxBatch();                   // Call after the batch was stored
+
+#endif
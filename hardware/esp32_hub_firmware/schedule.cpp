@@ -0,0 +1,221 @@
+#include "schedule.h"
+#include "config.h"
+#include "globals.h"
+#include "esp_now_comm.h"
+#include "log_modules.h"
+#include <time.h>
+
+#define CLOCK_VALID_AFTER 1700000000  // Before SNTP answers, time() counts from 1970
+
+struct ScheduleEntry {
+  time_t at;
+  uint8_t nodeId;
+  char command;  // 'O' or 'C'
+};
+
+// Next event of each scheduled greenhouse, soonest first
+static ScheduleEntry eventQueue[MAX_GREENHOUSES];
+static uint8_t eventCount = 0;
+static bool queueBuilt = false;  // Once the clock is valid
+static unsigned long nextCheck = 0;
+
+// Events pushed to the nodes
+static uint32_t pushPending = 0;  // Bit per nodeId whose latest events are unacknowledged
+static uint16_t pushSequence[MAX_GREENHOUSES + 1];
+
+static bool isScheduled(const ScheduleSettings &schedule) {
+  return schedule.scheduleEnabled && isValidSchedule(schedule) &&
+         (schedule.openHour != schedule.closeHour || schedule.openMinute != schedule.closeMinute);
+}
+
+// hour:minute local time, dayOffset days after the date in today. mktime()
+// normalizes the day and applies the daylight saving rules of TIME_ZONE.
+static time_t localTimeOn(const struct tm &today, int dayOffset, uint8_t hour, uint8_t minute) {
+  struct tm when = today;
+  when.tm_mday += dayOffset;
+  when.tm_hour = hour;
+  when.tm_min = minute;
+  when.tm_sec = 0;
+  when.tm_isdst = -1;
+  return mktime(&when);
+}
+
+// Fills events with the next maxEvents events of a schedule after now,
+// soonest first; returns how many
+static uint8_t upcomingEvents(const ScheduleSettings &schedule, time_t now,
+                              ScheduleEntry *events, uint8_t maxEvents) {
+  if (!isScheduled(schedule)) {
+    return 0;
+  }
+  
+  struct tm today;
+  localtime_r(&now, &today);
+  
+  uint8_t count = 0;
+  for (int day = 0; count < maxEvents; day++) {
+    ScheduleEntry open = {localTimeOn(today, day, schedule.openHour, schedule.openMinute), 0, 'O'};
+    ScheduleEntry close = {localTimeOn(today, day, schedule.closeHour, schedule.closeMinute), 0, 'C'};
+    const ScheduleEntry &first = open.at < close.at ? open : close;
+    const ScheduleEntry &second = open.at < close.at ? close : open;
+    
+    if (first.at > now && count < maxEvents) events[count++] = first;
+    if (second.at > now && count < maxEvents) events[count++] = second;
+  }
+  return count;
+}
+
+static void removeEvent(uint8_t nodeId) {
+  for (uint8_t i = 0; i < eventCount; i++) {
+    if (eventQueue[i].nodeId == nodeId) {
+      eventCount--;
+      memmove(eventQueue + i, eventQueue + i + 1, (eventCount - i) * sizeof(eventQueue[0]));
+      return;
+    }
+  }
+}
+
+static void insertEvent(const ScheduleEntry &event) {
+  uint8_t i = eventCount;
+  while (i > 0 && eventQueue[i - 1].at > event.at) {
+    eventQueue[i] = eventQueue[i - 1];
+    i--;
+  }
+  eventQueue[i] = event;
+  eventCount++;
+}
+
+static void queueNextEvent(uint8_t nodeId, time_t now) {
+  removeEvent(nodeId);
+  
+  ScheduleEntry next;
+  if (upcomingEvents(greenhouses[nodeId].settings.schedule, now, &next, 1) == 1) {
+    next.nodeId = nodeId;
+    insertEvent(next);
+  }
+}
+
+// Sends the node its upcoming events, with delays from this transmission.
+// Also sends an empty list, which clears the events of a disabled schedule.
+static void pushSchedule(uint8_t nodeId) {
+  if (!queueBuilt || !greenhouses[nodeId].isOnline || nodeProtocolVersion(nodeId) < 4) {
+    return;
+  }
+  
+  time_t now = time(NULL);
+  ScheduleEntry events[SCHEDULE_FRAME_EVENTS];
+  uint8_t count = upcomingEvents(greenhouses[nodeId].settings.schedule, now, events, SCHEDULE_FRAME_EVENTS);
+  
+  ScheduleFrame frame = {};
+  initFrameHeader(frame.header, FRAME_SCHEDULE, nodeId);
+  frame.sequence = pushSequence[nodeId];
+  frame.count = count;
+  for (uint8_t i = 0; i < count; i++) {
+    frame.events[i].delay = events[i].at - now;
+    frame.events[i].manualCommand = events[i].command;
+  }
+  
+  if (sendFrameToNode(nodeId, (const uint8_t *)&frame, sizeof(frame))) {
+    LOGD(LogEspNow, "Schedule %u (%u events) sent to node %d", frame.sequence, count, nodeId);
+  }
+}
+
+// New events for a node; resent on its reports until acknowledged
+static void markSchedulePending(uint8_t nodeId) {
+  if (++pushSequence[nodeId] == 0) {
+    pushSequence[nodeId] = 1;
+  }
+  pushPending |= 1UL << nodeId;
+  pushSchedule(nodeId);
+}
+
+static void buildQueue(time_t now) {
+  eventCount = 0;
+  for (int i = 1; i <= MAX_GREENHOUSES; i++) {
+    queueNextEvent(i, now);
+  }
+  queueBuilt = true;
+  
+  for (int i = 1; i <= MAX_GREENHOUSES; i++) {
+    markSchedulePending(i);
+  }
+  LOGI(LogSystem, "Clock set, %u greenhouses on a schedule", eventCount);
+}
+
+void serviceSchedule() {
+  unsigned long currentMillis = millis();
+  if ((long)(currentMillis - nextCheck) < 0) {
+    return;
+  }
+  
+  time_t now = time(NULL);
+  if (now < CLOCK_VALID_AFTER) {
+    nextCheck = currentMillis + 1000;  // Waiting for the first SNTP answer
+    return;
+  }
+  if (!queueBuilt) {
+    buildQueue(now);
+  }
+  
+  // Events due together go out as one group command per action
+  uint32_t openMask = 0;
+  uint32_t closeMask = 0;
+  while (eventCount > 0 && eventQueue[0].at <= now) {
+    uint8_t nodeId = eventQueue[0].nodeId;
+    if (eventQueue[0].command == 'O') {
+      openMask |= 1UL << nodeId;
+    } else {
+      closeMask |= 1UL << nodeId;
+    }
+    queueNextEvent(nodeId, now);
+  }
+  
+  if (openMask != 0) {
+    LOGI(LogSystem, "Scheduled open, nodes 0x%lx", (unsigned long)openMask);
+    sendGroupCommand(openMask, 'O', GROUP_MODE_KEEP);
+  }
+  if (closeMask != 0) {
+    LOGI(LogSystem, "Scheduled close, nodes 0x%lx", (unsigned long)closeMask);
+    sendGroupCommand(closeMask, 'C', GROUP_MODE_KEEP);
+  }
+  
+  // The nodes that just ran an event get their next ones
+  for (uint32_t pending = openMask | closeMask; pending != 0; pending &= pending - 1) {
+    markSchedulePending(__builtin_ctz(pending));
+  }
+  
+  // Sleep until the next event, but read the clock now and then so SNTP
+  // corrections and daylight saving changes are picked up
+  unsigned long wait = SCHEDULE_RECHECK_MAX;
+  if (eventCount > 0 && (unsigned long)(eventQueue[0].at - now) < wait / 1000) {
+    wait = (eventQueue[0].at - now) * 1000UL;
+  }
+  nextCheck = currentMillis + wait;
+}
+
+bool hasActiveSchedule(uint8_t nodeId) {
+  return isScheduled(greenhouses[nodeId].settings.schedule);
+}
+
+void scheduleChanged(uint8_t nodeId) {
+  if (!queueBuilt) {
+    return;  // The whole queue is built once the clock is valid
+  }
+  
+  queueNextEvent(nodeId, time(NULL));
+  markSchedulePending(nodeId);
+  nextCheck = millis();  // Recompute the wait, the new event may come first
+}
+
+void deliverSchedule(uint8_t nodeId, bool cameOnline) {
+  if (cameOnline) {
+    markSchedulePending(nodeId);
+  } else if (pushPending & (1UL << nodeId)) {
+    pushSchedule(nodeId);
+  }
+}
+
+void onScheduleAck(uint8_t nodeId, uint16_t sequence) {
+  if (sequence == pushSequence[nodeId]) {
+    pushPending &= ~(1UL << nodeId);
+  }
+}
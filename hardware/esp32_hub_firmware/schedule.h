@@ -0,0 +1,26 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <Arduino.h>
+#include "data_structures.h"
+
+// Vent schedules (GreenhouseSettings.schedule) against the SNTP clock the
+// cloud task starts. The main loop keeps the next open or close event of
+// every scheduled greenhouse in a queue ordered by time and reads the clock
+// again only when the first one is due. Events due together go out as one
+// group command per action. Each node also gets its next
+// SCHEDULE_FRAME_EVENTS events, which it runs itself while the hub is
+// unreachable.
+//
+// A scheduled command works like a manual one: in automatic mode the
+// threshold control may move the vent again later.
+
+void serviceSchedule();                // Main loop, cheap until an event is due
+void scheduleChanged(uint8_t nodeId);  // Requeue and resend after an edit
+bool hasActiveSchedule(uint8_t nodeId);
+
+// Called by esp_now_comm.cpp
+void deliverSchedule(uint8_t nodeId, bool cameOnline);  // On each sensor report
+void onScheduleAck(uint8_t nodeId, uint16_t sequence);
+
+#endif
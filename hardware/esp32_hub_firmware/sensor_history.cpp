@@ -0,0 +1,254 @@
+#include "sensor_history.h"
+#include <ring_buffer.h>
+#include "delta_column.h"
+#include "outbox.h"
+#include "log_modules.h"
+#include <esp_timer.h>
+
+// One tier of history stored as a ring. Entry k (counting every entry ever
+// written) lives in items[k % capacity]; upload progress is tracked the
+// same way, so entries overwritten before they were sent are simply skipped.
+template <typename T>
+struct HistoryTier {
+  T *items;
+  uint16_t capacity;
+  uint32_t written;   // Entries ever written
+  uint32_t uploaded;  // Entries confirmed stored in Firebase
+  uint32_t staged;    // uploaded value once the built batch is committed
+
+  void add(const T &item) {
+    items[written % capacity] = item;
+    written++;
+  }
+
+  const T &at(uint32_t k) const {
+    return items[k % capacity];
+  }
+
+  uint32_t pending() const {
+    uint32_t count = written - uploaded;
+    return count > capacity ? capacity : count;
+  }
+};
+
+// Rollup bucket being filled; appended to its tier once a sample falls in a later bucket
+struct RollupBucket {
+  uint32_t start;
+  int32_t temperatureSum;
+  uint32_t humiditySum;
+  uint32_t pressureSum;
+  int16_t temperatureMin;
+  int16_t temperatureMax;
+  uint16_t humidityMin;
+  uint16_t humidityMax;
+  uint16_t count;
+};
+
+struct NodeHistory {
+  bool allocated;
+  bool unavailable;  // Allocation failed, history is not kept for this node
+  HistoryTier<HistoryRollup> minute;
+  HistoryTier<HistoryRollup> quarter;
+  RollupBucket minuteBucket;
+  RollupBucket quarterBucket;
+};
+
+// Samples travel from the main loop to the cloud task, which owns the history
+static SpscRing<HistorySample, HISTORY_QUEUE_SIZE> historyQueue;
+static NodeHistory nodeHistory[MAX_GREENHOUSES + 1];
+
+static void *allocHistory(size_t bytes) {
+  if (psramFound()) {
+    return ps_malloc(bytes);
+  }
+
+  // Without PSRAM, keep enough internal heap for the TLS connections
+  if (ESP.getFreeHeap() < bytes + HISTORY_HEAP_RESERVE) {
+    return NULL;
+  }
+  return malloc(bytes);
+}
+
+static bool allocateNode(uint8_t nodeId) {
+  NodeHistory &history = nodeHistory[nodeId];
+  size_t rollupBytes = (HISTORY_MINUTE_ROLLUPS + HISTORY_QUARTER_ROLLUPS) * sizeof(HistoryRollup);
+
+  HistoryRollup *block = (HistoryRollup *)allocHistory(rollupBytes);
+  if (block == NULL) {
+    history.unavailable = true;
+    LOGW(LogStorage, "No memory for history of node %d", nodeId);
+    return false;
+  }
+
+  history.minute.items = block;
+  history.minute.capacity = HISTORY_MINUTE_ROLLUPS;
+  history.quarter.items = history.minute.items + HISTORY_MINUTE_ROLLUPS;
+  history.quarter.capacity = HISTORY_QUARTER_ROLLUPS;
+  history.allocated = true;
+  return true;
+}
+
+static void addToBucket(RollupBucket &bucket, HistoryTier<HistoryRollup> &tier,
+                        const HistorySample &sample, uint32_t bucketSeconds) {
+  uint32_t start = sample.time - sample.time % bucketSeconds;
+
+  if (bucket.count > 0 && bucket.start != start) {
+    HistoryRollup rollup;
+    rollup.start = bucket.start;
+    rollup.temperatureMin = bucket.temperatureMin;
+    rollup.temperatureMean = bucket.temperatureSum / bucket.count;
+    rollup.temperatureMax = bucket.temperatureMax;
+    rollup.humidityMin = bucket.humidityMin;
+    rollup.humidityMean = bucket.humiditySum / bucket.count;
+    rollup.humidityMax = bucket.humidityMax;
+    rollup.pressureMean = bucket.pressureSum / bucket.count;
+    rollup.count = bucket.count;
+    tier.add(rollup);
+    bucket.count = 0;
+  }
+
+  if (bucket.count == 0) {
+    bucket.start = start;
+    bucket.temperatureSum = 0;
+    bucket.humiditySum = 0;
+    bucket.pressureSum = 0;
+    bucket.temperatureMin = sample.temperature;
+    bucket.temperatureMax = sample.temperature;
+    bucket.humidityMin = sample.humidity;
+    bucket.humidityMax = sample.humidity;
+  }
+
+  bucket.temperatureSum += sample.temperature;
+  bucket.humiditySum += sample.humidity;
+  bucket.pressureSum += sample.pressure;
+  if (sample.temperature < bucket.temperatureMin) bucket.temperatureMin = sample.temperature;
+  if (sample.temperature > bucket.temperatureMax) bucket.temperatureMax = sample.temperature;
+  if (sample.humidity < bucket.humidityMin) bucket.humidityMin = sample.humidity;
+  if (sample.humidity > bucket.humidityMax) bucket.humidityMax = sample.humidity;
+  bucket.count++;
+}
+
+void queueHistorySample(uint8_t nodeId, const SensorData &sensor) {
+  HistorySample sample;
+  sample.time = (uint32_t)(esp_timer_get_time() / 1000000);
+  sample.nodeId = nodeId;
+  sample.ventStatus = sensor.ventStatus;
+  sample.temperature = toFixed(sensor.temperature, CENTI_SCALE);
+  sample.humidity = toFixedUnsigned(sensor.humidity, CENTI_SCALE);
+  sample.pressure = toFixedUnsigned(sensor.pressure, DECI_SCALE);
+
+  historyQueue.push(sample);  // If full, this reading is missing from history and the outbox
+}
+
+void processHistorySamples() {
+  HistorySample sample;
+  while (historyQueue.pop(sample)) {
+    outboxAddSample(sample);
+    
+    NodeHistory &history = nodeHistory[sample.nodeId];
+    if (history.unavailable || (!history.allocated && !allocateNode(sample.nodeId))) {
+      continue;
+    }
+
+    addToBucket(history.minuteBucket, history.minute, sample, 60);
+    addToBucket(history.quarterBucket, history.quarter, sample, 15 * 60);
+  }
+}
+
+// Sets path + field, building the key on the stack
+static void setColumn(FirebaseJson &json, const char *path, const char *field, DeltaColumn &column) {
+  char key[48];
+  snprintf(key, sizeof(key), "%s%s", path, field);
+  json.set(key, column.values);
+}
+
+static void addEntries(FirebaseJson &json, const char *path,
+                       const HistoryTier<HistoryRollup> &tier, uint32_t first, uint32_t count) {
+  DeltaColumn time, temperatureMin, temperatureMean, temperatureMax;
+  DeltaColumn humidityMin, humidityMean, humidityMax, pressure, samples;
+
+  for (uint32_t k = first; k < first + count; k++) {
+    const HistoryRollup &rollup = tier.at(k);
+    time.add(rollup.start);
+    temperatureMin.add(rollup.temperatureMin);
+    temperatureMean.add(rollup.temperatureMean);
+    temperatureMax.add(rollup.temperatureMax);
+    humidityMin.add(rollup.humidityMin);
+    humidityMean.add(rollup.humidityMean);
+    humidityMax.add(rollup.humidityMax);
+    pressure.add(rollup.pressureMean);
+    samples.add(rollup.count);
+  }
+
+  setColumn(json, path, "t", time);
+  setColumn(json, path, "temperatureMin", temperatureMin);
+  setColumn(json, path, "temperatureMean", temperatureMean);
+  setColumn(json, path, "temperatureMax", temperatureMax);
+  setColumn(json, path, "humidityMin", humidityMin);
+  setColumn(json, path, "humidityMean", humidityMean);
+  setColumn(json, path, "humidityMax", humidityMax);
+  setColumn(json, path, "pressure", pressure);
+  setColumn(json, path, "samples", samples);
+}
+
+// Adds the oldest pending entries of a tier, up to the remaining budget
+template <typename T>
+static bool stageTier(FirebaseJson &json, const char *path, HistoryTier<T> &tier, uint16_t &budget) {
+  uint32_t pending = tier.pending();
+  uint32_t first = tier.written - pending;
+  uint32_t count = pending < budget ? pending : budget;
+
+  tier.staged = first + count;
+  if (count == 0) {
+    return false;
+  }
+
+  addEntries(json, path, tier, first, count);
+  budget -= count;
+  return true;
+}
+
+// Builds one batch of rollups not yet uploaded, coarse tier first so a long
+// outage is covered end to end before the fine detail is sent. Raw samples
+// stay on the hub; they reach Firebase through the outbox as telemetry.
+bool buildHistoryBatch(FirebaseJson &json) {
+  uint16_t budget = HISTORY_BATCH_MAX;
+  bool hasEntries = false;
+
+  for (int i = 1; i <= MAX_GREENHOUSES; i++) {
+    NodeHistory &history = nodeHistory[i];
+    if (!history.allocated) {
+      continue;
+    }
+
+    char path[24];
+    snprintf(path, sizeof(path), "nodes/%d/quarter/", i);
+    hasEntries |= stageTier(json, path, history.quarter, budget);
+    snprintf(path, sizeof(path), "nodes/%d/minute/", i);
+    hasEntries |= stageTier(json, path, history.minute, budget);
+  }
+  return hasEntries;
+}
+
+void commitHistoryBatch() {
+  for (int i = 1; i <= MAX_GREENHOUSES; i++) {
+    NodeHistory &history = nodeHistory[i];
+    if (!history.allocated) {
+      continue;
+    }
+
+    history.quarter.uploaded = history.quarter.staged;
+    history.minute.uploaded = history.minute.staged;
+  }
+}
+
+bool hasHistoryBacklog() {
+  for (int i = 1; i <= MAX_GREENHOUSES; i++) {
+    const NodeHistory &history = nodeHistory[i];
+    if (history.allocated &&
+        (history.quarter.pending() || history.minute.pending())) {
+      return true;
+    }
+  }
+  return false;
+}
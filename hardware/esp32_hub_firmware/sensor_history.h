@@ -0,0 +1,48 @@
+#ifndef SENSOR_HISTORY_H
+#define SENSOR_HISTORY_H
+
+#include <Firebase_ESP_Client.h>
+#include "config.h"
+#include "data_structures.h"
+
+// Per-node sensor history kept on the hub: 1-minute and 15-minute
+// min/mean/max rollups. Raw readings are not kept here; they go to /log
+// through the outbox (outbox.h). Storage is fixed size, allocated once per
+// node when its first sample arrives (PSRAM if fitted), and the oldest
+// entries are overwritten when a tier is full.
+//
+// Times are hub uptime in seconds; each upload carries the hub uptime and a
+// server timestamp so the dashboard can place the points in wall-clock time.
+
+// One reading in fixed point: centi-degrees, centi-percent, deci-hPa
+struct HistorySample {
+  uint32_t time;
+  uint8_t nodeId;
+  uint8_t ventStatus;
+  int16_t temperature;
+  uint16_t humidity;
+  uint16_t pressure;
+};
+
+struct HistoryRollup {
+  uint32_t start;  // Bucket start time
+  int16_t temperatureMin;
+  int16_t temperatureMean;
+  int16_t temperatureMax;
+  uint16_t humidityMin;
+  uint16_t humidityMean;
+  uint16_t humidityMax;
+  uint16_t pressureMean;
+  uint16_t count;  // Samples in the bucket
+};
+
+// Main loop: hand a validated reading to the cloud task
+void queueHistorySample(uint8_t nodeId, const SensorData &sensor);
+
+// Cloud task: store queued samples (also handed to the outbox) and build uploads
+void processHistorySamples();
+bool buildHistoryBatch(FirebaseJson &json);  // false if nothing is pending
+void commitHistoryBatch();                   // Call after the batch was stored
+bool hasHistoryBacklog();
+
+#endif
@@ -1,38 +1,205 @@
-
 #include "settings_eeprom.h"
 #include "config.h"
 #include "globals.h"
-#include <EEPROM.h>
+#include "node_registry.h"
+#include "log_modules.h"
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+
+// Settings are kept in an append-only journal on the "settings" flash
+// partition (see partitions.csv) instead of the EEPROM emulation, which
+// erases and rewrites its whole sector on every commit.
+//
+// Each save appends one CRC32-protected record per changed greenhouse.
+// Sectors form a ring: when the active sector fills up, the next one is
+// erased and starts with a snapshot of every saved greenhouse, so older sectors
+// never hold the only valid copy of anything. Boot replays the journal and
+// keeps the record with the highest sequence number per greenhouse.
+
+#define SETTINGS_RECORD_MAGIC 0x4753    // "GS"
+#define SETTINGS_RECORD_VERSION 1
+#define SETTINGS_SLOT_SIZE 32
+#define SETTINGS_SECTOR_SIZE 4096
+#define SETTINGS_SLOTS_PER_SECTOR (SETTINGS_SECTOR_SIZE / SETTINGS_SLOT_SIZE)
+
+struct SettingsRecord {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t nodeId;
+  uint32_t sequence;
+  GreenhouseSettings settings;
+  uint32_t crc;  // CRC32 of all preceding bytes
+};
+
+static_assert(sizeof(SettingsRecord) <= SETTINGS_SLOT_SIZE, "SettingsRecord must fit in one journal slot");
 
 // External references
 extern GreenhouseData greenhouses[];
 
-void saveSettingsToEEPROM() {
-  // Save settings to EEPROM for power-loss recovery
+static const esp_partition_t *journalPartition = NULL;
+static uint32_t sectorCount = 0;
+static uint32_t writeSector = 0;
+static uint32_t writeSlot = 0;
+static uint32_t nextSequence = 1;
+
+// Last settings written per greenhouse, to skip saves that change nothing
+static GreenhouseSettings persisted[MAX_GREENHOUSES + 1];
+static bool persistedValid[MAX_GREENHOUSES + 1];
+
+static uint32_t slotOffset(uint32_t sector, uint32_t slot) {
+  return sector * SETTINGS_SECTOR_SIZE + slot * SETTINGS_SLOT_SIZE;
+}
+
+static uint32_t recordCrc(const SettingsRecord &record) {
+  return esp_rom_crc32_le(0, (const uint8_t *)&record, offsetof(SettingsRecord, crc));
+}
+
+static bool isErased(const uint8_t *slot) {
+  for (int i = 0; i < SETTINGS_SLOT_SIZE; i++) {
+    if (slot[i] != 0xFF) return false;
+  }
+  return true;
+}
+
+static bool isValidRecord(const SettingsRecord &record) {
+  return record.magic == SETTINGS_RECORD_MAGIC &&
+         record.version == SETTINGS_RECORD_VERSION &&
+         isValidNodeId(record.nodeId) &&
+         record.crc == recordCrc(record);
+}
+
+// manualCommand and ventTarget are transient and never persisted
+static bool sameSettings(const GreenhouseSettings &a, const GreenhouseSettings &b) {
+  return a.temperatureThreshold == b.temperatureThreshold &&
+         a.hysteresis == b.hysteresis &&
+         a.autoMode == b.autoMode &&
+         sameSchedule(a.schedule, b.schedule);
+}
+
+static bool writeRecord(uint8_t nodeId) {
+  uint8_t slot[SETTINGS_SLOT_SIZE];
+  memset(slot, 0xFF, sizeof(slot));
+
+  SettingsRecord record = {};
+  record.magic = SETTINGS_RECORD_MAGIC;
+  record.version = SETTINGS_RECORD_VERSION;
+  record.nodeId = nodeId;
+  record.sequence = nextSequence;
+  record.settings = greenhouses[nodeId].settings;
+  record.settings.manualCommand = 0;
+  record.settings.ventTarget = 0;
+  record.crc = recordCrc(record);
+  memcpy(slot, &record, sizeof(record));
+
+  if (esp_partition_write(journalPartition, slotOffset(writeSector, writeSlot), slot, sizeof(slot)) != ESP_OK) {
+    return false;
+  }
+
+  nextSequence++;
+  writeSlot++;
+  persisted[nodeId] = record.settings;
+  persistedValid[nodeId] = true;
+  return true;
+}
+
+// Erases the next sector in the ring and seeds it with nodeId plus every
+// greenhouse that already has a record, so unused ids take no slots
+static bool startNextSector(uint8_t nodeId) {
+  writeSector = (writeSector + 1) % sectorCount;
+  writeSlot = 0;
+
+  if (esp_partition_erase_range(journalPartition, writeSector * SETTINGS_SECTOR_SIZE, SETTINGS_SECTOR_SIZE) != ESP_OK) {
+    return false;
+  }
+
   for (int i = 1; i <= MAX_GREENHOUSES; i++) {
-    int addr = (i-1) * sizeof(GreenhouseSettings);
-    EEPROM.put(addr, greenhouses[i].settings);
+    if (i != nodeId && !persistedValid[i]) continue;
+    if (!writeRecord(i)) return false;
   }
-  EEPROM.commit();
+  return true;
 }
 
-void loadSettingsFromEEPROM() {
-  // Load settings from EEPROM
+static bool appendRecord(uint8_t nodeId) {
+  if (journalPartition == NULL) {
+    return false;
+  }
+
+  // Active sector is full, move on to the next one
+  if (writeSlot >= SETTINGS_SLOTS_PER_SECTOR) {
+    return startNextSector(nodeId);  // The snapshot already includes nodeId
+  }
+  return writeRecord(nodeId);
+}
+
+// Journals only the greenhouses whose bit is set in nodeMask (bit n = nodeId n)
+// and whose settings differ from the last record written for them
+void saveChangedSettingsToEEPROM(uint32_t nodeMask) {
   for (int i = 1; i <= MAX_GREENHOUSES; i++) {
-    int addr = (i-1) * sizeof(GreenhouseSettings);
-    EEPROM.get(addr, greenhouses[i].settings);
-    
-    // Validate and apply defaults if needed
-    if (isnan(greenhouses[i].settings.temperatureThreshold) || 
-        greenhouses[i].settings.temperatureThreshold < 0 ||
-        greenhouses[i].settings.temperatureThreshold > 50) {
-      greenhouses[i].settings.temperatureThreshold = 25.0;
+    if (!(nodeMask & (1UL << i))) {
+      continue;
     }
-    
-    if (isnan(greenhouses[i].settings.hysteresis) ||
-        greenhouses[i].settings.hysteresis < 0 ||
-        greenhouses[i].settings.hysteresis > 5) {
-      greenhouses[i].settings.hysteresis = 0.5;
+
+    if (!persistedValid[i] || !sameSettings(persisted[i], greenhouses[i].settings)) {
+      appendRecord(i);
     }
   }
 }
+
+void loadSettingsFromEEPROM() {
+  journalPartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                              ESP_PARTITION_SUBTYPE_ANY,
+                                              SETTINGS_PARTITION_LABEL);
+  if (journalPartition == NULL) {
+    LOGW(LogStorage, "Settings partition not found, using defaults");
+    return;
+  }
+
+  sectorCount = journalPartition->size / SETTINGS_SECTOR_SIZE;
+
+  uint32_t newestSequence[MAX_GREENHOUSES + 1] = {0};
+  uint32_t highestSequence = 0;
+  bool found = false;
+
+  // Replay every slot, keeping the newest valid record per greenhouse
+  for (uint32_t s = 0; s < sectorCount; s++) {
+    for (uint32_t slot = 0; slot < SETTINGS_SLOTS_PER_SECTOR; slot++) {
+      SettingsRecord record;
+      if (esp_partition_read(journalPartition, slotOffset(s, slot), &record, sizeof(record)) != ESP_OK ||
+          !isValidRecord(record)) {
+        continue;  // Erased, torn or corrupted
+      }
+
+      if (record.sequence > newestSequence[record.nodeId]) {
+        newestSequence[record.nodeId] = record.sequence;
+        greenhouses[record.nodeId].settings = record.settings;
+        persisted[record.nodeId] = record.settings;
+        persistedValid[record.nodeId] = true;
+      }
+
+      if (!found || record.sequence > highestSequence) {
+        highestSequence = record.sequence;
+        writeSector = s;
+        writeSlot = slot + 1;
+        found = true;
+      }
+    }
+  }
+
+  if (!found) {
+    // Empty or unreadable journal, start fresh from the defaults
+    writeSector = sectorCount - 1;
+    writeSlot = SETTINGS_SLOTS_PER_SECTOR;
+    LOGI(LogStorage, "No saved settings, using defaults");
+    return;
+  }
+
+  nextSequence = highestSequence + 1;
+
+  // Skip slots after the newest record that a failed write left non-erased
+  uint8_t raw[SETTINGS_SLOT_SIZE];
+  while (writeSlot < SETTINGS_SLOTS_PER_SECTOR) {
+    esp_partition_read(journalPartition, slotOffset(writeSector, writeSlot), raw, sizeof(raw));
+    if (isErased(raw)) break;
+    writeSlot++;
+  }
+}
@@ -5,7 +5,7 @@
 #include "data_structures.h"
 
 // Function declarations
-void saveSettingsToEEPROM();
+void saveChangedSettingsToEEPROM(uint32_t nodeMask);
 void loadSettingsFromEEPROM();
 
 #endif
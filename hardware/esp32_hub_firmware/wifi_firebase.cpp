@@ -2,31 +2,148 @@
 #include "wifi_firebase.h"
 #include "config.h"
 #include "globals.h"
+#include "node_registry.h"
+#include "sensor_history.h"
+#include "outbox.h"
+#include "metrics.h"
+#include "local_server.h"
+#include "schedule.h"
+#include "log_modules.h"
 #include <ArduinoJson.h>
+#include <esp_task_wdt.h>
+#include <esp_timer.h>
 
 // WiFi credentials
-const char* ssid = "YOUR_WIFI_SSID";
-const char* password = "YOUR_WIFI_PASSWORD";
+const char* ssid = WIFI_SSID;
+const char* password = WIFI_PASSWORD;
 
 // Firebase objects
 FirebaseData fbdo;
+FirebaseData stream;  // Dedicated connection for the /greenhouses listener
 FirebaseAuth auth;
 FirebaseConfig config;
 
+// Queues between the main loop and the cloud sync task
+SpscRing<TelemetryUpdate, CLOUD_QUEUE_SIZE> telemetryQueue;
+SpscRing<CloudCommand, CLOUD_QUEUE_SIZE> cloudCommandQueue;
+SpscRing<ControlAllEvent, 4> controlAllQueue;
+
+// Cloud task's own copy of greenhouse state; only the cloud task touches it
+// after startCloudSyncTask(). dirtyFields holds bits not yet uploaded.
+static GreenhouseData cloudState[MAX_GREENHOUSES + 1];
+static uint32_t cloudDirtyNodes = 0;  // Bit per nodeId with unsent fields
+
+// Per-node RTDB paths, formatted once in startCloudSyncTask() so the cloud
+// task never builds them from String pieces
+static char settingsPaths[MAX_GREENHOUSES + 1][28];     // "/greenhouses/3/settings"
+static char settingsPrefixes[MAX_GREENHOUSES + 1][16];  // "3/settings/", in a root stream event
+
+// Threshold, hysteresis, mode, schedule, manual command and vent target
+#define SETTINGS_COMMANDS_MAX 6
+static_assert(SETTINGS_COMMANDS_MAX < CLOUD_QUEUE_SIZE, "One node's settings must fit cloudCommandQueue");
+static uint32_t settingsRereadNodes = 0;  // Bit per nodeId whose changes did not fit cloudCommandQueue
+
 // External references
 extern GreenhouseData greenhouses[];
 extern Adafruit_SSD1306 display;
 
+// Connection state is tracked from WiFi events instead of polling in a loop
+static volatile bool wifiConnected = false;
+static unsigned long nextWiFiAttempt = 0;
+static unsigned long wifiRetryDelay = WIFI_RECONNECT_INITIAL;
+static uint8_t wifiAttempts = 0;  // Since the last connection
+
+// Access point of the last connection. RTC memory survives watchdog and
+// software resets (not power loss), so after a reset the station connects
+// straight to the known BSSID and channel instead of scanning every channel,
+// which also takes the radio away from ESP-NOW.
+#define WIFI_CACHE_MAGIC 0x57494649  // "WIFI"
+
+struct WiFiCache {
+  uint32_t magic;
+  uint8_t bssid[6];
+  uint8_t channel;
+};
+
+RTC_NOINIT_ATTR static WiFiCache wifiCache;
+
+static bool wifiCacheValid() {
+  return wifiCache.magic == WIFI_CACHE_MAGIC && wifiCache.channel >= 1 && wifiCache.channel <= 13;
+}
+
+uint8_t cachedWiFiChannel() {
+  return wifiCacheValid() ? wifiCache.channel : 0;
+}
+
+// Attempts alternate between the cached access point and a full scan, in
+// case the router came back on another channel
+static void beginWiFi() {
+  if (wifiCacheValid() && wifiAttempts % 2 == 0) {
+    WiFi.begin(ssid, password, wifiCache.channel, wifiCache.bssid);
+    LOGI(LogCloud, "Connecting to WiFi on channel %u", wifiCache.channel);
+  } else {
+    WiFi.begin(ssid, password);
+    LOGI(LogCloud, "Connecting to WiFi");
+  }
+  wifiAttempts++;
+}
+
+// Runs in the WiFi event task
+static void onWiFiEvent(WiFiEvent_t event) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      wifiConnected = true;
+      wifiAttempts = 0;
+      memcpy(wifiCache.bssid, WiFi.BSSID(), 6);
+      wifiCache.channel = WiFi.channel();
+      wifiCache.magic = WIFI_CACHE_MAGIC;
+      {
+        IPAddress ip = WiFi.localIP();
+        LOGI(LogCloud, "WiFi connected, IP: %u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+      }
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      if (wifiConnected) {
+        LOGW(LogCloud, "WiFi connection lost");
+      }
+      wifiConnected = false;
+      break;
+    default:
+      break;
+  }
+}
+
+// Runs on the cloud sync task, so it must not touch the display
 void initWiFi() {
-  WiFi.mode(WIFI_AP_STA);
-  WiFi.begin(ssid, password);
-  Serial.print("Connecting to WiFi ..");
+  WiFi.onEvent(onWiFiEvent);
+  WiFi.setAutoReconnect(false);  // Reconnects are paced by handleWiFiConnection()
+  beginWiFi();
+  nextWiFiAttempt = millis() + wifiRetryDelay;
   
-  display.clearDisplay();
-  display.setCursor(0, 0);
-  display.println("Connecting to WiFi:");
-  display.println(ssid);
-  display.display();
+  // SNTP keeps retrying and resyncing in the background once WiFi is up
+  configTzTime(TIME_ZONE, NTP_SERVER);
+}
+
+// Non-blocking: starts a reconnect attempt when the backoff has expired and
+// returns immediately. The outcome arrives as a WiFi event.
+void handleWiFiConnection() {
+  if (wifiConnected) {
+    wifiRetryDelay = WIFI_RECONNECT_INITIAL;
+    return;
+  }
+  
+  if ((long)(millis() - nextWiFiAttempt) < 0) {
+    return;
+  }
+  
+  WiFi.disconnect();
+  beginWiFi();
+  nextWiFiAttempt = millis() + wifiRetryDelay;
+  wifiRetryDelay = min(wifiRetryDelay * 2, (unsigned long)WIFI_RECONNECT_MAX);
+}
+
+bool isWiFiConnected() {
+  return wifiConnected;
 }
 
 void initFirebase() {
@@ -42,134 +159,546 @@ void initFirebase() {
   Firebase.begin(&config, &auth);
   Firebase.reconnectWiFi(true);
   
-  Serial.println("Firebase initialized");
+  LOGI(LogCloud, "Firebase initialized");
+}
+
+// Adds a multi-path key such as "3/currentData/temperature" to the update.
+// add() keeps the key literal, so the update only touches these leaves.
+template <typename T>
+static void addField(FirebaseJson &json, int nodeId, const char* field, T value) {
+  char key[48];
+  snprintf(key, sizeof(key), "%d/%s", nodeId, field);
+  json.add(key, value);
+}
+
+static void addDirtyFields(FirebaseJson &json, int i, uint16_t dirty) {
+  const GreenhouseData &gh = cloudState[i];
+  
+  if (dirty & DIRTY_TEMPERATURE) addField(json, i, "currentData/temperature", gh.sensor.temperature);
+  if (dirty & DIRTY_HUMIDITY) addField(json, i, "currentData/humidity", gh.sensor.humidity);
+  if (dirty & DIRTY_PRESSURE) addField(json, i, "currentData/pressure", gh.sensor.pressure);
+  if (dirty & DIRTY_VENT_STATUS) {
+    addField(json, i, "currentData/ventStatus", gh.sensor.ventStatus);
+    addField(json, i, "settings/ventStatus", ventStatusName(gh.sensor.ventStatus));
+  }
+  if (dirty & DIRTY_VENT_POSITION) addField(json, i, "currentData/ventPosition", gh.sensor.ventPosition);
+  if (dirty & DIRTY_MOTOR_STATS) {
+    addField(json, i, "currentData/motorSeconds", gh.sensor.motorSeconds);
+    addField(json, i, "currentData/motorCycles", gh.sensor.motorCycles);
+  }
+  if (dirty & DIRTY_TIMESTAMP) {
+    addField(json, i, "currentData/nodeId", gh.sensor.nodeId);
+    addField(json, i, "currentData/timestamp", gh.sensor.timestamp);
+  }
+  
+  if (dirty & DIRTY_THRESHOLD) addField(json, i, "settings/temperatureThreshold", gh.settings.temperatureThreshold);
+  if (dirty & DIRTY_HYSTERESIS) addField(json, i, "settings/hysteresis", gh.settings.hysteresis);
+  if (dirty & DIRTY_MODE) addField(json, i, "settings/mode", gh.settings.autoMode ? "auto" : "manual");
+  if (dirty & DIRTY_SCHEDULE) {
+    addField(json, i, "settings/scheduleOpenHour", gh.settings.schedule.openHour);
+    addField(json, i, "settings/scheduleOpenMinute", gh.settings.schedule.openMinute);
+    addField(json, i, "settings/scheduleCloseHour", gh.settings.schedule.closeHour);
+    addField(json, i, "settings/scheduleCloseMinute", gh.settings.schedule.closeMinute);
+    addField(json, i, "settings/scheduleEnabled", gh.settings.schedule.scheduleEnabled);
+  }
 }
 
 void syncWithFirebase() {
+  // Nothing changed: return before any Firebase object is built
+  uint32_t sentNodes = cloudDirtyNodes;
+  if (sentNodes == 0) {
+    return;
+  }
+  
   if (!Firebase.ready()) {
-    Serial.println("Firebase not ready");
+    LOGD(LogCloud, "Firebase not ready");
     return;
   }
 
-  // Upload all greenhouse data to Firebase
-  for (int i = 1; i <= MAX_GREENHOUSES; i++) {
-    if (greenhouses[i].isOnline && 
-        (millis() - greenhouses[i].lastSeen < 300000)) {
-      
-      // Create JSON payload to send
-      FirebaseJson json;
-      json.set("nodeId", greenhouses[i].sensor.nodeId);
-      json.set("temperature", greenhouses[i].sensor.temperature);
-      json.set("humidity", greenhouses[i].sensor.humidity);
-      json.set("pressure", greenhouses[i].sensor.pressure);
-      json.set("ventStatus", greenhouses[i].sensor.ventStatus);
-      json.set("timestamp", greenhouses[i].sensor.timestamp);
+  // Upload only the fields that changed since the last successful sync,
+  // batched into a single multi-path update for all greenhouses
+  FirebaseJson json;
+  uint16_t sentFields[MAX_GREENHOUSES + 1] = {0};
+  
+  for (uint32_t pending = sentNodes; pending != 0; pending &= pending - 1) {
+    int i = __builtin_ctz(pending);
+    sentFields[i] = cloudState[i].dirtyFields;
+    addDirtyFields(json, i, sentFields[i]);
+  }
+  
+  if (Firebase.RTDB.updateNode(&fbdo, "/greenhouses", &json)) {
+    for (uint32_t pending = sentNodes; pending != 0; pending &= pending - 1) {
+      int i = __builtin_ctz(pending);
+      cloudState[i].dirtyFields &= ~sentFields[i];
+      if (cloudState[i].dirtyFields == 0) {
+        cloudDirtyNodes &= ~(1UL << i);
+      }
+    }
+    LOGI(LogCloud, "Uploaded greenhouse changes");
+  } else {
+    LOGW(LogCloud, "Failed to upload: %s", fbdo.errorReason().c_str());
+  }
+}
+
+// Looks up prefix + field; the key is built on the stack and string values
+// are compared in place in result.stringValue
+static bool getSetting(FirebaseJson &json, FirebaseJsonData &result, const char *prefix, const char *field) {
+  char key[48];
+  snprintf(key, sizeof(key), "%s%s", prefix, field);
+  json.get(result, key);
+  return result.success;
+}
+
+// Applies the settings fields found in json under prefix (e.g. "3/settings/").
+// Changes are queued for the main loop, which owns greenhouses[] and ESP-NOW.
+// A node's changes are queued all or nothing, and the known settings only
+// move on once they are; if cloudCommandQueue is full the node is read back
+// from Firebase later (see rereadSettings()), so no change is lost.
+static void applySettingsJson(int nodeId, FirebaseJson &json, const char *prefix) {
+  FirebaseJsonData result;
+  GreenhouseSettings known = cloudState[nodeId].settings;
+  CloudCommand commands[SETTINGS_COMMANDS_MAX];
+  int count = 0;
+  bool clearManual = false;
+  bool clearTarget = false;
+  CloudCommand command = {};
+  command.nodeId = nodeId;
+  
+  // Extract threshold
+  if (getSetting(json, result, prefix, "temperatureThreshold")) {
+    float newThreshold = result.to<float>();
+    if (newThreshold != known.temperatureThreshold) {
+      known.temperatureThreshold = newThreshold;
+      command.type = CLOUD_SET_THRESHOLD;
+      command.value = newThreshold;
+      commands[count++] = command;
+    }
+  }
+  
+  // Extract hysteresis
+  if (getSetting(json, result, prefix, "hysteresis")) {
+    float newHysteresis = result.to<float>();
+    if (newHysteresis != known.hysteresis) {
+      known.hysteresis = newHysteresis;
+      command.type = CLOUD_SET_HYSTERESIS;
+      command.value = newHysteresis;
+      commands[count++] = command;
+    }
+  }
+  
+  // Extract mode
+  if (getSetting(json, result, prefix, "mode")) {
+    bool newAutoMode = strcmp(result.stringValue.c_str(), "auto") == 0;
+    if (newAutoMode != known.autoMode) {
+      known.autoMode = newAutoMode;
+      command.type = CLOUD_SET_MODE;
+      command.autoMode = newAutoMode;
+      commands[count++] = command;
+    }
+  }
+  
+  // Extract schedule; fields missing from the event keep their value
+  ScheduleSettings schedule = known.schedule;
+  if (getSetting(json, result, prefix, "scheduleOpenHour")) schedule.openHour = result.to<int>();
+  if (getSetting(json, result, prefix, "scheduleOpenMinute")) schedule.openMinute = result.to<int>();
+  if (getSetting(json, result, prefix, "scheduleCloseHour")) schedule.closeHour = result.to<int>();
+  if (getSetting(json, result, prefix, "scheduleCloseMinute")) schedule.closeMinute = result.to<int>();
+  if (getSetting(json, result, prefix, "scheduleEnabled")) schedule.scheduleEnabled = result.to<bool>();
+  if (isValidSchedule(schedule) && !sameSchedule(schedule, known.schedule)) {
+    known.schedule = schedule;
+    command.type = CLOUD_SET_SCHEDULE;
+    command.schedule = schedule;
+    commands[count++] = command;
+  }
+  
+  // Extract manual control command
+  if (getSetting(json, result, prefix, "manualControl")) {
+    char manualCmd = manualCommandFor(result.stringValue.c_str());
+    
+    if (manualCmd != 0) {
+      command.type = CLOUD_MANUAL_COMMAND;
+      command.manualCommand = manualCmd;
+      commands[count++] = command;
+      clearManual = true;
+    }
+  }
+  
+  // Extract move-to-position command, percent open
+  if (getSetting(json, result, prefix, "ventTarget") && strcmp(result.type.c_str(), "int") == 0) {
+    int target = result.to<int>();
+    
+    if (target >= 0 && target <= 100) {
+      command.type = CLOUD_MANUAL_COMMAND;
+      command.manualCommand = 'P';
+      command.value = target;
+      commands[count++] = command;
+      clearTarget = true;
+    }
+  }
+  
+  if (count == 0) {
+    return;
+  }
+  
+  // This task is the only producer, so the space checked cannot shrink
+  if (cloudCommandQueue.space() < (size_t)count) {
+    LOGD(LogCloud, "Command queue full, node %d settings read again later", nodeId);
+    settingsRereadNodes |= 1UL << nodeId;
+    return;
+  }
+  for (int n = 0; n < count; n++) {
+    cloudCommandQueue.push(commands[n]);
+  }
+  cloudState[nodeId].settings = known;
+  
+  // Clear the one-shot commands in Firebase; json is not used beyond here,
+  // so it may belong to fbdo
+  if (clearManual || clearTarget) {
+    FirebaseJson clearJson;
+    if (clearManual) clearJson.set("manualControl", (const char*)NULL);
+    if (clearTarget) clearJson.set("ventTarget", (const char*)NULL);
+    Firebase.RTDB.updateNode(&fbdo, settingsPaths[nodeId], &clearJson);
+  }
+}
+
+// Reads back the settings of one node whose changes found cloudCommandQueue
+// full, once the main loop has made room for them
+static void rereadSettings() {
+  if (settingsRereadNodes == 0 || cloudCommandQueue.space() < SETTINGS_COMMANDS_MAX) {
+    return;
+  }
+  
+  int nodeId = __builtin_ctz(settingsRereadNodes);
+  if (!Firebase.RTDB.getJSON(&fbdo, settingsPaths[nodeId])) {
+    LOGW(LogCloud, "Settings read failed: %s", fbdo.errorReason().c_str());
+    return;
+  }
+  settingsRereadNodes &= ~(1UL << nodeId);
+  applySettingsJson(nodeId, fbdo.jsonObject(), "");
+}
+
+// Dispatches one event from the /greenhouses stream. The event path tells
+// how deep the write was: "/", "/3", "/3/settings" or "/3/settings/mode".
+// Writes outside settings (including our own currentData uploads) are ignored.
+static void handleStreamEvent() {
+  // The library hands out copies; take each once and parse it in place
+  String eventPath = stream.dataPath();
+  String eventType = stream.dataType();
+  const char *path = eventPath.c_str();
+  bool isJson = strcmp(eventType.c_str(), "json") == 0;
+  bool isNull = strcmp(eventType.c_str(), "null") == 0;
+  
+  if (strcmp(path, "/") == 0) {
+    if (!isJson) return;
+    FirebaseJson &json = stream.jsonObject();
+    for (int i = 1; i <= MAX_GREENHOUSES; i++) {
+      applySettingsJson(i, json, settingsPrefixes[i]);
+    }
+    return;
+  }
+  
+  // Split "/<nodeId>[/settings[/<field>]]"
+  char *nodeEnd;
+  long nodeId = strtol(path + 1, &nodeEnd, 10);
+  if (!isValidNodeId(nodeId)) return;
+  
+  const char *rest = *nodeEnd == '/' ? nodeEnd + 1 : "";
+  
+  if (*rest == '\0' && isJson) {
+    applySettingsJson(nodeId, stream.jsonObject(), "settings/");
+  } else if (strcmp(rest, "settings") == 0 && isJson) {
+    applySettingsJson(nodeId, stream.jsonObject(), "");
+  } else if (strncmp(rest, "settings/", 9) == 0 && !isNull) {
+    // Single leaf write; wrap it so it goes through the same parser
+    char wrapped[96];
+    int length = snprintf(wrapped, sizeof(wrapped), "{\"%s\":%s}", rest + 9, stream.payload().c_str());
+    if (length < 0 || length >= (int)sizeof(wrapped)) {
+      LOGW(LogCloud, "Ignoring oversized settings write: %s", path);
+      return;
+    }
+    FirebaseJson json;
+    json.setJsonData(wrapped);
+    applySettingsJson(nodeId, json, "");
+  }
+}
+
+// Merges a snapshot from the main loop into the cloud task's state
+static void mergeTelemetry(const TelemetryUpdate &update) {
+  GreenhouseData &shadow = cloudState[update.nodeId];
+  
+  shadow.sensor = update.sensor;
+  if (update.fields & DIRTY_THRESHOLD) shadow.settings.temperatureThreshold = update.settings.temperatureThreshold;
+  if (update.fields & DIRTY_HYSTERESIS) shadow.settings.hysteresis = update.settings.hysteresis;
+  if (update.fields & DIRTY_MODE) shadow.settings.autoMode = update.settings.autoMode;
+  if (update.fields & DIRTY_SCHEDULE) shadow.settings.schedule = update.settings.schedule;
+  shadow.dirtyFields |= update.fields;
+  cloudDirtyNodes |= 1UL << update.nodeId;
+}
+
+static void uploadControlAllEvent(const ControlAllEvent &event) {
+  FirebaseJson json;
+  json.set("action", event.command == 'O' ? "open" : "close");
+  json.set("timestamp", event.timestamp);
+  Firebase.RTDB.setJSON(&fbdo, "/system/lastControlAll", &json);
+}
+
+static void uploadMetrics() {
+  static char metrics[METRICS_JSON_MAX];
+  if (formatMetricsJson(metrics, sizeof(metrics)) == 0) {
+    return;
+  }
+  
+  FirebaseJson json;
+  json.setJsonData(metrics);
+  json.set("uploadedAt/.sv", "timestamp");
+  
+  if (!Firebase.RTDB.setJSON(&fbdo, "/system/metrics", &json)) {
+    LOGW(LogCloud, "Metrics upload failed: %s", fbdo.errorReason().c_str());
+  }
+}
+
+// Pushes one batch of recorded history to /history and returns the delay
+// until the next upload. A backlog left by an outage drains one batch per
+// sync interval.
+static unsigned long uploadHistory() {
+  FirebaseJson json;
+  if (!buildHistoryBatch(json)) {
+    return HISTORY_UPLOAD_INTERVAL;
+  }
+  
+  // Points carry hub uptime; the server timestamp anchors them in wall-clock time
+  json.set("uptime", (int)(esp_timer_get_time() / 1000000));
+  json.set("uploadedAt/.sv", "timestamp");
+  
+  if (!Firebase.RTDB.pushJSON(&fbdo, "/history", &json)) {
+    LOGW(LogCloud, "History upload failed: %s", fbdo.errorReason().c_str());
+    return FIREBASE_SYNC_INTERVAL;
+  }
+  
+  commitHistoryBatch();
+  return hasHistoryBacklog() ? FIREBASE_SYNC_INTERVAL : HISTORY_UPLOAD_INTERVAL;
+}
+
+// Uploads the oldest outbox records to /log as one batch
+static void drainOutbox() {
+  FirebaseJson json;
+  if (!buildOutboxBatch(json)) {
+    return;
+  }
+  
+  if (Firebase.RTDB.pushJSON(&fbdo, "/log", &json)) {
+    commitOutboxBatch();
+  } else {
+    LOGW(LogCloud, "Outbox upload failed: %s", fbdo.errorReason().c_str());
+  }
+}
+
+static void cloudSyncTask(void *parameter) {
+  esp_task_wdt_add(NULL);
+  
+  bool firebaseStarted = false;
+  bool streamStarted = false;
+  unsigned long lastSync = 0;
+  unsigned long lastOutboxDrain = 0;
+  unsigned long lastHistoryUpload = 0;
+  unsigned long lastMetricsUpload = 0;
+  unsigned long historyUploadDelay = HISTORY_UPLOAD_INTERVAL;
+  
+  initOutbox();
+  initWiFi();
+  
+  for (;;) {
+    esp_task_wdt_reset();
+    
+    TelemetryUpdate update;
+    while (telemetryQueue.pop(update)) {
+      mergeTelemetry(update);
+    }
+    processHistorySamples();
+    
+    unsigned long currentMillis = millis();
+    
+    handleWiFiConnection();
+    
+    if (!isWiFiConnected()) {
+      historyUploadDelay = 0;  // Flush the history as soon as the link is back
+    } else {
+      if (!firebaseStarted) {
+        initFirebase();
+        firebaseStarted = true;
+      }
       
-      // Path to the sensor data
-      String path = "/greenhouses/" + String(i) + "/currentData";
+      // Settings changes arrive as stream events instead of being polled
+      if (Firebase.ready() && !streamStarted) {
+        streamStarted = Firebase.RTDB.beginStream(&stream, "/greenhouses");
+        if (!streamStarted) {
+          LOGW(LogCloud, "Stream start failed: %s", stream.errorReason().c_str());
+        }
+      }
       
-      // Update the data using correct API
-      if (Firebase.RTDB.setJSON(&fbdo, path.c_str(), &json)) {
-        Serial.println("Uploaded data for greenhouse " + String(i));
-      } else {
-        Serial.println("Failed to upload: " + fbdo.errorReason());
+      if (streamStarted) {
+        if (!Firebase.RTDB.readStream(&stream)) {
+          LOGW(LogCloud, "Stream read failed: %s", stream.errorReason().c_str());
+        } else if (stream.streamAvailable()) {
+          handleStreamEvent();
+        }
+      }
+      if (Firebase.ready()) {
+        rereadSettings();
       }
       
-      // Now update settings
-      FirebaseJson settingsJson;
-      settingsJson.set("temperatureThreshold", greenhouses[i].settings.temperatureThreshold);
-      settingsJson.set("hysteresis", greenhouses[i].settings.hysteresis);
-      settingsJson.set("mode", greenhouses[i].settings.autoMode ? "auto" : "manual");
+      ControlAllEvent event;
+      while (Firebase.ready() && controlAllQueue.pop(event)) {
+        uploadControlAllEvent(event);
+      }
       
-      String ventStatus;
-      switch (greenhouses[i].sensor.ventStatus) {
-        case 0: ventStatus = "closed"; break;
-        case 1: ventStatus = "opening"; break;
-        case 2: ventStatus = "open"; break;
-        case 3: ventStatus = "closing"; break;
-        default: ventStatus = "unknown"; break;
-      }
-      settingsJson.set("ventStatus", ventStatus);
+      if (currentMillis - lastSync >= FIREBASE_SYNC_INTERVAL) {
+        SlowSectionTimer timer(SECTION_FIREBASE_SYNC);
+        syncWithFirebase();
+        lastSync = millis();
+      }
       
-      // Add schedule data
-      settingsJson.set("scheduleOpenHour", greenhouses[i].settings.schedule.openHour);
-      settingsJson.set("scheduleOpenMinute", greenhouses[i].settings.schedule.openMinute);
-      settingsJson.set("scheduleCloseHour", greenhouses[i].settings.schedule.closeHour);
-      settingsJson.set("scheduleCloseMinute", greenhouses[i].settings.schedule.closeMinute);
-      settingsJson.set("scheduleEnabled", greenhouses[i].settings.schedule.scheduleEnabled);
+      // Rate-limited so a long backlog does not starve the stream and sync
+      if (Firebase.ready() && currentMillis - lastOutboxDrain >= OUTBOX_DRAIN_INTERVAL &&
+          outboxFlushDue()) {
+        drainOutbox();
+        lastOutboxDrain = millis();
+      }
       
-      // Path to settings
-      path = "/greenhouses/" + String(i) + "/settings";
+      if (Firebase.ready() && currentMillis - lastHistoryUpload >= historyUploadDelay) {
+        historyUploadDelay = uploadHistory();
+        lastHistoryUpload = millis();
+      }
       
-      // Update settings
-      Firebase.RTDB.setJSON(&fbdo, path.c_str(), &settingsJson);
+      if (Firebase.ready() && currentMillis - lastMetricsUpload >= METRICS_UPLOAD_INTERVAL) {
+        uploadMetrics();
+        lastMetricsUpload = millis();
+      }
     }
+    
+    vTaskDelay(pdMS_TO_TICKS(CLOUD_TASK_PERIOD));
   }
-  
-  // Download settings and control commands from Firebase
+}
+
+void startCloudSyncTask() {
+  // Seed the cloud task's view with the settings restored from EEPROM
   for (int i = 1; i <= MAX_GREENHOUSES; i++) {
-    String path = "/greenhouses/" + String(i) + "/settings";
+    cloudState[i].settings = greenhouses[i].settings;
+    snprintf(settingsPaths[i], sizeof(settingsPaths[i]), "/greenhouses/%d/settings", i);
+    snprintf(settingsPrefixes[i], sizeof(settingsPrefixes[i]), "%d/settings/", i);
+  }
+  
+  xTaskCreatePinnedToCore(cloudSyncTask, "cloudSync", CLOUD_TASK_STACK_SIZE,
+                          NULL, CLOUD_TASK_PRIORITY, NULL, CLOUD_TASK_CORE);
+}
+
+void publishTelemetry() {
+  for (uint8_t n = 0; n < activeNodeCount; n++) {
+    uint8_t i = activeNodes[n];
+    if (greenhouses[i].dirtyFields == 0 ||
+        !greenhouses[i].isOnline ||
+        (millis() - greenhouses[i].lastSeen >= NODE_TIMEOUT)) {
+      continue;
+    }
     
-    if (Firebase.RTDB.getJSON(&fbdo, path.c_str())) {
-      if (fbdo.dataType() == "json") {
-        FirebaseJson &json = fbdo.jsonObject();
-        FirebaseJsonData result;
-        
-        // Extract threshold
-        json.get(result, "temperatureThreshold");
-        if (result.success) {
-          float newThreshold = result.to<float>();
-          if (newThreshold != greenhouses[i].settings.temperatureThreshold) {
-            greenhouses[i].settings.temperatureThreshold = newThreshold;
-            sendControlToNode(i);
-          }
-        }
-        
-        // Extract hysteresis
-        json.get(result, "hysteresis");
-        if (result.success) {
-          float newHysteresis = result.to<float>();
-          if (newHysteresis != greenhouses[i].settings.hysteresis) {
-            greenhouses[i].settings.hysteresis = newHysteresis;
-            sendControlToNode(i);
-          }
-        }
-        
-        // Extract mode
-        json.get(result, "mode");
-        if (result.success) {
-          String mode = result.to<String>();
-          bool newAutoMode = (mode == "auto");
-          if (newAutoMode != greenhouses[i].settings.autoMode) {
-            greenhouses[i].settings.autoMode = newAutoMode;
-            sendControlToNode(i);
-          }
-        }
-        
-        // Extract manual control command
-        json.get(result, "manualControl");
-        if (result.success) {
-          String command = result.to<String>();
-          char manualCmd = 0;
-          
-          if (command == "open") manualCmd = 'O';
-          else if (command == "close") manualCmd = 'C';
-          else if (command == "stop") manualCmd = 'S';
-          
-          if (manualCmd != 0) {
-            greenhouses[i].settings.manualCommand = manualCmd;
-            sendControlToNode(i);
-            
-            // Clear the command in Firebase
-            FirebaseJson clearJson;
-            clearJson.set("manualControl", (const char*)NULL);
-            Firebase.RTDB.updateNode(&fbdo, path.c_str(), &clearJson);
-          }
-        }
-        
-        // Save updated settings to EEPROM
-        saveSettingsToEEPROM();
-      }
+    TelemetryUpdate update;
+    update.nodeId = i;
+    update.fields = greenhouses[i].dirtyFields;
+    update.sensor = greenhouses[i].sensor;
+    update.settings = greenhouses[i].settings;
+    
+    if (!telemetryQueue.push(update)) {
+      return;  // Queue full, the cloud task is behind; retry next loop
     }
+    greenhouses[i].dirtyFields &= ~update.fields;
+  }
+}
+
+// Greenhouses touched by a batch of commands, bit per nodeId
+struct CommandEffects {
+  uint32_t control;    // Need sendControlToNode()
+  uint32_t settings;   // Need an EEPROM write
+  uint32_t schedules;  // Need their schedule events rebuilt
+};
+
+// Applies one queued change to greenhouses[]; returns the DirtyField bit of
+// a setting that changed, or 0
+static uint16_t applyCommand(const CloudCommand &command, CommandEffects &effects) {
+  GreenhouseSettings &settings = greenhouses[command.nodeId].settings;
+  uint32_t nodeBit = 1UL << command.nodeId;
+  uint16_t changed = 0;
+  
+  switch (command.type) {
+    case CLOUD_SET_THRESHOLD:
+      if (settings.temperatureThreshold != command.value) {
+        settings.temperatureThreshold = command.value;
+        changed = DIRTY_THRESHOLD;
+      }
+      break;
+    case CLOUD_SET_HYSTERESIS:
+      if (settings.hysteresis != command.value) {
+        settings.hysteresis = command.value;
+        changed = DIRTY_HYSTERESIS;
+      }
+      break;
+    case CLOUD_SET_MODE:
+      if (settings.autoMode != command.autoMode) {
+        settings.autoMode = command.autoMode;
+        changed = DIRTY_MODE;
+      }
+      break;
+    case CLOUD_MANUAL_COMMAND:
+      settings.manualCommand = command.manualCommand;
+      settings.ventTarget = command.manualCommand == 'P' ? (uint8_t)command.value : 0;
+      effects.control |= nodeBit;
+      break;
+    case CLOUD_SET_SCHEDULE:
+      // The schedule runs on the hub; the node's ControlFrame only carries
+      // whether it has one (CONTROL_FLAG_FALLBACK_AUTO)
+      if (!sameSchedule(settings.schedule, command.schedule)) {
+        settings.schedule = command.schedule;
+        effects.schedules |= nodeBit;
+        changed = DIRTY_SCHEDULE;
+      }
+      break;
+  }
+  
+  if (changed != 0) {
+    effects.control |= nodeBit;
+    effects.settings |= nodeBit;
   }
+  return changed;
+}
+
+// Applies all queued cloud and local API changes, then sends at most one
+// control message and writes at most one EEPROM block per greenhouse that
+// actually changed
+void processCloudCommands() {
+  CloudCommand command;
+  CommandEffects effects = {};
+  
+  while (cloudCommandQueue.pop(command)) {
+    applyCommand(command, effects);
+  }
+  
+  // Changes made on the local API are uploaded to Firebase as well
+  while (localCommandQueue.pop(command)) {
+    greenhouses[command.nodeId].dirtyFields |= applyCommand(command, effects);
+  }
+  
+  if ((effects.control | effects.settings) == 0) {
+    return;
+  }
+  displayRefreshRequested = true;
+  
+  for (uint32_t pending = effects.control; pending != 0; pending &= pending - 1) {
+    sendControlToNode(__builtin_ctz(pending));
+  }
+  for (uint32_t pending = effects.schedules; pending != 0; pending &= pending - 1) {
+    scheduleChanged(__builtin_ctz(pending));
+  }
+  publishLocalState(effects.settings);
+  
+  // Save updated settings to EEPROM
+  saveChangedSettingsToEEPROM(effects.settings);
 }
@@ -0,0 +1,29 @@
+#ifndef WIFI_FIREBASE_H
+#define WIFI_FIREBASE_H
+
+#include <WiFi.h>
+#include <Adafruit_SSD1306.h>
+#include <Firebase_ESP_Client.h>
+#include "config.h"
+#include "data_structures.h"
+#include <ring_buffer.h>
+
+// Queues between the main loop (core 1) and the cloud sync task (core 0)
+extern SpscRing<TelemetryUpdate, CLOUD_QUEUE_SIZE> telemetryQueue;    // loop -> cloud
+extern SpscRing<CloudCommand, CLOUD_QUEUE_SIZE> cloudCommandQueue;    // cloud -> loop
+extern SpscRing<ControlAllEvent, 4> controlAllQueue;                  // loop -> cloud
+
+// Function declarations
+void initWiFi();
+void handleWiFiConnection();
+bool isWiFiConnected();
+uint8_t cachedWiFiChannel();  // Router channel before the last reset, 0 if unknown
+void initFirebase();
+void syncWithFirebase();
+void startCloudSyncTask();
+
+// Main loop side of the cloud bridge
+void publishTelemetry();
+void processCloudCommands();
+
+#endif
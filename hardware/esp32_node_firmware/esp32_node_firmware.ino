@@ -1,21 +1,35 @@
 
 /*
  * ESP32 Node Firmware for Greenhouse Automation System
- * 
+ *
  * This firmware runs on ESP32 nodes (one per greenhouse) to:
  * - Read BME280 temperature/humidity/pressure sensor
  * - Control 2-channel relay module for vent motor
  * - Communicate with ESP32 hub via ESP-NOW
  * - Operate autonomously with temperature-based control
  * - Store settings in EEPROM for power-loss recovery
+ * - Optionally duty-cycle with deep sleep for battery/solar nodes (LOW_POWER_MODE)
+ *
+ * The node logic lives in the GreenhouseNodeCore library, shared with the
+ * ESP-01 node; this sketch supplies the board traits, the ESP32 ESP-NOW
+ * glue, the watchdog and deep sleep.
  */
 
 #include <WiFi.h>
 #include <esp_now.h>
+#include <esp_wifi.h>
 #include <Wire.h>
 #include <Adafruit_BME280.h>
 #include <EEPROM.h>
 #include <esp_task_wdt.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+
+// Serial logging, see greenhouse_log.h; LOG_LEVEL_WARN or LOG_LEVEL_NONE in production
+#define LOG_MAX_LEVEL LOG_LEVEL_INFO
+
+#include <greenhouse_protocol.h>
+#include <node_core.h>
 
 // ----- NODE CONFIGURATION -----
 #define NODE_ID 1  // CHANGE THIS FOR EACH NODE (1-6)
@@ -27,98 +41,109 @@
 #define RELAY_OPEN_PIN 16
 #define RELAY_CLOSE_PIN 17
 #define STATUS_LED_PIN 2
+#define LIMIT_OPEN_PIN -1    // Optional vent limit switches to GND, -1 if not fitted
+#define LIMIT_CLOSED_PIN -1
 
 // Timing Configuration
 #define SENSOR_READ_INTERVAL 10000    // Read sensors every 10 seconds
-#define ESP_NOW_SEND_INTERVAL 30000   // Send data every 30 seconds
 #define CONTROL_CHECK_INTERVAL 5000   // Check control logic every 5 seconds
 #define MOTOR_OPERATION_TIME 30000    // Motor run time for full open/close
 #define MOTOR_COOLDOWN_TIME 60000     // Minimum time between motor operations
+#define HUB_TIMEOUT 300000            // No contact for 5 minutes: autonomous
 
-// Hub MAC Address - UPDATE THIS TO MATCH YOUR HUB
-uint8_t hubMacAddress[] = {0x24, 0x6F, 0x28, 0xAB, 0xCD, 0xEF}; // CHANGE THIS
-
-// ----- DATA STRUCTURES -----
-struct SensorData {
-  uint8_t nodeId;
-  float temperature;
-  float humidity;
-  float pressure;
-  uint8_t ventStatus; // 0:closed, 1:opening, 2:open, 3:closing
-  uint32_t timestamp;
-};
+// Vent control: 0 opens/closes fully on the threshold, 1 uses the
+// temperature trend and partial vent positions (see vent_controller.h)
+#define PREDICTIVE_CONTROL 0
 
-struct ScheduleSettings {
-  uint8_t openHour = 8;
-  uint8_t openMinute = 0;
-  uint8_t closeHour = 18;
-  uint8_t closeMinute = 0;
-  bool scheduleEnabled = false;
-};
+// Low-power mode: wake, take one reading, report, listen briefly for a
+// control message and deep sleep again. The node stays awake while the motor runs.
+#define LOW_POWER_MODE 0              // Set to 1 for battery/solar nodes
+#define LOW_POWER_LISTEN_TIME 200     // Time to wait for a control message after reporting
+#define LOW_POWER_SLEEP_TIME 30000     // Wake to sample every 30 seconds
 
-struct GreenhouseSettings {
-  float temperatureThreshold = 25.0;
-  float hysteresis = 0.5;
-  bool autoMode = true;
-  char manualCommand = 0;
-  ScheduleSettings schedule;
-};
-
-struct ControlMessage {
-  uint8_t targetNodeId;
-  float tempThreshold;
-  float hysteresis;
-  bool autoMode;
-  char manualCommand;
-};
+// Hub address and channel are found over the air, see node_core.h
+uint8_t hubMacAddress[6];
+const uint8_t broadcastMac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 
 // ----- GLOBAL VARIABLES -----
-Adafruit_BME280 bme;
-SensorData currentSensorData;
-GreenhouseSettings settings;
-
-// Timing variables
-unsigned long lastSensorRead = 0;
-unsigned long lastESPNowSend = 0;
-unsigned long lastControlCheck = 0;
-unsigned long motorStartTime = 0;
-unsigned long lastMotorOperation = 0;
 unsigned long lastWatchdogFeed = 0;
-
-// Status variables
-bool sensorInitialized = false;
+unsigned long clockBase = 0;        // Time slept in earlier cycles, see nodeMillis()
 bool espNowInitialized = false;
-uint8_t currentVentStatus = 0; // 0:closed, 1:opening, 2:open, 3:closing
-bool motorRunning = false;
-char pendingCommand = 0;
-
-// Error handling
-unsigned long lastErrorTime = 0;
-char lastError[64] = {0};
 
 // ----- FUNCTION DECLARATIONS -----
-void initSensor();
 void initESPNow();
-void readSensorData();
-void sendDataToHub();
-void processControlLogic();
-void executeMotorControl(char command);
-void stopMotor();
-void saveSettingsToEEPROM();
-void loadSettingsFromEEPROM();
+bool addPeer(const uint8_t *mac);
+bool setHubPeer(const uint8_t *mac, uint8_t channel);
+void setRadioChannel(uint8_t channel);
 void onDataReceived(const esp_now_recv_info *recv_info, const uint8_t *data, int len);
 void onDataSent(const uint8_t *mac_addr, esp_now_send_status_t status);
 void feedWatchdog();
 void blinkStatusLED(int count);
-void logError(const char* message);
+unsigned long nodeMillis();
+bool restoreRtcState();
+void enterDeepSleep();
+
+// ----- BOARD TRAITS -----
+struct Esp32Board {
+  static constexpr uint8_t nodeId = NODE_ID;
+  static constexpr uint8_t relayOpenPin = RELAY_OPEN_PIN;
+  static constexpr uint8_t relayClosePin = RELAY_CLOSE_PIN;
+  static constexpr uint8_t sdaPin = BME_SDA_PIN;
+  static constexpr uint8_t sclPin = BME_SCL_PIN;
+  static constexpr int8_t limitOpenPin = LIMIT_OPEN_PIN;
+  static constexpr int8_t limitClosedPin = LIMIT_CLOSED_PIN;
+  static constexpr uint32_t motorTravelTime = MOTOR_OPERATION_TIME;
+  static constexpr uint32_t motorCooldownTime = MOTOR_COOLDOWN_TIME;
+  static constexpr uint32_t sensorReadInterval = SENSOR_READ_INTERVAL;
+  static constexpr uint32_t controlCheckInterval = CONTROL_CHECK_INTERVAL;
+  static constexpr uint32_t hubTimeout = HUB_TIMEOUT;
+  static constexpr bool predictiveControl = PREDICTIVE_CONTROL;
+
+  static unsigned long now() {
+    return nodeMillis();
+  }
+
+  static bool send(const uint8_t *data, size_t len) {
+    return espNowInitialized && esp_now_send(hubMacAddress, data, len) == ESP_OK;
+  }
+
+  static bool broadcast(const uint8_t *data, size_t len) {
+    return espNowInitialized && esp_now_send(broadcastMac, data, len) == ESP_OK;
+  }
+
+  static void setChannel(uint8_t channel) {
+    setRadioChannel(channel);
+  }
+
+  static bool setHub(const uint8_t *mac, uint8_t channel) {
+    return setHubPeer(mac, channel);
+  }
+
+  static void indicate(uint8_t blinks) {
+    blinkStatusLED(blinks);
+  }
+};
+
+NodeCore<Esp32Board> node;
+
+// Node state kept in RTC memory across deep sleep, so a timer wake
+// restores it without reading or writing EEPROM
+#define RTC_STATE_MAGIC 0x47524E32  // "GRN2"
+
+struct RtcState {
+  uint32_t magic;
+  unsigned long clockBase;  // nodeMillis() when millis() was 0 this boot
+  NodeState node;           // Trivially constructible, see node_core.h
+};
+
+RTC_DATA_ATTR RtcState rtcState;
 
 // ----- SETUP -----
 void setup() {
   Serial.begin(115200);
-  Serial.println("ESP32 Greenhouse Node Starting...");
-  Serial.print("Node ID: ");
-  Serial.println(NODE_ID);
-  
+  LOGI(LogNode, "ESP32 Greenhouse Node Starting...");
+  LOGI(LogNode, "Node ID: %d", NODE_ID);
+
   // Initialize watchdog timer with new API
   esp_task_wdt_config_t wdt_config = {
     .timeout_ms = WDT_TIMEOUT * 1000,
@@ -127,328 +152,122 @@ void setup() {
   };
   esp_task_wdt_init(&wdt_config);
   esp_task_wdt_add(NULL);
-  
-  // Initialize GPIO pins
-  pinMode(RELAY_OPEN_PIN, OUTPUT);
-  pinMode(RELAY_CLOSE_PIN, OUTPUT);
+
+  // Relays were held low through deep sleep; take the pins back
+  gpio_hold_dis((gpio_num_t)RELAY_OPEN_PIN);
+  gpio_hold_dis((gpio_num_t)RELAY_CLOSE_PIN);
+
   pinMode(STATUS_LED_PIN, OUTPUT);
-  
-  // Ensure relays are off
-  digitalWrite(RELAY_OPEN_PIN, LOW);
-  digitalWrite(RELAY_CLOSE_PIN, LOW);
   digitalWrite(STATUS_LED_PIN, LOW);
-  
-  // Initialize EEPROM
-  EEPROM.begin(512);
-  loadSettingsFromEEPROM();
-  
-  // Initialize I2C and sensor
-  Wire.begin(BME_SDA_PIN, BME_SCL_PIN);
-  initSensor();
-  
+
   // Initialize ESP-NOW
   initESPNow();
-  
-  // Initialize sensor data structure
-  currentSensorData.nodeId = NODE_ID;
-  currentSensorData.ventStatus = currentVentStatus;
-  currentSensorData.timestamp = millis();
-  
+
+  // Settings, relays, sensor and the first reading; a wake from deep
+  // sleep restores the node state from RTC memory instead of EEPROM
+  node.begin(restoreRtcState());
+
   // Blink LED to indicate successful initialization
-  blinkStatusLED(3);
-  
-  Serial.println("Node initialization complete");
+  if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER) {
+    blinkStatusLED(3);
+  }
+
+  LOGI(LogNode, "Node initialization complete");
+
+#if LOW_POWER_MODE
+  // One duty cycle on top of the reading above: report and listen for the
+  // hub's reply only if the reading is worth reporting
+  node.runControl();
+
+  if (node.linkReady() && node.reportDue(nodeMillis())) {
+    node.sendReport();
+
+    unsigned long listenStart = millis();
+    while (millis() - listenStart < LOW_POWER_LISTEN_TIME) {
+      node.pollRadio();
+      node.serviceAck();
+      logService();
+      delay(5);
+    }
+  }
+#endif
 }
 
 // ----- MAIN LOOP -----
 void loop() {
-  unsigned long currentMillis = millis();
-  
   // Feed watchdog
   feedWatchdog();
-  
-  // Read sensor data periodically
-  if (currentMillis - lastSensorRead >= SENSOR_READ_INTERVAL) {
-    readSensorData();
-    lastSensorRead = currentMillis;
-  }
-  
-  // Send data to hub periodically
-  if (currentMillis - lastESPNowSend >= ESP_NOW_SEND_INTERVAL) {
-    sendDataToHub();
-    lastESPNowSend = currentMillis;
-  }
-  
-  // Process control logic
-  if (currentMillis - lastControlCheck >= CONTROL_CHECK_INTERVAL) {
-    processControlLogic();
-    lastControlCheck = currentMillis;
-  }
-  
-  // Handle motor timeout
-  if (motorRunning && (currentMillis - motorStartTime >= MOTOR_OPERATION_TIME)) {
-    stopMotor();
-  }
-  
-  // Process pending manual commands
-  if (pendingCommand != 0 && !motorRunning && 
-      (currentMillis - lastMotorOperation >= MOTOR_COOLDOWN_TIME)) {
-    executeMotorControl(pendingCommand);
-    pendingCommand = 0;
-  }
-  
-  delay(100); // Small delay to prevent excessive CPU usage
-}
 
-// ----- SENSOR FUNCTIONS -----
-void initSensor() {
-  if (bme.begin(0x76)) {
-    sensorInitialized = true;
-    Serial.println("BME280 sensor initialized successfully");
-    
-    // Configure sensor settings for optimal greenhouse monitoring
-    bme.setSampling(Adafruit_BME280::MODE_FORCED,
-                    Adafruit_BME280::SAMPLING_X1, // temperature
-                    Adafruit_BME280::SAMPLING_X1, // pressure
-                    Adafruit_BME280::SAMPLING_X1, // humidity
-                    Adafruit_BME280::FILTER_OFF);
-  } else {
-    sensorInitialized = false;
-    logError("BME280 sensor initialization failed");
-    Serial.println("BME280 sensor not found!");
-  }
-}
+  node.loop();
 
-void readSensorData() {
-  if (!sensorInitialized) {
-    initSensor(); // Try to reinitialize
-    return;
-  }
-  
-  // Force a reading
-  bme.takeForcedMeasurement();
-  
-  // Read sensor values
-  float temp = bme.readTemperature();
-  float humidity = bme.readHumidity();
-  float pressure = bme.readPressure() / 100.0F; // Convert to hPa
-  
-  // Validate readings
-  if (!isnan(temp) && !isnan(humidity) && !isnan(pressure)) {
-    currentSensorData.temperature = temp;
-    currentSensorData.humidity = humidity;
-    currentSensorData.pressure = pressure;
-    currentSensorData.ventStatus = currentVentStatus;
-    currentSensorData.timestamp = millis();
-    
-    Serial.print("Sensor readings - Temp: ");
-    Serial.print(temp);
-    Serial.print("°C, Humidity: ");
-    Serial.print(humidity);
-    Serial.print("%, Pressure: ");
-    Serial.print(pressure);
-    Serial.println(" hPa");
-  } else {
-    logError("Invalid sensor readings");
+  // Queued log lines go out here, never from the ESP-NOW callbacks
+  logService();
+
+#if LOW_POWER_MODE
+  // Sleep once the motor has stopped; a deferred command is kept for the next wake
+  if (!node.isMotorRunning() && !node.hasPendingAcks() && !node.isSearching()) {
+    enterDeepSleep();
   }
+#endif
+
+  delay(100); // Small delay to prevent excessive CPU usage
 }
 
 // ----- ESP-NOW COMMUNICATION -----
 void initESPNow() {
   WiFi.mode(WIFI_STA);
-  
+
   if (esp_now_init() != ESP_OK) {
-    logError("ESP-NOW init failed");
+    LOGE(LogLink, "ESP-NOW init failed");
     return;
   }
-  
+
   // Register callbacks
   esp_now_register_recv_cb(onDataReceived);
   esp_now_register_send_cb(onDataSent);
-  
-  // Add hub as peer
-  esp_now_peer_info_t peerInfo = {};
-  memcpy(peerInfo.peer_addr, hubMacAddress, 6);
-  peerInfo.channel = 0;
-  peerInfo.encrypt = false;
-  
-  if (esp_now_add_peer(&peerInfo) != ESP_OK) {
-    logError("Failed to add hub peer");
-    return;
-  }
-  
-  espNowInitialized = true;
-  Serial.println("ESP-NOW initialized successfully");
-}
 
-void sendDataToHub() {
-  if (!espNowInitialized) {
+  // Hub discovery; the hub itself is added once a beacon names it
+  if (!addPeer(broadcastMac)) {
+    LOGE(LogLink, "Failed to add broadcast peer");
     return;
   }
-  
-  esp_err_t result = esp_now_send(hubMacAddress, (uint8_t *)&currentSensorData, sizeof(currentSensorData));
-  
-  if (result == ESP_OK) {
-    Serial.println("Data sent to hub successfully");
-    blinkStatusLED(1);
-  } else {
-    logError("Failed to send data to hub");
-  }
-}
 
-void onDataReceived(const esp_now_recv_info *recv_info, const uint8_t *data, int len) {
-  if (len == sizeof(ControlMessage)) {
-    ControlMessage* msg = (ControlMessage*)data;
-    
-    // Check if message is for this node
-    if (msg->targetNodeId == NODE_ID) {
-      Serial.println("Control message received from hub");
-      
-      // Update settings
-      settings.temperatureThreshold = msg->tempThreshold;
-      settings.hysteresis = msg->hysteresis;
-      settings.autoMode = msg->autoMode;
-      
-      // Handle manual command
-      if (msg->manualCommand != 0) {
-        pendingCommand = msg->manualCommand;
-        Serial.print("Manual command received: ");
-        Serial.println(msg->manualCommand);
-      }
-      
-      // Save settings to EEPROM
-      saveSettingsToEEPROM();
-      
-      blinkStatusLED(2);
-    }
-  }
+  espNowInitialized = true;
+  LOGI(LogLink, "ESP-NOW initialized");
 }
 
-void onDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
-  if (status != ESP_NOW_SEND_SUCCESS) {
-    logError("ESP-NOW send failed");
-  }
+// Channel 0: the peer follows the radio's current channel
+bool addPeer(const uint8_t *mac) {
+  esp_now_peer_info_t peerInfo = {};
+  memcpy(peerInfo.peer_addr, mac, 6);
+  peerInfo.channel = 0;
+  peerInfo.encrypt = false;
+  return esp_now_add_peer(&peerInfo) == ESP_OK;
 }
 
-// ----- CONTROL LOGIC -----
-void processControlLogic() {
-  if (!sensorInitialized || motorRunning) {
-    return;
-  }
-  
-  if (settings.autoMode) {
-    float currentTemp = currentSensorData.temperature;
-    float threshold = settings.temperatureThreshold;
-    float hysteresis = settings.hysteresis;
-    
-    // Temperature-based control with hysteresis
-    if (currentVentStatus == 0 || currentVentStatus == 3) { // Closed or closing
-      if (currentTemp > threshold + hysteresis) {
-        executeMotorControl('O'); // Open vent
-      }
-    } else if (currentVentStatus == 1 || currentVentStatus == 2) { // Opening or open
-      if (currentTemp < threshold - hysteresis) {
-        executeMotorControl('C'); // Close vent
-      }
-    }
+bool setHubPeer(const uint8_t *mac, uint8_t channel) {
+  if (!espNowInitialized) {
+    return false;
   }
-}
+  setRadioChannel(channel);
 
-void executeMotorControl(char command) {
-  unsigned long currentMillis = millis();
-  
-  // Check cooldown period
-  if (currentMillis - lastMotorOperation < MOTOR_COOLDOWN_TIME) {
-    Serial.println("Motor cooldown active, command deferred");
-    pendingCommand = command;
-    return;
-  }
-  
-  Serial.print("Executing motor command: ");
-  Serial.println(command);
-  
-  // Stop any current motor operation
-  stopMotor();
-  
-  switch (command) {
-    case 'O': // Open
-      if (currentVentStatus != 2) { // Not already open
-        digitalWrite(RELAY_OPEN_PIN, HIGH);
-        digitalWrite(RELAY_CLOSE_PIN, LOW);
-        currentVentStatus = 1; // Opening
-        motorRunning = true;
-        motorStartTime = currentMillis;
-        Serial.println("Opening vent");
-      }
-      break;
-      
-    case 'C': // Close
-      if (currentVentStatus != 0) { // Not already closed
-        digitalWrite(RELAY_OPEN_PIN, LOW);
-        digitalWrite(RELAY_CLOSE_PIN, HIGH);
-        currentVentStatus = 3; // Closing
-        motorRunning = true;
-        motorStartTime = currentMillis;
-        Serial.println("Closing vent");
-      }
-      break;
-      
-    case 'S': // Stop
-      stopMotor();
-      break;
+  if (memcmp(hubMacAddress, mac, 6) != 0 && esp_now_is_peer_exist(hubMacAddress)) {
+    esp_now_del_peer(hubMacAddress);
   }
-  
-  lastMotorOperation = currentMillis;
+  memcpy(hubMacAddress, mac, 6);
+  return esp_now_is_peer_exist(mac) || addPeer(mac);
 }
 
-void stopMotor() {
-  digitalWrite(RELAY_OPEN_PIN, LOW);
-  digitalWrite(RELAY_CLOSE_PIN, LOW);
-  
-  if (motorRunning) {
-    motorRunning = false;
-    
-    // Update status based on last operation
-    if (currentVentStatus == 1) { // Was opening
-      currentVentStatus = 2; // Now open
-      Serial.println("Vent opened");
-    } else if (currentVentStatus == 3) { // Was closing
-      currentVentStatus = 0; // Now closed
-      Serial.println("Vent closed");
-    }
-  }
+void setRadioChannel(uint8_t channel) {
+  esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
 }
 
-// ----- EEPROM FUNCTIONS -----
-void saveSettingsToEEPROM() {
-  EEPROM.put(0, settings);
-  EEPROM.commit();
-  Serial.println("Settings saved to EEPROM");
+void onDataReceived(const esp_now_recv_info *recv_info, const uint8_t *data, int len) {
+  node.onFrame(recv_info->src_addr, data, len);
 }
 
-void loadSettingsFromEEPROM() {
-  EEPROM.get(0, settings);
-  
-  // Validate loaded settings and apply defaults if invalid
-  if (isnan(settings.temperatureThreshold) || 
-      settings.temperatureThreshold < 0 || 
-      settings.temperatureThreshold > 50) {
-    settings.temperatureThreshold = 25.0;
-  }
-  
-  if (isnan(settings.hysteresis) || 
-      settings.hysteresis < 0 || 
-      settings.hysteresis > 5) {
-    settings.hysteresis = 0.5;
-  }
-  
-  Serial.println("Settings loaded from EEPROM");
-  Serial.print("Temperature threshold: ");
-  Serial.println(settings.temperatureThreshold);
-  Serial.print("Hysteresis: ");
-  Serial.println(settings.hysteresis);
-  Serial.print("Auto mode: ");
-  Serial.println(settings.autoMode ? "ON" : "OFF");
+void onDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
+  node.onSendResult(mac_addr, status == ESP_NOW_SEND_SUCCESS);
 }
 
 // ----- UTILITY FUNCTIONS -----
@@ -469,9 +288,42 @@ void blinkStatusLED(int count) {
   }
 }
 
-void logError(const char* message) {
-  strncpy(lastError, message, sizeof(lastError) - 1);
-  lastErrorTime = millis();
-  Serial.print("ERROR: ");
-  Serial.println(message);
+// Milliseconds since power-on, including time spent in deep sleep
+unsigned long nodeMillis() {
+  return clockBase + millis();
+}
+
+// ----- LOW-POWER FUNCTIONS -----
+bool restoreRtcState() {
+  if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER || rtcState.magic != RTC_STATE_MAGIC) {
+    return false;  // Cold boot or reset, RTC memory holds nothing valid
+  }
+
+  clockBase = rtcState.clockBase;
+  node.state = rtcState.node;
+  return true;
+}
+
+void enterDeepSleep() {
+  unsigned long awakeTime = millis();
+  unsigned long sleepTime = awakeTime < LOW_POWER_SLEEP_TIME ? LOW_POWER_SLEEP_TIME - awakeTime : LOW_POWER_LISTEN_TIME;
+
+  rtcState.magic = RTC_STATE_MAGIC;
+  rtcState.clockBase = clockBase + awakeTime + sleepTime;
+  rtcState.node = node.state;
+
+  // Keep the relays off while the pins are unpowered
+  digitalWrite(RELAY_OPEN_PIN, LOW);
+  digitalWrite(RELAY_CLOSE_PIN, LOW);
+  gpio_hold_en((gpio_num_t)RELAY_OPEN_PIN);
+  gpio_hold_en((gpio_num_t)RELAY_CLOSE_PIN);
+  gpio_deep_sleep_hold_en();
+
+  LOGI(LogNode, "Sleeping for %lu ms", sleepTime);
+  logFlush();
+
+  esp_now_deinit();
+  WiFi.mode(WIFI_OFF);
+  esp_sleep_enable_timer_wakeup((uint64_t)sleepTime * 1000);
+  esp_deep_sleep_start();
 }
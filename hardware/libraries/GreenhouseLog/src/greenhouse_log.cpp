@@ -0,0 +1,141 @@
+#include "greenhouse_log.h"
+#include <Arduino.h>
+#include <stdarg.h>
+
+#define LOG_LINE_MAX 96        // Longer messages are truncated
+#define LOG_PREFIX_MAX 24      // "[1234567.890] W espnow: "
+#if defined(ESP32)
+#define LOG_QUEUE_SIZE 32
+#define LOG_TASK_PERIOD 20
+#define LOG_TASK_STACK_SIZE 3072
+#else
+#define LOG_QUEUE_SIZE 16      // Keep RAM use small on the ESP8266
+#endif
+
+struct LogEntry {
+  uint32_t time;    // millis()
+  uint8_t level;
+  uint8_t length;
+  const char *tag;  // Points to a string literal
+  char text[LOG_LINE_MAX];
+};
+
+// Any task may write, one drains; a short critical section guards the
+// indexes and copies a preformatted entry in or out
+static LogEntry ring[LOG_QUEUE_SIZE];
+static uint8_t ringHead = 0;
+static uint8_t ringTail = 0;
+static uint8_t ringCount = 0;
+static uint32_t droppedLines = 0;
+
+#if defined(ESP32)
+static portMUX_TYPE ringLock = portMUX_INITIALIZER_UNLOCKED;
+#define RING_LOCK() portENTER_CRITICAL(&ringLock)
+#define RING_UNLOCK() portEXIT_CRITICAL(&ringLock)
+#else
+#define RING_LOCK() noInterrupts()
+#define RING_UNLOCK() interrupts()
+#endif
+
+static const char levelLetters[] = "-EWID";
+
+void logWrite(uint8_t level, const char *tag, const char *format, ...) {
+  LogEntry entry;
+  entry.time = millis();
+  entry.level = level;
+  entry.tag = tag;
+
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(entry.text, sizeof(entry.text), format, args);
+  va_end(args);
+  if (length < 0) {
+    return;
+  }
+  entry.length = length < (int)sizeof(entry.text) ? length : sizeof(entry.text) - 1;
+
+  RING_LOCK();
+  if (ringCount == LOG_QUEUE_SIZE) {
+    droppedLines++;
+  } else {
+    ring[ringHead] = entry;
+    ringHead = (ringHead + 1) % LOG_QUEUE_SIZE;
+    ringCount++;
+  }
+  RING_UNLOCK();
+}
+
+// Writes the oldest line. Without wait it only does so if the whole line
+// fits in the UART transmit buffer; returns false if nothing was written.
+static bool writeNext(bool wait) {
+  static LogEntry entry;  // Only the draining task uses it
+  uint32_t dropped;
+
+  RING_LOCK();
+  bool available = ringCount > 0;
+  if (available) {
+    entry = ring[ringTail];
+  }
+  dropped = droppedLines;
+  RING_UNLOCK();
+
+  if (!available) {
+    return false;
+  }
+
+  char prefix[LOG_PREFIX_MAX];
+  int prefixLength = snprintf(prefix, sizeof(prefix), "[%lu.%03lu] %c %s: ",
+                              (unsigned long)(entry.time / 1000), (unsigned long)(entry.time % 1000),
+                              levelLetters[entry.level <= LOG_LEVEL_DEBUG ? entry.level : 0], entry.tag);
+  if (prefixLength < 0 || prefixLength >= (int)sizeof(prefix)) {
+    prefixLength = sizeof(prefix) - 1;
+  }
+
+  if (!wait && Serial.availableForWrite() < prefixLength + entry.length + 2) {
+    return false;
+  }
+
+  RING_LOCK();
+  ringTail = (ringTail + 1) % LOG_QUEUE_SIZE;
+  ringCount--;
+  droppedLines -= dropped;
+  RING_UNLOCK();
+
+  Serial.write((const uint8_t *)prefix, prefixLength);
+  Serial.write((const uint8_t *)entry.text, entry.length);
+  Serial.write("\r\n", 2);
+
+  // Reported after the line that was queued before the ring overflowed
+  if (dropped > 0) {
+    Serial.print("[log] ");
+    Serial.print(dropped);
+    Serial.println(" lines dropped");
+  }
+  return true;
+}
+
+void logService() {
+  while (writeNext(false)) {
+  }
+}
+
+void logFlush() {
+  while (writeNext(true)) {
+  }
+  Serial.flush();
+}
+
+#if defined(ESP32)
+static void logTask(void *parameter) {
+  for (;;) {
+    while (writeNext(true)) {
+    }
+    vTaskDelay(pdMS_TO_TICKS(LOG_TASK_PERIOD));
+  }
+}
+
+void logStartTask(uint8_t core) {
+  xTaskCreatePinnedToCore(logTask, "log", LOG_TASK_STACK_SIZE, NULL,
+                          tskIDLE_PRIORITY, NULL, core);
+}
+#endif
@@ -0,0 +1,73 @@
+#ifndef GREENHOUSE_LOG_H
+#define GREENHOUSE_LOG_H
+
+#include <stdint.h>
+
+// Leveled logging shared by the hub and node firmwares.
+//
+// Each firmware declares its modules with LOG_MODULE(), giving every module
+// its own level. A call above the module's level or above LOG_MAX_LEVEL is
+// decided at compile time and disappears together with its arguments, so a
+// disabled line costs neither code nor a String temporary.
+//
+// Enabled lines are formatted into a fixed-size ring (no heap, safe from
+// any task) and written to Serial later by logService(), logFlush() or the
+// drain task from logStartTask(). Callers, ESP-NOW callbacks included, never
+// wait for the UART. When the ring is full new lines are dropped and counted.
+//
+// LOG_MAX_LEVEL must be defined before the first include of this header;
+// production builds set it to LOG_LEVEL_WARN or LOG_LEVEL_NONE.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Declares a module: LOG_MODULE(LogEspNow, "espnow", LOG_LEVEL_INFO);
+#define LOG_MODULE(name, moduleTag, moduleLevel)  \
+  struct name {                                   \
+    static constexpr uint8_t level = moduleLevel; \
+    static const char *tag() { return moduleTag; } \
+  }
+
+template <typename Module>
+constexpr bool logEnabled(uint8_t level) {
+  return level <= LOG_MAX_LEVEL && level <= Module::level;
+}
+
+#define LOG_AT(Module, level, ...)                   \
+  do {                                               \
+    if (logEnabled<Module>(level)) {                 \
+      logWrite(level, Module::tag(), __VA_ARGS__);   \
+    }                                                \
+  } while (0)
+
+// printf-style: LOGI(LogEspNow, "Registered node %d", nodeId);
+#define LOGE(Module, ...) LOG_AT(Module, LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOGW(Module, ...) LOG_AT(Module, LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOGI(Module, ...) LOG_AT(Module, LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOGD(Module, ...) LOG_AT(Module, LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+// Formats one line into the ring; use the macros above instead
+void logWrite(uint8_t level, const char *tag, const char *format, ...)
+  __attribute__((format(printf, 3, 4)));
+
+// Writes the queued lines that fit in the UART transmit buffer, without
+// blocking. For firmwares that drain from their main loop.
+void logService();
+
+// Writes all queued lines and waits until they are sent, e.g. before a
+// restart or deep sleep
+void logFlush();
+
+#if defined(ESP32)
+// Drains the ring from a task at idle priority on the given core
+void logStartTask(uint8_t core);
+#endif
+
+#endif
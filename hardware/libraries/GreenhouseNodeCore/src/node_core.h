@@ -0,0 +1,923 @@
+#ifndef NODE_CORE_H
+#define NODE_CORE_H
+
+#include <Arduino.h>
+#include <greenhouse_protocol.h>
+#include <greenhouse_log.h>
+#include <ring_buffer.h>
+#include "node_hardware.h"
+#include "sensor_filter.h"
+#include "vent_controller.h"
+
+// Node logic shared by the ESP32 and ESP-01 firmwares: sensor acquisition,
+// vent control, manual commands, settings storage and the hub protocol.
+//
+// Each sketch defines a board traits struct and instantiates NodeCore<Board>.
+// Per-board differences are static members of the traits, so they are
+// resolved at compile time. Sensor, relay and EEPROM access go through the
+// Hardware parameter (see node_hardware.h), which a simulation can replace.
+// The sketch keeps what is truly board specific: ESP-NOW setup and callbacks
+// (the API differs between ESP32 and ESP8266), the watchdog and deep sleep.
+// The callbacks pass frames and send results to onFrame() and onSendResult(),
+// which only queue them; loop() processes them in pollRadio().
+//
+// A board traits struct provides:
+//   static constexpr uint8_t nodeId, relayOpenPin, relayClosePin, sdaPin, sclPin;
+//   static constexpr int8_t limitOpenPin, limitClosedPin;  // Vent limit switches, -1 if not fitted
+//   static constexpr uint32_t motorTravelTime;       // Full open/close run, ms
+//   static constexpr uint32_t motorCooldownTime;     // Minimum time between motor starts, ms
+//   static constexpr uint32_t sensorReadInterval;    // ms
+//   static constexpr uint32_t controlCheckInterval;  // ms
+//   static constexpr uint32_t hubTimeout;            // Policy lease until the hub sends one, ms
+//   static constexpr bool predictiveControl;         // Trend control, see vent_controller.h
+//   static unsigned long now();                      // ms clock, may include time in deep sleep
+//   static bool send(const uint8_t *data, size_t len);       // ESP-NOW frame to the hub
+//   static bool broadcast(const uint8_t *data, size_t len);  // ESP-NOW frame to all
+//   static void setChannel(uint8_t channel);                 // Wi-Fi channel, 1-13
+//   static bool setHub(const uint8_t *mac, uint8_t channel); // Peer send() goes to, and its channel
+//   static void indicate(uint8_t blinks);            // Status LED, may do nothing
+//
+// Vent control: in threshold mode the vent opens fully above the threshold
+// and closes below threshold - hysteresis.
+//
+// Hub policy: the settings, report policy and schedule events the hub last
+// sent stay in NodeState and are followed for the policy lease after the
+// last hub contact. Once it lapses the node is autonomous: it runs the
+// cached schedule events and, if the hub allowed it, threshold control even
+// in manual mode. When the hub is heard again the node reports at once with
+// SENSOR_FLAG_RECONCILE and the hub answers with its full policy.
+//
+// Actuator: the vent position is estimated from motor run times (see
+// vent_controller.h) and made exact at the limit switches when fitted; the
+// motor stops as soon as the switch it runs toward closes. 'P' moves the
+// vent to the position the hub sent in ControlFrame.ventTarget. Total motor
+// run time and starts go out with every report; they are kept in NodeState
+// and written to EEPROM at most every NODE_STATS_SAVE_INTERVAL, so a power
+// cut loses at most that much of the count.
+//
+// Hub discovery: nodes are not configured with the hub's MAC address or
+// channel. An unpaired node, or one whose frames stop reaching the hub,
+// broadcasts a DiscoverFrame on each channel in turn, last known channel
+// first, and pairs with the hub whose BeaconFrame answers. Beacons from the
+// paired hub also move the node when the hub's channel changes. A different
+// hub is only accepted once the policy lease has lapsed.
+//
+// Logging goes through greenhouse_log.h; a sketch may define LOG_MAX_LEVEL
+// and the LOG_*_LEVEL values below before including this header, and calls
+// logService() from its loop to write the queued lines.
+
+#define DEFAULT_TEMP_THRESHOLD 25.0
+#define DEFAULT_HYSTERESIS 0.5
+
+// Report-by-exception defaults, replaced by the policy the hub sends
+#define DEFAULT_TEMPERATURE_DEADBAND 0.2   // °C
+#define DEFAULT_HUMIDITY_DEADBAND 1.0      // %RH
+#define DEFAULT_PRESSURE_DEADBAND 0.5      // hPa
+#define DEFAULT_HEARTBEAT_INTERVAL 120000  // Report at least this often
+
+// Hub discovery
+#define LINK_CHANNELS 13            // Wi-Fi channels searched, 1-13
+#define LINK_SCAN_DWELL 100         // ms waiting for a beacon on each channel
+#define LINK_LOST_FAILURES 3        // Undelivered frames in a row before searching
+#define LINK_RESCAN_INTERVAL 60000  // ms between searches while no hub answers
+
+// Queues between the ESP-NOW callbacks and loop(), sizes are powers of two
+#define NODE_RX_QUEUE_SIZE 8        // Frames; the hub sends at most a few per loop pass
+#define NODE_RX_FRAME_MAX 32        // Longest frame prefix kept per received frame
+#define NODE_SEND_RESULT_QUEUE_SIZE 8
+
+#define NODE_SETTINGS_MAGIC 0x4E53  // "NS"
+#define NODE_STATS_MAGIC 0x4D53     // "MS"
+#define NODE_STATS_SAVE_INTERVAL 21600000UL  // 6 hours between counter writes
+
+#ifndef LOG_NODE_LEVEL
+#define LOG_NODE_LEVEL LOG_LEVEL_INFO
+#endif
+#ifndef LOG_SENSOR_LEVEL
+#define LOG_SENSOR_LEVEL LOG_LEVEL_INFO
+#endif
+#ifndef LOG_VENT_LEVEL
+#define LOG_VENT_LEVEL LOG_LEVEL_INFO
+#endif
+#ifndef LOG_LINK_LEVEL
+#define LOG_LINK_LEVEL LOG_LEVEL_INFO
+#endif
+
+LOG_MODULE(LogNode, "node", LOG_NODE_LEVEL);        // Startup, settings, status, errors
+LOG_MODULE(LogSensor, "sensor", LOG_SENSOR_LEVEL);  // BME280 readings
+LOG_MODULE(LogVent, "vent", LOG_VENT_LEVEL);        // Control decisions and motor runs
+LOG_MODULE(LogLink, "link", LOG_LINK_LEVEL);        // Hub reports and connectivity
+
+// SensorFrame.ventStatus
+enum VentStatus : uint8_t {
+  VENT_CLOSED = 0,
+  VENT_OPENING = 1,
+  VENT_OPEN = 2,    // Fully or partially open
+  VENT_CLOSING = 3
+};
+
+// Stored in EEPROM at address 0
+struct NodeSettings {
+  uint16_t magic;
+  float temperatureThreshold;
+  float hysteresis;
+  bool autoMode;
+};
+
+// Stored in EEPROM at NODE_STATS_ADDRESS
+struct NodeActuatorStats {
+  uint16_t magic;
+  uint16_t motorMillis;   // Run time short of a full second
+  uint32_t motorSeconds;
+  uint32_t motorCycles;   // Motor starts
+};
+
+// Scheduled vent command pushed by the hub
+struct NodeScheduleEvent {
+  unsigned long at;  // Board::now() when due
+  char command;
+};
+
+struct NodeReading {
+  float temperature;
+  float humidity;
+  float pressure;
+  uint32_t timestamp;  // Board::now() when taken
+};
+
+// Everything a node needs to carry on where it left off. Trivially
+// constructible, so the ESP32 node can keep it in RTC memory across deep sleep.
+struct NodeState {
+  NodeSettings settings;
+  uint8_t ventStatus;
+  char pendingCommand;           // Manual command waiting for the motor cooldown
+  uint8_t pendingTarget;         // Position for a pending 'P', percent
+  uint16_t lastControlSequence;  // Last ControlFrame applied, for dedup
+  uint16_t lastGroupSequence;    // Last GroupFrame applied, for dedup
+  uint16_t lastScheduleSequence; // Last ScheduleFrame received, echoed in its ACK
+  unsigned long lastMotorOperation;
+  NodeActuatorStats actuator;
+  bool statsDirty;               // Counters changed since the last EEPROM write
+  unsigned long lastStatsSave;
+  unsigned long lastHubContact;  // Last frame from or delivered to the hub
+  unsigned long policyLease;     // ms the policy holds after lastHubContact
+  bool fallbackAuto;             // Threshold control while autonomous, in manual mode too
+  bool autonomous;               // Lease lapsed
+  bool reconcilePending;         // Next report asks the hub for its full policy
+
+  // Hub pairing, learned from its beacons
+  uint8_t hubMac[6];
+  uint8_t channel;
+  bool paired;
+  uint8_t sendFailures;          // Frames to the hub undelivered in a row
+  bool searchFailed;             // Last search found no hub
+  unsigned long lastSearch;      // Board::now() when it ended
+
+  // Report-by-exception policy and the values last reported
+  float temperatureDeadband;
+  float humidityDeadband;
+  float pressureDeadband;
+  unsigned long heartbeatInterval;
+  bool hasReported;
+  NodeReading reported;
+  uint8_t reportedVentStatus;
+  uint8_t reportedVentPosition;
+  unsigned long lastReport;
+
+  // Upcoming scheduled commands, soonest first. The hub sends them itself
+  // while it is reachable, so the node only runs them when autonomous.
+  NodeScheduleEvent schedule[SCHEDULE_FRAME_EVENTS];
+  uint8_t scheduleCount;
+
+  TemperatureFilter filter;
+  VentController vent;
+};
+
+// Raw frame copied out of the receive callback
+struct NodeRxFrame {
+  uint8_t mac[6];
+  uint8_t len;
+  uint8_t data[NODE_RX_FRAME_MAX];
+};
+
+struct NodeSendResult {
+  uint8_t mac[6];
+  bool delivered;
+};
+
+template <typename Board, typename Hardware = ArduinoNodeHardware<Board> >
+class NodeCore {
+public:
+  Hardware hardware;
+  NodeState state;
+  NodeReading reading;        // Latest raw reading
+  float filteredTemperature;  // Control input
+  bool sensorReady;
+  bool ackPending;            // Set when a frame is processed, sent from serviceAck()
+  bool groupAckPending;
+  bool scheduleAckPending;
+
+  // restored: state was brought back from RTC memory, so EEPROM and the
+  // defaults are skipped
+  void begin(bool restored) {
+    hardware.begin();
+    if (!restored) {
+      state = NodeState();
+      state.temperatureDeadband = DEFAULT_TEMPERATURE_DEADBAND;
+      state.humidityDeadband = DEFAULT_HUMIDITY_DEADBAND;
+      state.pressureDeadband = DEFAULT_PRESSURE_DEADBAND;
+      state.heartbeatInterval = DEFAULT_HEARTBEAT_INTERVAL;
+      state.lastHubContact = Board::now();
+      state.policyLease = Board::hubTimeout;
+      state.fallbackAuto = true;
+      state.reconcilePending = true;  // Only the settings survive a reset
+      state.channel = 1;
+      loadSettings();
+      loadStats();
+    }
+    if (state.paired) {
+      Board::setHub(state.hubMac, state.channel);
+    }
+
+    // First reading right away, so the first report carries real values
+    initSensor();
+    readSensor();
+    lastSensorRead = Board::now();
+    lastControlCheck = lastSensorRead;
+  }
+
+  void loop() {
+    pollRadio();
+    unsigned long now = Board::now();
+
+    if (now - lastSensorRead >= Board::sensorReadInterval) {
+      readSensor();
+      lastSensorRead = now;
+    }
+
+    // Acknowledge control messages right away so the hub stops retransmitting
+    serviceAck();
+
+    // Saved once per pass, however many frames changed the settings
+    if (settingsDirty) {
+      settingsDirty = false;
+      saveSettings();
+    }
+
+    serviceLink(now);
+
+    // Report by exception, with a heartbeat so the hub knows the node is alive
+    if (linkReady() && reportDue(now)) {
+      sendReport();
+    }
+
+    checkHubConnection(now);
+    runSchedule(now);
+
+    if (motorRunning && (now - motorStartTime >= motorRunTime ||
+                         hardware.endStopReached(state.vent.moveDirection))) {
+      stopMotor();
+    }
+
+    if (state.statsDirty && !motorRunning && now - state.lastStatsSave >= NODE_STATS_SAVE_INTERVAL) {
+      saveStats();
+    }
+
+    if (now - lastControlCheck >= Board::controlCheckInterval) {
+      runControl();
+      lastControlCheck = now;
+    }
+
+    // A stop acts at once; open and close wait for the motor cooldown
+    char command = state.pendingCommand;
+    if (command == 'S' ||
+        (command != 0 && !motorRunning && now - state.lastMotorOperation >= Board::motorCooldownTime)) {
+      state.pendingCommand = 0;
+      executeCommand(command);
+    }
+  }
+
+  void runSchedule(unsigned long now) {
+    while (state.scheduleCount > 0 && (long)(now - state.schedule[0].at) >= 0) {
+      char command = state.schedule[0].command;
+      state.scheduleCount--;
+      memmove(state.schedule, state.schedule + 1, state.scheduleCount * sizeof(state.schedule[0]));
+
+      if (state.autonomous) {
+        LOGI(LogVent, "SCHEDULE: Command %c", command);
+        state.pendingCommand = command;
+      }
+    }
+  }
+
+  bool isMotorRunning() const {
+    return motorRunning;
+  }
+
+  // Includes frames still queued, which may need an acknowledgement
+  bool hasPendingAcks() const {
+    return ackPending || groupAckPending || scheduleAckPending || !rxQueue.isEmpty();
+  }
+
+  bool isSearching() const {
+    return searching;
+  }
+
+  // ----- SENSOR -----
+  void initSensor() {
+    sensorReady = hardware.initSensor();
+    if (!sensorReady) {
+      logError("BME280 sensor initialization failed");
+      return;
+    }
+    LOGI(LogSensor, "BME280 sensor initialized");
+  }
+
+  bool readSensor() {
+    if (!sensorReady) {
+      initSensor();  // Try to reinitialize
+      if (!sensorReady) {
+        return false;
+      }
+    }
+
+    float temperature, humidity, pressure;
+    hardware.readSensor(temperature, humidity, pressure);
+
+    if (isnan(temperature) || isnan(humidity) || isnan(pressure)) {
+      logError("Invalid sensor readings");
+      return false;
+    }
+
+    reading.temperature = temperature;
+    reading.humidity = humidity;
+    reading.pressure = pressure;
+    reading.timestamp = Board::now();
+    filteredTemperature = filterTemperature(state.filter, temperature);
+    state.vent.addSample(reading.timestamp, filteredTemperature);
+
+    LOGD(LogSensor, "T: %.1f°C (%.1f filtered), H: %.1f%%, P: %.1f hPa",
+         temperature, filteredTemperature, humidity, pressure);
+    return true;
+  }
+
+  // ----- VENT CONTROL -----
+  // Automatic mode, or the fallback of a manual-mode node without a hub
+  bool thresholdControlActive() const {
+    return state.settings.autoMode || (state.autonomous && state.fallbackAuto);
+  }
+
+  void runControl() {
+    if (!sensorReady || motorRunning || !thresholdControlActive() ||
+        Board::now() - state.lastMotorOperation < Board::motorCooldownTime) {
+      return;
+    }
+
+    float threshold = state.settings.temperatureThreshold;
+    float hysteresis = state.settings.hysteresis;
+
+    if (Board::predictiveControl) {
+      VentMove move = state.vent.plan(threshold, hysteresis, Board::motorTravelTime);
+      if (move.direction != 0) {
+        LOGI(LogVent, "AUTO: Predicted %.1f°C", state.vent.predict());
+        runMotor(move);
+      }
+    } else if (state.ventStatus == VENT_CLOSED && filteredTemperature > threshold) {
+      LOGI(LogVent, "AUTO: Opening vent - temp above threshold");
+      runMotor(VentController::fullMove(1, Board::motorTravelTime));
+    } else if (state.ventStatus == VENT_OPEN && filteredTemperature < threshold - hysteresis) {
+      LOGI(LogVent, "AUTO: Closing vent - temp below threshold");
+      runMotor(VentController::fullMove(-1, Board::motorTravelTime));
+    }
+  }
+
+  // Manual commands run in either mode; automatic control may act again later
+  void executeCommand(char command) {
+    LOGI(LogVent, "MANUAL: Command %c", command);
+
+    switch (command) {
+      case 'O':
+        if (state.vent.position < VENT_FULLY_OPEN) {
+          runMotor(VentController::fullMove(1, Board::motorTravelTime));
+        }
+        break;
+
+      case 'C':
+        if (state.vent.position > 0) {
+          runMotor(VentController::fullMove(-1, Board::motorTravelTime));
+        }
+        break;
+
+      case 'P': {
+        VentMove move = state.vent.moveTo(state.pendingTarget, Board::motorTravelTime);
+        if (move.direction != 0) {
+          runMotor(move);
+        }
+        break;
+      }
+
+      case 'S':
+        stopMotor();
+        break;
+    }
+  }
+
+  // Starts a full or partial move; loop() stops the motor after move.runTime
+  // or at the limit switch
+  void runMotor(const VentMove &move) {
+    stopMotor();
+    if (hardware.endStopReached(move.direction)) {
+      state.vent.reachEndStop(move.direction);
+      state.ventStatus = move.direction > 0 ? VENT_OPEN : VENT_CLOSED;
+      LOGI(LogVent, "Vent already at its limit switch");
+      return;
+    }
+
+    hardware.setRelays(move.direction);
+    state.ventStatus = move.direction > 0 ? VENT_OPENING : VENT_CLOSING;
+    motorRunning = true;
+    motorStartTime = Board::now();
+    motorRunTime = move.runTime;
+    state.lastMotorOperation = motorStartTime;
+    state.vent.startMove(move);
+    state.actuator.motorCycles++;
+    state.statsDirty = true;
+
+    LOGI(LogVent, "%s vent to %u%%", move.direction > 0 ? "Opening" : "Closing", move.target);
+  }
+
+  void stopMotor() {
+    hardware.setRelays(0);
+
+    if (motorRunning) {
+      motorRunning = false;
+      uint32_t runTime = Board::now() - motorStartTime;
+      int8_t direction = state.vent.moveDirection;
+      if (hardware.endStopReached(direction)) {
+        state.vent.reachEndStop(direction);
+      } else {
+        state.vent.finishMove(runTime, Board::motorTravelTime);
+      }
+      addMotorTime(runTime);
+      state.ventStatus = state.vent.position > 0 ? VENT_OPEN : VENT_CLOSED;
+      LOGI(LogVent, "Vent at %u%%", state.vent.position);
+    }
+  }
+
+  void addMotorTime(uint32_t runTime) {
+    NodeActuatorStats &stats = state.actuator;
+    uint32_t total = stats.motorMillis + runTime;
+    stats.motorSeconds += total / 1000;
+    stats.motorMillis = total % 1000;
+    state.statsDirty = true;
+  }
+
+  // ----- HUB PROTOCOL -----
+  // True when a reading moved past its deadband since the last report, the
+  // vent status or position changed, or the heartbeat interval has passed
+  bool reportDue(unsigned long now) const {
+    if (!state.hasReported || reportRequested ||
+        state.ventStatus != state.reportedVentStatus ||
+        state.vent.position != state.reportedVentPosition ||
+        now - state.lastReport >= state.heartbeatInterval) {
+      return true;
+    }
+
+    return fabs(reading.temperature - state.reported.temperature) >= state.temperatureDeadband ||
+           fabs(reading.humidity - state.reported.humidity) >= state.humidityDeadband ||
+           fabs(reading.pressure - state.reported.pressure) >= state.pressureDeadband;
+  }
+
+  void sendReport() {
+    SensorFrame frame;
+    initFrameHeader(frame.header, FRAME_SENSOR, Board::nodeId);
+    frame.temperature = toFixed(reading.temperature, CENTI_SCALE);
+    frame.humidity = toFixed(reading.humidity, CENTI_SCALE);
+    frame.pressure = toFixedUnsigned(reading.pressure, DECI_SCALE);
+    frame.ventStatus = state.ventStatus;
+    // The reconcile flag stays on every report until the hub answers
+    frame.flags = (state.autonomous ? SENSOR_FLAG_AUTONOMOUS : 0) |
+                  (state.reconcilePending ? SENSOR_FLAG_RECONCILE : 0);
+    frame.timestamp = reading.timestamp;
+    frame.ackSequence = state.lastControlSequence;
+    frame.ventPosition = state.vent.position;
+    frame.motorSeconds = state.actuator.motorSeconds;
+    frame.motorCycles = state.actuator.motorCycles;
+
+    reportRequested = false;
+    if (Board::send((const uint8_t *)&frame, sizeof(frame))) {
+      state.reported = reading;
+      state.reportedVentStatus = state.ventStatus;
+      state.reportedVentPosition = state.vent.position;
+      state.hasReported = true;
+      state.lastReport = Board::now();
+      LOGD(LogLink, "Data sent to hub");
+      Board::indicate(1);
+    } else {
+      logError("Failed to send data to hub");
+    }
+  }
+
+  void serviceAck() {
+    if (ackPending) {
+      ackPending = false;
+      sendAck(FRAME_CONTROL, state.lastControlSequence);
+    }
+    if (groupAckPending) {
+      groupAckPending = false;
+      sendAck(FRAME_GROUP, state.lastGroupSequence);
+    }
+    if (scheduleAckPending) {
+      scheduleAckPending = false;
+      sendAck(FRAME_SCHEDULE, state.lastScheduleSequence);
+    }
+  }
+
+  void sendAck(FrameType acked, uint16_t sequence) {
+    AckFrame ack;
+    initFrameHeader(ack.header, FRAME_ACK, Board::nodeId);
+    ack.sequence = sequence;
+    ack.acked = acked;
+    Board::send((const uint8_t *)&ack, sizeof(ack));
+    Board::indicate(2);
+  }
+
+  // Called from the ESP-NOW receive callback with the sender's address. Only
+  // copies the frame out; a frame dropped on a full queue is retransmitted
+  // by the hub.
+  void onFrame(const uint8_t *mac, const uint8_t *data, int len) {
+    if (len <= 0) {
+      return;
+    }
+
+    NodeRxFrame rx;
+    memcpy(rx.mac, mac, 6);
+    rx.len = len < NODE_RX_FRAME_MAX ? len : NODE_RX_FRAME_MAX;  // Newer versions only append fields
+    memcpy(rx.data, data, rx.len);
+    rxQueue.push(rx);
+  }
+
+  // Called from the ESP-NOW send callback
+  void onSendResult(const uint8_t *mac, bool delivered) {
+    NodeSendResult result;
+    memcpy(result.mac, mac, 6);
+    result.delivered = delivered;
+    sendResults.push(result);
+  }
+
+  // Processes what the callbacks queued. Called by loop(); a sketch waiting
+  // for the hub's reply outside loop() calls it before serviceAck().
+  void pollRadio() {
+    NodeRxFrame rx;
+    while (rxQueue.pop(rx)) {
+      processFrame(rx.mac, rx.data, rx.len);
+    }
+
+    NodeSendResult result;
+    while (sendResults.pop(result)) {
+      processSendResult(result.mac, result.delivered);
+    }
+  }
+
+  void processFrame(const uint8_t *mac, const uint8_t *data, int len) {
+    uint8_t type = parseFrameType(data, len);
+    if (type == FRAME_BEACON) {
+      onBeacon(mac, data, len);
+      return;
+    }
+    if (type == FRAME_GROUP) {
+      onGroupFrame(data, len);
+      return;
+    }
+    if (type == FRAME_SCHEDULE) {
+      onScheduleFrame(data, len);
+      return;
+    }
+    if (type != FRAME_CONTROL) {
+      return;
+    }
+
+    ControlFrame msg;
+    readFrame(&msg, sizeof(msg), data, len);
+
+    // Only messages for this node or for all nodes (ID 0)
+    if (msg.header.nodeId != Board::nodeId && msg.header.nodeId != 0) {
+      return;
+    }
+    state.lastHubContact = Board::now();
+
+    // Always acknowledge, but apply a retransmitted message only once
+    ackPending = true;
+    if (msg.sequence != 0 && msg.sequence == state.lastControlSequence) {
+      return;
+    }
+    state.lastControlSequence = msg.sequence;
+
+    NodeSettings &settings = state.settings;
+    float threshold = fromFixed(msg.tempThreshold, CENTI_SCALE);
+    float hysteresis = fromFixed(msg.hysteresis, CENTI_SCALE);
+    bool autoMode = (msg.flags & CONTROL_FLAG_AUTO_MODE) != 0;
+    if (threshold != settings.temperatureThreshold || hysteresis != settings.hysteresis ||
+        autoMode != settings.autoMode) {
+      settings.temperatureThreshold = threshold;
+      settings.hysteresis = hysteresis;
+      settings.autoMode = autoMode;
+      settingsDirty = true;  // Saved from loop(), only when changed to spare the flash
+    }
+
+    // Report policy and lease; 0 means the hub left the value unchanged
+    state.fallbackAuto = (msg.flags & CONTROL_FLAG_FALLBACK_AUTO) != 0;
+    state.reconcilePending = false;
+    if (msg.policyLease != 0) state.policyLease = msg.policyLease * 1000UL;
+    if (msg.temperatureDeadband != 0) state.temperatureDeadband = fromFixed(msg.temperatureDeadband, CENTI_SCALE);
+    if (msg.humidityDeadband != 0) state.humidityDeadband = fromFixed(msg.humidityDeadband, DECI_SCALE);
+    if (msg.pressureDeadband != 0) state.pressureDeadband = fromFixed(msg.pressureDeadband, DECI_SCALE);
+    if (msg.heartbeatInterval != 0) state.heartbeatInterval = msg.heartbeatInterval * 1000UL;
+
+    if (msg.manualCommand != 0) {
+      state.pendingCommand = msg.manualCommand;
+      state.pendingTarget = msg.ventTarget;
+    }
+  }
+
+  // Broadcast command for a set of nodes, e.g. "open all"
+  void onGroupFrame(const uint8_t *data, int len) {
+    GroupFrame msg;
+    readFrame(&msg, sizeof(msg), data, len);
+
+    if (Board::nodeId >= 32 || (msg.targetMask & (1UL << Board::nodeId)) == 0) {
+      return;
+    }
+    state.lastHubContact = Board::now();
+
+    groupAckPending = true;
+    if (msg.sequence != 0 && msg.sequence == state.lastGroupSequence) {
+      return;
+    }
+    state.lastGroupSequence = msg.sequence;
+
+    if ((msg.flags & GROUP_FLAG_SYNC) != 0) {
+      reportRequested = true;
+    }
+    if ((msg.flags & GROUP_FLAG_MANUAL_MODE) != 0 && state.settings.autoMode) {
+      state.settings.autoMode = false;
+      settingsDirty = true;
+    }
+    if ((msg.flags & GROUP_FLAG_AUTO_MODE) != 0 && !state.settings.autoMode) {
+      state.settings.autoMode = true;
+      settingsDirty = true;
+    }
+    if (msg.manualCommand != 0) {
+      state.pendingCommand = msg.manualCommand;
+    }
+  }
+
+  // Replaces the scheduled commands. A retransmission carries the same
+  // events with delays counted from its own transmission, so it is applied
+  // again rather than dropped.
+  void onScheduleFrame(const uint8_t *data, int len) {
+    ScheduleFrame msg;
+    readFrame(&msg, sizeof(msg), data, len);
+
+    if (msg.header.nodeId != Board::nodeId) {
+      return;
+    }
+    unsigned long now = Board::now();
+    state.lastHubContact = now;
+
+    uint8_t count = msg.count < SCHEDULE_FRAME_EVENTS ? msg.count : SCHEDULE_FRAME_EVENTS;
+    for (uint8_t i = 0; i < count; i++) {
+      state.schedule[i].at = now + msg.events[i].delay * 1000UL;
+      state.schedule[i].command = msg.events[i].manualCommand;
+    }
+    state.scheduleCount = count;
+    state.lastScheduleSequence = msg.sequence;
+    scheduleAckPending = true;
+  }
+
+  // A delivered frame means the hub is up. An undelivered one is followed by
+  // a report right away, so a hub that changed channel is noticed within a
+  // few loop passes.
+  void processSendResult(const uint8_t *mac, bool delivered) {
+    if (!state.paired || memcmp(mac, state.hubMac, 6) != 0) {
+      return;  // Broadcast
+    }
+    if (delivered) {
+      state.lastHubContact = Board::now();
+      state.sendFailures = 0;
+    } else {
+      if (state.sendFailures < 255) {
+        state.sendFailures++;
+      }
+      reportRequested = true;
+    }
+  }
+
+  // ----- HUB DISCOVERY -----
+  bool linkReady() const {
+    return state.paired && !searching && state.sendFailures < LINK_LOST_FAILURES;
+  }
+
+  // The hub is paired in serviceLink(), after the sensor and acknowledgements
+  void onBeacon(const uint8_t *mac, const uint8_t *data, int len) {
+    BeaconFrame msg;
+    readFrame(&msg, sizeof(msg), data, len);
+    if (msg.channel < 1 || msg.channel > LINK_CHANNELS) {
+      return;
+    }
+
+    bool pairedHub = state.paired && memcmp(mac, state.hubMac, 6) == 0;
+    if (state.paired && !pairedHub && !state.autonomous) {
+      return;  // Another hub in range; ours still holds the policy lease
+    }
+    if (pairedHub) {
+      state.lastHubContact = Board::now();
+      if (!searching && msg.channel == state.channel && state.sendFailures < LINK_LOST_FAILURES) {
+        return;
+      }
+    }
+
+    memcpy(beaconMac, mac, 6);
+    beaconChannel = msg.channel;
+    beaconPending = true;
+  }
+
+  void serviceLink(unsigned long now) {
+    if (beaconPending) {
+      beaconPending = false;
+      pairWithHub();
+      return;
+    }
+
+    if (!searching) {
+      bool lost = !state.paired || state.sendFailures >= LINK_LOST_FAILURES;
+      if (!lost || (state.searchFailed && now - state.lastSearch < LINK_RESCAN_INTERVAL)) {
+        return;
+      }
+      LOGI(LogLink, "Searching for the hub");
+      searching = true;
+      searchStep = 0;
+      probeChannel(now);
+      return;
+    }
+
+    if (now - probeSentAt < LINK_SCAN_DWELL) {
+      return;
+    }
+    if (++searchStep < LINK_CHANNELS) {
+      probeChannel(now);
+      return;
+    }
+
+    // No answer on any channel; wait on the last known one
+    searching = false;
+    state.searchFailed = true;
+    state.lastSearch = now;
+    Board::setChannel(state.channel);
+    LOGW(LogLink, "Hub not found, searching again in %lu s", LINK_RESCAN_INTERVAL / 1000UL);
+  }
+
+  // Last known channel first, then the others in order
+  uint8_t searchChannel(uint8_t step) const {
+    if (step == 0) {
+      return state.channel;
+    }
+    return step < state.channel ? step : step + 1;
+  }
+
+  void probeChannel(unsigned long now) {
+    Board::setChannel(searchChannel(searchStep));
+    DiscoverFrame msg;
+    initFrameHeader(msg.header, FRAME_DISCOVER, Board::nodeId);
+    Board::broadcast((const uint8_t *)&msg, sizeof(msg));
+    probeSentAt = now;
+  }
+
+  void pairWithHub() {
+    bool newHub = !state.paired || memcmp(beaconMac, state.hubMac, 6) != 0;
+    if (!Board::setHub(beaconMac, beaconChannel)) {
+      logError("Failed to add hub as peer");
+      return;
+    }
+
+    memcpy(state.hubMac, beaconMac, 6);
+    state.channel = beaconChannel;
+    state.paired = true;
+    state.sendFailures = 0;
+    state.searchFailed = false;
+    searching = false;
+    reportRequested = true;  // Let the hub know where the node is right away
+    if (newHub) {
+      state.reconcilePending = true;
+    }
+    LOGI(LogLink, "Hub %02X:%02X:%02X:%02X:%02X:%02X on channel %u",
+         state.hubMac[0], state.hubMac[1], state.hubMac[2],
+         state.hubMac[3], state.hubMac[4], state.hubMac[5], state.channel);
+  }
+
+  void checkHubConnection(unsigned long now) {
+    bool offline = now - state.lastHubContact > state.policyLease;
+    if (offline != state.autonomous) {
+      state.autonomous = offline;
+      if (offline) {
+        LOGW(LogLink, "Policy lease lapsed - switching to autonomous mode");
+      } else {
+        // One report and the hub's answer bring the node up to date
+        state.reconcilePending = true;
+        reportRequested = true;
+        LOGI(LogLink, "Hub back online");
+      }
+    }
+  }
+
+  // ----- SETTINGS -----
+  void loadSettings() {
+    NodeSettings &settings = state.settings;
+    hardware.loadSettings(settings);
+
+    if (settings.magic != NODE_SETTINGS_MAGIC ||
+        isnan(settings.temperatureThreshold) ||
+        settings.temperatureThreshold < 0 || settings.temperatureThreshold > 50 ||
+        isnan(settings.hysteresis) ||
+        settings.hysteresis < 0 || settings.hysteresis > 5) {
+      LOGW(LogNode, "No valid settings in EEPROM, using defaults");
+      settings.magic = NODE_SETTINGS_MAGIC;
+      settings.temperatureThreshold = DEFAULT_TEMP_THRESHOLD;
+      settings.hysteresis = DEFAULT_HYSTERESIS;
+      settings.autoMode = true;
+      saveSettings();
+      return;
+    }
+
+    LOGI(LogNode, "Settings loaded from EEPROM");
+    printSettings();
+  }
+
+  void saveSettings() {
+    hardware.saveSettings(state.settings);
+    LOGI(LogNode, "Settings saved to EEPROM");
+  }
+
+  // Counters start from zero on a node that never stored them
+  void loadStats() {
+    hardware.loadStats(state.actuator);
+    if (state.actuator.magic != NODE_STATS_MAGIC || state.actuator.motorMillis >= 1000) {
+      state.actuator = NodeActuatorStats();
+      state.actuator.magic = NODE_STATS_MAGIC;
+    }
+  }
+
+  void saveStats() {
+    hardware.saveStats(state.actuator);
+    state.statsDirty = false;
+    state.lastStatsSave = Board::now();
+    LOGD(LogNode, "Motor counters saved to EEPROM");
+  }
+
+  // ----- DIAGNOSTICS -----
+  void printSettings() const {
+    LOGI(LogNode, "Temp threshold: %.2f, Hysteresis: %.2f, Control mode: %s",
+         state.settings.temperatureThreshold, state.settings.hysteresis,
+         state.settings.autoMode ? "Automatic" : "Manual");
+  }
+
+  void printStatus() const {
+    static const char *ventNames[] = {"Closed", "Opening", "Open", "Closing"};
+
+    LOGI(LogNode, "Node %u: %s, vent %s (%u%%), motor %lu s in %lu runs", Board::nodeId,
+         state.autonomous ? "Autonomous" : "Connected",
+         ventNames[state.ventStatus & 3], state.vent.position,
+         (unsigned long)state.actuator.motorSeconds, (unsigned long)state.actuator.motorCycles);
+    printSettings();
+  }
+
+  void logError(const char *message) {
+    strncpy(lastError, message, sizeof(lastError) - 1);
+    lastErrorTime = Board::now();
+    LOGE(LogNode, "%s", message);
+  }
+
+  char lastError[64];
+  unsigned long lastErrorTime;
+
+private:
+  unsigned long lastSensorRead;
+  unsigned long lastControlCheck;
+  bool motorRunning;
+  unsigned long motorStartTime;
+  unsigned long motorRunTime;
+  bool settingsDirty;
+  bool reportRequested;  // Report on the next loop: GROUP_FLAG_SYNC, rejoin or lost frame
+
+  bool searching;
+  uint8_t searchStep;
+  unsigned long probeSentAt;
+  bool beaconPending;    // Set by onBeacon(), taken over in serviceLink()
+  uint8_t beaconMac[6];
+  uint8_t beaconChannel;
+
+  SpscRing<NodeRxFrame, NODE_RX_QUEUE_SIZE> rxQueue;
+  SpscRing<NodeSendResult, NODE_SEND_RESULT_QUEUE_SIZE> sendResults;
+};
+
+#endif
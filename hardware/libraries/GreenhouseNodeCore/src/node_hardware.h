@@ -0,0 +1,110 @@
+#ifndef NODE_HARDWARE_H
+#define NODE_HARDWARE_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <EEPROM.h>
+#include <Adafruit_BME280.h>
+
+// Hardware access for NodeCore: the BME280, the vent relays, the optional
+// limit switches and the settings EEPROM. NodeCore takes the hardware as its second template parameter, so
+// a host-side simulation can substitute a class with the same members
+// (scripted temperatures, recorded relay switching, settings in RAM) and
+// run the unchanged node logic off the device.
+
+// Hardware stage of the acquisition pipeline, see sensor_filter.h for the rest
+#ifndef BME_TEMPERATURE_OVERSAMPLING
+#define BME_TEMPERATURE_OVERSAMPLING Adafruit_BME280::SAMPLING_X4
+#endif
+#ifndef BME_PRESSURE_OVERSAMPLING
+#define BME_PRESSURE_OVERSAMPLING Adafruit_BME280::SAMPLING_X4
+#endif
+#ifndef BME_HUMIDITY_OVERSAMPLING
+#define BME_HUMIDITY_OVERSAMPLING Adafruit_BME280::SAMPLING_X2
+#endif
+#ifndef BME_IIR_FILTER
+#define BME_IIR_FILTER Adafruit_BME280::FILTER_X2
+#endif
+
+#define NODE_EEPROM_SIZE 512
+#define NODE_STATS_ADDRESS 64  // Actuator counters, after the settings
+
+template <typename Board>
+class ArduinoNodeHardware {
+public:
+  void begin() {
+    EEPROM.begin(NODE_EEPROM_SIZE);
+
+    pinMode(Board::relayOpenPin, OUTPUT);
+    pinMode(Board::relayClosePin, OUTPUT);
+    setRelays(0);
+
+    // Limit switches close to ground
+    if (Board::limitOpenPin >= 0) pinMode(Board::limitOpenPin, INPUT_PULLUP);
+    if (Board::limitClosedPin >= 0) pinMode(Board::limitClosedPin, INPUT_PULLUP);
+
+    Wire.begin(Board::sdaPin, Board::sclPin);
+  }
+
+  bool initSensor() {
+    if (!bme.begin(0x76) && !bme.begin(0x77)) {
+      return false;
+    }
+
+    // Oversampling and the IIR filter average out noise inside the sensor
+    bme.setSampling(Adafruit_BME280::MODE_FORCED,
+                    BME_TEMPERATURE_OVERSAMPLING,
+                    BME_PRESSURE_OVERSAMPLING,
+                    BME_HUMIDITY_OVERSAMPLING,
+                    BME_IIR_FILTER);
+    return true;
+  }
+
+  // Takes one forced measurement; pressure in hPa
+  void readSensor(float &temperature, float &humidity, float &pressure) {
+    bme.takeForcedMeasurement();
+    temperature = bme.readTemperature();
+    humidity = bme.readHumidity();
+    pressure = bme.readPressure() / 100.0F;
+  }
+
+  // 1 drives the vent open, -1 closed, 0 stops the motor
+  void setRelays(int8_t direction) {
+    digitalWrite(Board::relayOpenPin, direction > 0 ? HIGH : LOW);
+    digitalWrite(Board::relayClosePin, direction < 0 ? HIGH : LOW);
+  }
+
+  // True when the limit switch at the end the vent moves toward is closed;
+  // always false without one
+  bool endStopReached(int8_t direction) {
+    int8_t pin = direction > 0 ? Board::limitOpenPin : (direction < 0 ? Board::limitClosedPin : -1);
+    return pin >= 0 && digitalRead(pin) == LOW;
+  }
+
+  template <typename T>
+  void loadSettings(T &settings) {
+    EEPROM.get(0, settings);
+  }
+
+  template <typename T>
+  void saveSettings(const T &settings) {
+    EEPROM.put(0, settings);
+    EEPROM.commit();
+  }
+
+  template <typename T>
+  void loadStats(T &stats) {
+    EEPROM.get(NODE_STATS_ADDRESS, stats);
+  }
+
+  template <typename T>
+  void saveStats(const T &stats) {
+    EEPROM.put(NODE_STATS_ADDRESS, stats);
+    EEPROM.commit();
+  }
+
+private:
+  Adafruit_BME280 bme;
+};
+
+#endif
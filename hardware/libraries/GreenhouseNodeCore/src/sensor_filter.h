@@ -0,0 +1,56 @@
+#ifndef SENSOR_FILTER_H
+#define SENSOR_FILTER_H
+
+#include <stdint.h>
+#include <greenhouse_protocol.h>
+
+// Software stage of the node acquisition pipeline: a moving median over the
+// last FILTER_WINDOW temperatures (drops single-sample spikes) followed by
+// an EMA, in centi-degree fixed point. Vent control acts on the filtered
+// value; reports to the hub carry the raw readings.
+
+#ifndef FILTER_WINDOW
+#define FILTER_WINDOW 5     // Samples in the moving median, odd
+#endif
+#ifndef FILTER_EMA_SHIFT
+#define FILTER_EMA_SHIFT 1  // EMA weight of each new median is 1/2^shift
+#endif
+
+// All zero means no samples yet, so it can live in RTC memory
+struct TemperatureFilter {
+  int16_t window[FILTER_WINDOW];
+  uint8_t count;
+  uint8_t next;
+  int32_t ema;  // Scaled by 2^FILTER_EMA_SHIFT
+};
+
+// Adds a raw reading and returns the median of the window smoothed by the EMA
+inline float filterTemperature(TemperatureFilter &filter, float raw) {
+  filter.window[filter.next] = toFixed(raw, CENTI_SCALE);
+  filter.next = (filter.next + 1) % FILTER_WINDOW;
+  if (filter.count < FILTER_WINDOW) {
+    filter.count++;
+  }
+
+  // Insertion sort of the few samples the window holds
+  int16_t sorted[FILTER_WINDOW];
+  for (uint8_t i = 0; i < filter.count; i++) {
+    int16_t value = filter.window[i];
+    uint8_t j = i;
+    while (j > 0 && sorted[j - 1] > value) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = value;
+  }
+  int32_t median = sorted[filter.count / 2];
+
+  if (filter.count == 1) {
+    filter.ema = median * (1 << FILTER_EMA_SHIFT);  // median < 0 below 0 °C, no left shift
+  } else {
+    filter.ema += median - (filter.ema >> FILTER_EMA_SHIFT);
+  }
+  return fromFixed(filter.ema >> FILTER_EMA_SHIFT, CENTI_SCALE);
+}
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef VENT_CONTROLLER_H
+#define VENT_CONTROLLER_H
+
+#include <stdint.h>
+
+// Predictive vent control shared by both node firmwares.
+//
+// The controller fits a line through the recent (filtered) temperatures and
+// projects it VENT_PREDICT_HORIZON ahead, which covers the motor cooldown a
+// node waits out before it can act again. The projected excess over the
+// threshold maps to a vent opening across VENT_PROPORTIONAL_BAND, in steps
+// of VENT_POSITION_STEP, and the vent is driven there by running the motor
+// for the matching share of its full travel time.
+//
+// The vent position is estimated from run times. Moves to fully open or
+// closed run the whole travel time so the vent reaches its end stop and the
+// estimate is exact again; with limit switches fitted the move ends at the
+// switch instead (see reachEndStop()). moveTo() drives the vent to any
+// position, for the hub's move-to-position command.
+//
+// VentController is trivially constructible: a zeroed instance is a closed
+// vent with no samples, so it can live in RTC memory across deep sleep.
+
+#define VENT_TREND_SAMPLES 6            // Samples in the slope fit
+#define VENT_TREND_MIN_SAMPLES 3        // Fewer than this, no trend is used
+#define VENT_PREDICT_HORIZON 120000     // ms ahead the trend is projected
+#define VENT_PROPORTIONAL_BAND 3.0      // °C over the threshold for fully open
+#define VENT_POSITION_STEP 25           // Smallest move, percent
+#define VENT_FULLY_OPEN 100
+
+// A move decided by VentController::plan()
+struct VentMove {
+  int8_t direction;  // 1 open, -1 close, 0 no move
+  uint8_t target;    // Position reached at the end of the move, percent
+  uint32_t runTime;  // Motor run time, ms
+};
+
+struct VentController {
+  // Trend samples, oldest overwritten first
+  uint32_t sampleTime[VENT_TREND_SAMPLES];
+  float sampleTemperature[VENT_TREND_SAMPLES];
+  uint8_t sampleCount;
+  uint8_t nextSample;
+
+  uint8_t position;      // Estimated opening, percent
+  int8_t moveDirection;  // Move in progress: 1 opening, -1 closing, 0 none
+  uint8_t moveTarget;
+  uint32_t moveRunTime;
+
+  void addSample(uint32_t time, float temperature) {
+    sampleTime[nextSample] = time;
+    sampleTemperature[nextSample] = temperature;
+    nextSample = (nextSample + 1) % VENT_TREND_SAMPLES;
+    if (sampleCount < VENT_TREND_SAMPLES) {
+      sampleCount++;
+    }
+  }
+
+  float latest() const {
+    return sampleTemperature[(nextSample + VENT_TREND_SAMPLES - 1) % VENT_TREND_SAMPLES];
+  }
+
+  // Least-squares slope in °C per second, 0 until enough samples arrived
+  float slope() const {
+    if (sampleCount < VENT_TREND_MIN_SAMPLES) {
+      return 0;
+    }
+
+    // Times relative to the newest sample keep the sums small
+    uint32_t newest = sampleTime[(nextSample + VENT_TREND_SAMPLES - 1) % VENT_TREND_SAMPLES];
+    float sumT = 0, sumY = 0, sumTT = 0, sumTY = 0;
+    for (uint8_t i = 0; i < sampleCount; i++) {
+      float t = -(float)(newest - sampleTime[i]) / 1000.0f;
+      float y = sampleTemperature[i];
+      sumT += t;
+      sumY += y;
+      sumTT += t * t;
+      sumTY += t * y;
+    }
+
+    float denominator = sampleCount * sumTT - sumT * sumT;
+    if (denominator <= 0) {
+      return 0;
+    }
+    return (sampleCount * sumTY - sumT * sumY) / denominator;
+  }
+
+  float predict() const {
+    return latest() + slope() * (VENT_PREDICT_HORIZON / 1000.0f);
+  }
+
+  // Decides where the vent should be. Below threshold - hysteresis (predicted)
+  // it closes; between that and the threshold it holds its position.
+  VentMove plan(float threshold, float hysteresis, uint32_t travelTime) const {
+    VentMove move = {0, position, 0};
+    if (sampleCount == 0 || moveDirection != 0) {
+      return move;
+    }
+
+    float predicted = predict();
+    int target = position;
+    if (predicted < threshold - hysteresis) {
+      target = 0;
+    } else if (predicted > threshold) {
+      float opening = (predicted - threshold) / VENT_PROPORTIONAL_BAND * VENT_FULLY_OPEN;
+      if (opening > VENT_FULLY_OPEN) {
+        opening = VENT_FULLY_OPEN;
+      }
+
+      // Round up, so any predicted excess opens the vent at least one step
+      target = ((int)opening + VENT_POSITION_STEP - 1) / VENT_POSITION_STEP * VENT_POSITION_STEP;
+      if (target > VENT_FULLY_OPEN) {
+        target = VENT_FULLY_OPEN;
+      }
+    }
+
+    int change = target - position;
+    bool endpoint = target == 0 || target == VENT_FULLY_OPEN;
+    if (!endpoint && change > -VENT_POSITION_STEP && change < VENT_POSITION_STEP) {
+      return move;
+    }
+    return moveTo((uint8_t)target, travelTime);
+  }
+
+  // Move from the current position to target percent; no move if already there
+  VentMove moveTo(uint8_t target, uint32_t travelTime) const {
+    if (target > VENT_FULLY_OPEN) {
+      target = VENT_FULLY_OPEN;
+    }
+
+    VentMove move = {0, position, 0};
+    int change = target - position;
+    if (change == 0) {
+      return move;
+    }
+
+    bool endpoint = target == 0 || target == VENT_FULLY_OPEN;
+    move.direction = change > 0 ? 1 : -1;
+    move.target = target;
+    move.runTime = endpoint ? travelTime
+                            : (uint32_t)((change > 0 ? change : -change) * (uint64_t)travelTime / VENT_FULLY_OPEN);
+    return move;
+  }
+
+  // Full open/close commands that bypass plan()
+  static VentMove fullMove(int8_t direction, uint32_t travelTime) {
+    VentMove move = {direction, (uint8_t)(direction > 0 ? VENT_FULLY_OPEN : 0), travelTime};
+    return move;
+  }
+
+  void startMove(const VentMove &move) {
+    moveDirection = move.direction;
+    moveTarget = move.target;
+    moveRunTime = move.runTime;
+  }
+
+  // Updates the position estimate from how long the motor actually ran
+  void finishMove(uint32_t runTime, uint32_t travelTime) {
+    if (moveDirection == 0) {
+      return;
+    }
+
+    if (runTime >= moveRunTime) {
+      position = moveTarget;
+    } else {
+      // Stopped early
+      int moved = travelTime > 0 ? (int)((uint64_t)runTime * VENT_FULLY_OPEN / travelTime) : 0;
+      int estimate = position + moveDirection * moved;
+      position = estimate < 0 ? 0 : (estimate > VENT_FULLY_OPEN ? VENT_FULLY_OPEN : estimate);
+    }
+    moveDirection = 0;
+  }
+
+  // A limit switch closed: the vent is at that end, whatever the estimate said
+  void reachEndStop(int8_t direction) {
+    position = direction > 0 ? VENT_FULLY_OPEN : 0;
+    moveDirection = 0;
+  }
+};
+
+#endif
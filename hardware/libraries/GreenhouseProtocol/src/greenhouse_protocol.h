@@ -0,0 +1,235 @@
+#ifndef GREENHOUSE_PROTOCOL_H
+#define GREENHOUSE_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ESP-NOW wire format shared by the hub and both node firmwares.
+//
+// Every frame starts with a FrameHeader. Frames are packed so hub and nodes
+// agree on the layout regardless of compiler padding. Sensor values are
+// fixed point: temperature, humidity, threshold and hysteresis in
+// hundredths, pressure in tenths of hPa.
+//
+// Compatibility rule: a new protocol version may only append fields to a
+// frame. Receivers accept a frame from any version >= PROTOCOL_MIN_VERSION
+// that is at least as long as the version 1 layout, ignore extra bytes and
+// read fields missing from a shorter frame as 0 (see readFrame()).
+//
+// Version 2 appends the report-by-exception policy to ControlFrame.
+// Version 3 adds GroupFrame and appends the acknowledged frame type to
+// AckFrame. Older nodes ignore a GroupFrame, so the hub only addresses
+// nodes reporting version 3 or later with it.
+// Version 4 adds ScheduleFrame, sent only to nodes reporting version 4.
+// Version 5 appends the policy lease to ControlFrame and adds
+// SENSOR_FLAG_RECONCILE, CONTROL_FLAG_FALLBACK_AUTO and GROUP_FLAG_SYNC.
+// Version 6 adds BeaconFrame and DiscoverFrame, so nodes find the hub's
+// MAC address and Wi-Fi channel themselves. Older nodes ignore both.
+// Version 7 appends the vent position and motor counters to SensorFrame
+// and the target position of the 'P' command to ControlFrame. The hub
+// sends 'P' only to nodes reporting version 7.
+// Version 8 adds GROUP_FLAG_AUTO_MODE, set only for nodes reporting version 8.
+
+#define PROTOCOL_VERSION 8
+#define PROTOCOL_MIN_VERSION 1
+
+enum FrameType : uint8_t {
+  FRAME_SENSOR = 1,   // Node -> hub
+  FRAME_CONTROL = 2,  // Hub -> node
+  FRAME_ACK = 3,      // Node -> hub
+  FRAME_GROUP = 4,    // Hub -> nodes, broadcast
+  FRAME_SCHEDULE = 5,  // Hub -> node
+  FRAME_BEACON = 6,    // Hub -> nodes, broadcast
+  FRAME_DISCOVER = 7   // Node -> hub, broadcast
+};
+
+// SensorFrame.flags
+#define SENSOR_FLAG_AUTONOMOUS 0x01
+#define SENSOR_FLAG_RECONCILE 0x02  // Node lost its policy or its lease lapsed; hub resends all of it
+
+// ControlFrame.flags
+#define CONTROL_FLAG_AUTO_MODE 0x01
+#define CONTROL_FLAG_FALLBACK_AUTO 0x02  // A manual-mode node runs threshold control once its lease lapses
+
+// GroupFrame.flags
+#define GROUP_FLAG_MANUAL_MODE 0x01  // Addressed nodes also leave automatic mode
+#define GROUP_FLAG_SYNC 0x02         // Addressed nodes report at once (hub started)
+#define GROUP_FLAG_AUTO_MODE 0x04    // Addressed nodes return to automatic mode (version 8)
+
+struct __attribute__((packed)) FrameHeader {
+  uint8_t type;     // FrameType
+  uint8_t version;  // PROTOCOL_VERSION of the sender
+  uint8_t nodeId;   // Sender for node frames, target for control (0 = all)
+};
+
+struct __attribute__((packed)) SensorFrame {
+  FrameHeader header;
+  int16_t temperature;   // 0.01 °C
+  int16_t humidity;      // 0.01 %RH
+  uint16_t pressure;     // 0.1 hPa
+  uint8_t ventStatus;    // 0:closed, 1:opening, 2:open, 3:closing
+  uint8_t flags;         // SENSOR_FLAG_*
+  uint32_t timestamp;    // Node millis()
+  uint16_t ackSequence;  // Sequence of the last ControlFrame applied
+  // Version 7
+  uint8_t ventPosition;   // Estimated opening, percent
+  uint32_t motorSeconds;  // Total motor run time
+  uint32_t motorCycles;   // Total motor starts
+};
+
+struct __attribute__((packed)) ControlFrame {
+  FrameHeader header;
+  int16_t tempThreshold;  // 0.01 °C
+  int16_t hysteresis;     // 0.01 °C
+  uint8_t flags;          // CONTROL_FLAG_*
+  char manualCommand;     // 0, 'O', 'C', 'S' or 'P' (version 7)
+  uint16_t sequence;      // Per-node, never 0; echoed back by the node
+  // Version 2: report-by-exception policy, 0 keeps the node's current value
+  uint8_t temperatureDeadband;  // 0.01 °C
+  uint8_t humidityDeadband;     // 0.1 %RH
+  uint8_t pressureDeadband;     // 0.1 hPa
+  uint16_t heartbeatInterval;   // Seconds between reports when nothing changes
+  // Version 5
+  uint16_t policyLease;  // Seconds the node follows this policy without hub contact, 0 keeps
+  // Version 7
+  uint8_t ventTarget;  // Percent open, for manualCommand 'P'
+};
+
+struct __attribute__((packed)) AckFrame {
+  FrameHeader header;
+  uint16_t sequence;
+  // Version 3
+  uint8_t acked;  // FrameType acknowledged; 0 (older nodes) means FRAME_CONTROL
+};
+
+// One manual command for a set of nodes in a single broadcast. Each
+// addressed node answers with an AckFrame carrying acked = FRAME_GROUP.
+struct __attribute__((packed)) GroupFrame {
+  FrameHeader header;   // nodeId 0
+  uint32_t targetMask;  // Bit per addressed nodeId
+  char manualCommand;   // 'O', 'C', 'S', or 0 for a mode change only
+  uint8_t flags;        // GROUP_FLAG_*
+  uint16_t sequence;    // Hub-wide, never 0; echoed back by each node
+};
+
+// Upcoming scheduled vent commands for one node, which runs them itself
+// while the hub is unreachable. Nodes have no wall clock, so each event is
+// given relative to the moment the frame is sent. Acknowledged with an
+// AckFrame carrying acked = FRAME_SCHEDULE.
+#define SCHEDULE_FRAME_EVENTS 4
+
+struct __attribute__((packed)) ScheduleEvent {
+  uint32_t delay;       // Seconds from transmission
+  char manualCommand;   // 'O' or 'C'
+};
+
+struct __attribute__((packed)) ScheduleFrame {
+  FrameHeader header;
+  uint16_t sequence;  // Per node, never 0; echoed back by the node
+  uint8_t count;      // Events in use, soonest first; 0 clears the node's list
+  ScheduleEvent events[SCHEDULE_FRAME_EVENTS];
+};
+
+// Hub announcement, broadcast periodically, at once when its channel
+// changes and in answer to a DiscoverFrame. Nodes pair with the hub from
+// the source address.
+struct __attribute__((packed)) BeaconFrame {
+  FrameHeader header;  // nodeId 0
+  uint8_t channel;     // Wi-Fi channel the hub is on
+};
+
+// Node searching for the hub, broadcast on one channel after the other.
+// Adjacent channels overlap, so the beacon that answers it may be heard
+// from a neighbouring channel; the node then moves to BeaconFrame.channel.
+struct __attribute__((packed)) DiscoverFrame {
+  FrameHeader header;  // Sender
+};
+
+static_assert(sizeof(FrameHeader) == 3, "FrameHeader layout changed");
+static_assert(sizeof(SensorFrame) == 26, "SensorFrame layout changed");
+static_assert(sizeof(ControlFrame) == 19, "ControlFrame layout changed");
+static_assert(sizeof(AckFrame) == 6, "AckFrame layout changed");
+static_assert(sizeof(GroupFrame) == 11, "GroupFrame layout changed");
+static_assert(sizeof(ScheduleFrame) == 26, "ScheduleFrame layout changed");
+static_assert(sizeof(BeaconFrame) == 4, "BeaconFrame layout changed");
+static_assert(sizeof(DiscoverFrame) == 3, "DiscoverFrame layout changed");
+static_assert(offsetof(SensorFrame, ackSequence) == 15, "SensorFrame field moved");
+static_assert(offsetof(ControlFrame, sequence) == 9, "ControlFrame field moved");
+
+// ----- FIXED-POINT CONVERSION -----
+inline int16_t toFixed(float value, float scale) {
+  float scaled = value * scale;
+  if (scaled > 32767.0f) return 32767;
+  if (scaled < -32768.0f) return -32768;
+  return (int16_t)(scaled + (scaled >= 0 ? 0.5f : -0.5f));
+}
+
+inline uint16_t toFixedUnsigned(float value, float scale) {
+  float scaled = value * scale;
+  if (scaled > 65535.0f) return 65535;
+  if (scaled < 0.0f) return 0;
+  return (uint16_t)(scaled + 0.5f);
+}
+
+inline uint8_t toFixedByte(float value, float scale) {
+  uint16_t fixed = toFixedUnsigned(value, scale);
+  return fixed > 255 ? 255 : (uint8_t)fixed;
+}
+
+inline float fromFixed(int32_t value, float scale) {
+  return value / scale;
+}
+
+#define CENTI_SCALE 100.0f
+#define DECI_SCALE 10.0f
+
+// ----- FRAME HELPERS -----
+inline void initFrameHeader(FrameHeader &header, FrameType type, uint8_t nodeId) {
+  header.type = type;
+  header.version = PROTOCOL_VERSION;
+  header.nodeId = nodeId;
+}
+
+// Length of the first layout of a frame type (version 1, GroupFrame
+// version 3, ScheduleFrame version 4, BeaconFrame and DiscoverFrame
+// version 6), the shortest frame a receiver accepts
+inline size_t frameMinSize(uint8_t type) {
+  switch (type) {
+    case FRAME_SENSOR: return 17;
+    case FRAME_CONTROL: return 11;
+    case FRAME_ACK: return 5;
+    case FRAME_GROUP: return 11;
+    case FRAME_SCHEDULE: return 26;
+    case FRAME_BEACON: return 4;
+    case FRAME_DISCOVER: return 3;
+    default: return 0;
+  }
+}
+
+// Copies a received frame into out. Fields an older sender did not have
+// read as 0; bytes appended by a newer sender are dropped.
+inline void readFrame(void *out, size_t size, const uint8_t *data, int len) {
+  memset(out, 0, size);
+  memcpy(out, data, (size_t)len < size ? (size_t)len : size);
+}
+
+// Returns the frame type, or 0 if data is not a frame this build can parse
+inline uint8_t parseFrameType(const uint8_t *data, int len) {
+  if (len < (int)sizeof(FrameHeader)) {
+    return 0;
+  }
+
+  const FrameHeader *header = (const FrameHeader *)data;
+  if (header->version < PROTOCOL_MIN_VERSION) {
+    return 0;
+  }
+
+  size_t size = frameMinSize(header->type);
+  if (size == 0 || len < (int)size) {
+    return 0;
+  }
+  return header->type;
+}
+
+#endif
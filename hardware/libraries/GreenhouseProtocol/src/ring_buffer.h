@@ -0,0 +1,54 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Lock-free single-producer/single-consumer ring buffer.
+// Exactly one task may call push() and exactly one other task may call pop().
+// Capacity is N - 1 entries; N must be a power of two.
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+  bool push(const T &item) {
+    size_t head = headIndex.load(std::memory_order_relaxed);
+    size_t next = (head + 1) & (N - 1);
+    if (next == tailIndex.load(std::memory_order_acquire)) {
+      return false;  // Full
+    }
+    buffer[head] = item;
+    headIndex.store(next, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T &item) {
+    size_t tail = tailIndex.load(std::memory_order_relaxed);
+    if (tail == headIndex.load(std::memory_order_acquire)) {
+      return false;  // Empty
+    }
+    item = buffer[tail];
+    tailIndex.store((tail + 1) & (N - 1), std::memory_order_release);
+    return true;
+  }
+
+  // Entries push() can still take; exact for the producer, a lower bound
+  // while the consumer keeps popping
+  size_t space() const {
+    size_t head = headIndex.load(std::memory_order_relaxed);
+    return (tailIndex.load(std::memory_order_acquire) - head - 1) & (N - 1);
+  }
+
+  bool isEmpty() const {
+    return tailIndex.load(std::memory_order_acquire) == headIndex.load(std::memory_order_acquire);
+  }
+
+private:
+  T buffer[N];
+  std::atomic<size_t> headIndex{0};
+  std::atomic<size_t> tailIndex{0};
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef HUB_ENV_H
+#define HUB_ENV_H
+
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "sim_radio.h"
+
+// Surroundings of the simulated hub, implemented by the shims: the access
+// point and SNTP behind WiFi.h, the Firebase backend behind
+// Firebase_ESP_Client.h, clients of the local API, the buttons and the
+// I2C and flash traffic. The scenario in sim_main.cpp drives them.
+
+// Device costs charged to the running task, µs
+#define COST_FLASH_WRITE 120          // esp_partition_write() of one journal slot
+#define COST_FLASH_ERASE 45000        // One 4 KB sector
+#define COST_FS_OPEN 1500             // LittleFS open or remove
+#define COST_FS_BYTE 20               // LittleFS write per byte, read is a tenth of it
+#define COST_ESPNOW_SEND 60           // esp_now_send() queueing the frame
+#define COST_HTTP_RTT 180000          // Firebase request round trip, plus up to half of it in jitter
+#define COST_HTTP_BYTE 10             // Upload per byte, about 100 kB/s
+#define COST_TLS_HANDSHAKE 900000     // First request after (re)connecting
+#define COST_STREAM_POLL 400          // readStream() without an event
+#define HTTP_REQUEST_OVERHEAD 260     // Request line, headers and TLS record framing, bytes
+#define HTTP_RESPONSE_OVERHEAD 180
+
+#define WIFI_SCAN_TIME 2200000        // Full scan of channels 1-13
+#define WIFI_CONNECT_TIME 900000      // Authentication, association and DHCP
+#define WIFI_FAIL_TIME 4000000        // Until a failed attempt reports the disconnect
+#define SNTP_DELAY 400000             // First SNTP answer after the connection
+#define FIREBASE_TOKEN_TIME 1800000   // Anonymous sign-in after Firebase.begin()
+
+namespace sim {
+
+// ----- ACCESS POINT -----
+void wifiConfigure(uint8_t routerChannel, time_t wallClockAtBoot);
+time_t wallClock();                // Real time now, whether the hub has synced or not
+void wifiSetAccessPoint(bool up);  // Going down drops the hub's connection
+bool wifiLinkUp();
+uint64_t wifiConnectedAt();        // now() of the last connection
+RadioEndpoint &hubRadio();
+
+// ----- FIREBASE -----
+enum CloudEndpoint {
+  CLOUD_GREENHOUSES,  // updateNode() on /greenhouses and below
+  CLOUD_HISTORY,      // pushJSON() to /history
+  CLOUD_LOG,          // pushJSON() to /log
+  CLOUD_SYSTEM,       // setJSON() below /system
+  CLOUD_STREAM,       // Stream events received, own writes echoed included
+  CLOUD_ENDPOINTS
+};
+
+struct CloudStats {
+  uint64_t requests[CLOUD_ENDPOINTS];
+  uint64_t failures[CLOUD_ENDPOINTS];
+  uint64_t payloadBytes[CLOUD_ENDPOINTS];  // JSON bodies only
+  uint64_t wireBytes[CLOUD_ENDPOINTS];     // With HTTP_REQUEST_OVERHEAD and HTTP_RESPONSE_OVERHEAD
+  uint64_t logRecords;                     // Outbox records stored in /log
+};
+
+void cloudSetFailureRate(double rate);
+// A dashboard write below /greenhouses, e.g. ("/3/settings/mode", "\"auto\"");
+// the hub sees it as a stream event
+void cloudWrite(const char *path, const char *json);
+bool cloudHas(const char *path);
+const CloudStats &cloudStats();
+
+// ----- LOCAL API -----
+struct LocalResponse {
+  int code;
+  std::string body;
+};
+
+typedef std::vector<std::pair<std::string, std::string> > LocalParams;
+
+// Runs the request in the AsyncTCP task right now; token NULL sends none
+LocalResponse localRequest(bool post, const char *url, const char *token, const LocalParams &params);
+bool localConnectWebSocket(const char *token);  // True if the handshake was accepted
+uint64_t localWebSocketBytes();
+
+// ----- PINS, I2C AND FLASH -----
+void setPin(uint8_t pin, int level);  // Runs the pin interrupt on a change
+
+struct IoStats {
+  uint64_t i2cBytes;
+  uint64_t i2cTime;      // µs on the bus
+  uint64_t flashWrites;  // Settings journal
+  uint64_t flashErases;
+  uint64_t fsBytesWritten;
+  uint64_t logLines[5];  // Serial lines by log level, 0 for lines without one
+};
+
+void serialEcho(bool enabled);  // Copies the hub's Serial output to stdout
+
+const IoStats &ioStats();
+IoStats &mutableIoStats();
+
+}  // namespace sim
+
+#endif
@@ -0,0 +1,3 @@
+// The hub sketch, built unchanged: the Arduino builder would compile the
+// .ino as C++ the same way, its prototypes are all declared
+#include "../esp32_hub_firmware/esp32_hub_firmware.ino"
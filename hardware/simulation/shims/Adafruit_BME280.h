@@ -0,0 +1,26 @@
+#ifndef SIM_ADAFRUIT_BME280_H
+#define SIM_ADAFRUIT_BME280_H
+
+#include <Arduino.h>
+
+// Declared for node_hardware.h only; SimHardware (sim_nodes.h) produces the
+// readings of the simulated nodes.
+
+class Adafruit_BME280 {
+public:
+  enum sensor_sampling { SAMPLING_NONE, SAMPLING_X1, SAMPLING_X2, SAMPLING_X4, SAMPLING_X8, SAMPLING_X16 };
+  enum sensor_mode { MODE_SLEEP = 0, MODE_FORCED = 1, MODE_NORMAL = 3 };
+  enum sensor_filter { FILTER_OFF, FILTER_X2, FILTER_X4, FILTER_X8, FILTER_X16 };
+
+  bool begin(uint8_t address) { (void)address; return false; }
+  void setSampling(sensor_mode mode, sensor_sampling temperature, sensor_sampling pressure,
+                   sensor_sampling humidity, sensor_filter filter) {
+    (void)mode; (void)temperature; (void)pressure; (void)humidity; (void)filter;
+  }
+  bool takeForcedMeasurement() { return false; }
+  float readTemperature() { return NAN; }
+  float readHumidity() { return NAN; }
+  float readPressure() { return NAN; }
+};
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef SIM_ADAFRUIT_GFX_H
+#define SIM_ADAFRUIT_GFX_H
+
+// The drawing calls the hub uses are part of the SSD1306 stand-in
+#include "Adafruit_SSD1306.h"
+
+#endif
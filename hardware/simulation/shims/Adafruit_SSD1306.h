@@ -0,0 +1,48 @@
+#ifndef SIM_ADAFRUIT_SSD1306_H
+#define SIM_ADAFRUIT_SSD1306_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// 128x64 SSD1306 frame buffer with text output. Glyphs are a fixed pattern
+// per character, not the real font: what matters here is which bytes of the
+// buffer change, since pushDisplayChanges() sends only those.
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_COLUMNADDR 0x21
+#define SSD1306_PAGEADDR 0x22
+
+class Adafruit_SSD1306 : public Print {
+public:
+  Adafruit_SSD1306(uint8_t width, uint8_t height, TwoWire *wire, int8_t resetPin);
+  ~Adafruit_SSD1306();
+
+  bool begin(uint8_t vccState, uint8_t address);
+  void clearDisplay();
+  void display();  // Whole frame, as the library sends it
+  uint8_t *getBuffer() { return buffer; }
+
+  void setTextSize(uint8_t size) { textSize = size > 0 ? size : 1; }
+  void setTextColor(uint16_t color) { textColor = color; }
+  void setCursor(int16_t x, int16_t y) { cursorX = x; cursorY = y; }
+
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+private:
+  void drawPixel(int16_t x, int16_t y, bool on);
+
+  uint8_t width;
+  uint8_t height;
+  TwoWire *wire;
+  uint8_t address = 0x3C;
+  uint8_t *buffer;
+  uint8_t textSize = 1;
+  uint16_t textColor = SSD1306_WHITE;
+  int16_t cursorX = 0;
+  int16_t cursorY = 0;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// Host stand-in for the parts of Arduino-ESP32 2.x the firmware uses. Time
+// comes from the simulation clock (sim_clock.h); FreeRTOS tasks run as
+// cooperative tasks on it.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include "esp_system.h"
+
+using std::max;
+using std::min;
+
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define CHANGE 0x03
+#define DEC 10
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode);
+uint32_t getCpuFrequencyMhz();
+
+bool psramFound();
+void *ps_malloc(size_t size);
+
+// ----- STRING -----
+class String {
+public:
+  String() {}
+  String(const char *text) : value(text != NULL ? text : "") {}
+  String(const std::string &text) : value(text) {}
+  String(char c) : value(1, c) {}
+  String(int number) : value(std::to_string(number)) {}
+  String(unsigned int number) : value(std::to_string(number)) {}
+  String(long number) : value(std::to_string(number)) {}
+  String(unsigned long number) : value(std::to_string(number)) {}
+
+  const char *c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.size(); }
+  bool operator==(const char *text) const { return value == text; }
+  bool operator!=(const char *text) const { return value != text; }
+  bool operator==(const String &other) const { return value == other.value; }
+  String &operator+=(const String &other) { value += other.value; return *this; }
+  String operator+(const String &other) const { return String(value + other.value); }
+  const std::string &str() const { return value; }
+
+private:
+  std::string value;
+};
+
+// ----- PRINT -----
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size; i++) write(data[i]);
+    return size;
+  }
+  size_t write(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+  size_t write(const char *text, size_t size) { return write((const uint8_t *)text, size); }
+
+  size_t print(const char *text) { return write(text); }
+  size_t print(const String &text) { return write(text.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char number, int base = DEC) { return print((unsigned long)number, base); }
+  size_t print(int number, int base = DEC) { return print((long)number, base); }
+  size_t print(unsigned int number, int base = DEC) { return print((unsigned long)number, base); }
+  size_t print(long number, int base = DEC) { return printFormat(base == 16 ? "%lx" : "%ld", number); }
+  size_t print(unsigned long number, int base = DEC) { return printFormat(base == 16 ? "%lx" : "%lu", number); }
+  size_t print(double number, int digits = 2) { return printFormat("%.*f", digits, number); }
+
+  template <typename T>
+  size_t println(T value) { size_t n = print(value); return n + println(); }
+  template <typename T>
+  size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+  size_t println() { return write("\r\n"); }
+
+private:
+  template <typename... Args>
+  size_t printFormat(const char *format, Args... args) {
+    char buffer[48];
+    int length = snprintf(buffer, sizeof(buffer), format, args...);
+    return write((const uint8_t *)buffer, length < (int)sizeof(buffer) ? length : sizeof(buffer) - 1);
+  }
+};
+
+// Log lines are counted per level and only printed with --verbose
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  int availableForWrite() { return 4096; }
+  void flush() {}
+  size_t write(uint8_t c) override;
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+// ----- ESP -----
+class EspClass {
+public:
+  uint32_t getCycleCount();
+  uint32_t getFreeHeap() { return 180000; }
+  uint32_t getMinFreeHeap() { return 150000; }
+  uint32_t getMaxAllocHeap() { return 110000; }
+};
+
+extern EspClass ESP;
+
+// ----- FREERTOS -----
+typedef void *TaskHandle_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+
+#define tskIDLE_PRIORITY 0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))  // 1 kHz tick, as configured by Arduino-ESP32
+
+BaseType_t xTaskCreatePinnedToCore(void (*function)(void *), const char *name, uint32_t stackSize,
+                                   void *parameter, unsigned int priority, TaskHandle_t *handle,
+                                   BaseType_t core);
+void vTaskDelay(TickType_t ticks);
+
+// One host thread runs everything, so critical sections need no lock
+struct portMUX_TYPE {
+  int owner;
+};
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define noInterrupts()
+#define interrupts()
+
+// SNTP and the POSIX time zone; time() follows the simulated wall clock
+void configTzTime(const char *timeZone, const char *server);
+
+#endif
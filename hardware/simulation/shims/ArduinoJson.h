@@ -0,0 +1,6 @@
+#ifndef SIM_ARDUINOJSON_H
+#define SIM_ARDUINOJSON_H
+
+// Included by wifi_firebase.cpp, which builds its JSON with FirebaseJson
+
+#endif
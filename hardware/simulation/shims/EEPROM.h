@@ -0,0 +1,21 @@
+#ifndef SIM_EEPROM_H
+#define SIM_EEPROM_H
+
+#include <Arduino.h>
+
+// Declared for node_hardware.h, whose ArduinoNodeHardware goes unused here:
+// the simulated nodes keep their EEPROM in SimHardware (sim_nodes.h).
+
+class EEPROMClass {
+public:
+  bool begin(size_t size) { (void)size; return true; }
+  template <typename T>
+  T &get(int address, T &value) { (void)address; return value; }
+  template <typename T>
+  const T &put(int address, const T &value) { (void)address; return value; }
+  bool commit() { return true; }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
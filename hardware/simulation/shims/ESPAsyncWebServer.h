@@ -0,0 +1,126 @@
+#ifndef SIM_ESP_ASYNC_WEB_SERVER_H
+#define SIM_ESP_ASYNC_WEB_SERVER_H
+
+#include <Arduino.h>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The parts of ESPAsyncWebServer the local API uses. Requests come from the
+// scenario through localRequest() (hub_env.h) and run to completion in the
+// calling event, as handlers do in the AsyncTCP task.
+
+typedef enum {
+  HTTP_GET = 0b00000001,
+  HTTP_POST = 0b00000010,
+  HTTP_ANY = 0b01111111
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebParameter {
+public:
+  AsyncWebParameter(const String &name, const String &value, bool form)
+    : paramName(name), paramValue(value), form(form) {}
+
+  const String &name() const { return paramName; }
+  const String &value() const { return paramValue; }
+  bool isPost() const { return form; }
+
+private:
+  String paramName;
+  String paramValue;
+  bool form;
+};
+
+class AsyncResponseStream : public Print {
+public:
+  explicit AsyncResponseStream(const char *contentType) : type(contentType) {}
+
+  size_t write(uint8_t c) override { body += (char)c; return 1; }
+  using Print::write;
+
+  std::string type;
+  std::string body;
+};
+
+class AsyncWebServerRequest {
+public:
+  AsyncWebServerRequest(WebRequestMethod method, const char *url) : requestMethod(method), requestUrl(url) {}
+  ~AsyncWebServerRequest();
+
+  WebRequestMethodComposite method() const { return requestMethod; }
+  const String &url() const { return requestUrl; }
+
+  bool hasParam(const char *name, bool form = false) const;
+  const AsyncWebParameter *getParam(const char *name, bool form = false) const;
+  bool hasHeader(const char *name) const;
+  const String &header(const char *name) const;
+
+  void send(int code, const char *contentType, const char *body);
+  AsyncResponseStream *beginResponseStream(const char *contentType);
+  void send(AsyncResponseStream *response);
+
+  // Shim state
+  void addParam(const char *name, const char *value, bool form);
+  void addHeader(const char *name, const char *value);
+
+  int responseCode = 0;
+  std::string responseBody;
+
+private:
+  WebRequestMethod requestMethod;
+  String requestUrl;
+  std::vector<AsyncWebParameter> params;
+  std::vector<std::pair<String, String> > headers;
+  AsyncResponseStream *stream = NULL;
+};
+
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+typedef std::function<bool(AsyncWebServerRequest *request)> ArHandshakeHandler;
+
+class AsyncWebSocket {
+public:
+  explicit AsyncWebSocket(const char *url) : path(url) {}
+
+  void handleHandshake(ArHandshakeHandler handler) { handshake = handler; }
+  size_t count() const { return clients; }
+  void textAll(const char *message, size_t length);
+  void cleanupClients() {}
+
+  // Shim state
+  std::string path;
+  ArHandshakeHandler handshake;
+  size_t clients = 0;
+  uint64_t bytesSent = 0;  // Payload bytes times clients
+};
+
+class AsyncWebServer {
+public:
+  explicit AsyncWebServer(uint16_t port);
+
+  void on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction handler);
+  void onNotFound(ArRequestHandlerFunction handler) { notFound = handler; }
+  void addHandler(AsyncWebSocket *socket) { webSocket = socket; }
+  void begin() { started = true; }
+
+  // Shim state: finds the handler the way the library matches routes
+  void handle(AsyncWebServerRequest *request);
+  bool connectWebSocket(AsyncWebServerRequest *request);
+  uint64_t webSocketBytes() const { return webSocket != NULL ? webSocket->bytesSent : 0; }
+
+private:
+  struct Route {
+    std::string uri;
+    WebRequestMethodComposite method;
+    ArRequestHandlerFunction handler;
+  };
+
+  std::vector<Route> routes;
+  ArRequestHandlerFunction notFound;
+  AsyncWebSocket *webSocket = NULL;
+  bool started = false;
+};
+
+#endif
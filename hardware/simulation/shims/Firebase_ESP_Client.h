@@ -0,0 +1,160 @@
+#ifndef SIM_FIREBASE_ESP_CLIENT_H
+#define SIM_FIREBASE_ESP_CLIENT_H
+
+#include <Arduino.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The subset of Firebase-ESP-Client 4.x the hub uses, backed by an
+// in-memory database (see hub_env.h). Requests wait for a modelled round
+// trip; the stream delivers dashboard writes and the hub's own updates as
+// put/patch events, the way the RTDB REST stream does.
+
+// ----- JSON -----
+class JsonValue {
+public:
+  enum Kind { NUL, INT, FLOAT, BOOLEAN, STRING, OBJECT, ARRAY };
+
+  Kind kind = NUL;
+  double number = 0;
+  std::string text;
+  std::vector<std::pair<std::string, JsonValue> > members;  // OBJECT, in insertion order
+  std::vector<JsonValue> items;                             // ARRAY
+
+  JsonValue *find(const std::string &key);
+  JsonValue &member(const std::string &key);  // Added, as NUL, if missing
+  void erase(const std::string &key);
+  JsonValue *atPath(const std::string &path);  // "a/b/c", NULL if missing
+  JsonValue &makePath(const std::string &path);
+
+  std::string serialize() const;
+  bool parse(const char *&text);
+  const char *typeName() const;  // As FirebaseJsonData::type reports it
+};
+
+JsonValue jsonFrom(int value);
+JsonValue jsonFrom(unsigned int value);
+JsonValue jsonFrom(long value);
+JsonValue jsonFrom(unsigned long value);
+JsonValue jsonFrom(float value);
+JsonValue jsonFrom(double value);
+JsonValue jsonFrom(bool value);
+JsonValue jsonFrom(const char *value);  // NULL gives null
+JsonValue jsonFrom(const String &value);
+inline JsonValue jsonFrom(int8_t value) { return jsonFrom((int)value); }
+inline JsonValue jsonFrom(uint8_t value) { return jsonFrom((int)value); }
+inline JsonValue jsonFrom(int16_t value) { return jsonFrom((int)value); }
+inline JsonValue jsonFrom(uint16_t value) { return jsonFrom((int)value); }
+
+class FirebaseJsonArray {
+public:
+  JsonValue value;
+
+  FirebaseJsonArray() { value.kind = JsonValue::ARRAY; }
+
+  template <typename T>
+  FirebaseJsonArray &add(T item) {
+    value.items.push_back(jsonFrom(item));
+    return *this;
+  }
+};
+
+class FirebaseJsonData {
+public:
+  bool success = false;
+  String stringValue;
+  String type;
+  double number = 0;
+
+  template <typename T>
+  T to() const { return (T)number; }
+};
+
+class FirebaseJson {
+public:
+  JsonValue root;
+
+  FirebaseJson() { root.kind = JsonValue::OBJECT; }
+
+  // Key kept literal, "a/b" stays one key
+  template <typename T>
+  FirebaseJson &add(const char *key, T value) {
+    root.member(key) = jsonFrom(value);
+    return *this;
+  }
+
+  // Path, "a/b" creates the nested objects
+  template <typename T>
+  FirebaseJson &set(const char *path, T value) {
+    root.makePath(path) = jsonFrom(value);
+    return *this;
+  }
+  FirebaseJson &set(const char *path, const FirebaseJsonArray &array) {
+    root.makePath(path) = array.value;
+    return *this;
+  }
+
+  bool get(FirebaseJsonData &result, const char *path);
+  bool setJsonData(const char *text);
+  void clear() { root = JsonValue(); root.kind = JsonValue::OBJECT; }
+  void toString(String &out) const { out = root.serialize(); }
+};
+
+// ----- CLIENT -----
+struct FirebaseAuth {
+  struct {
+    String email;
+    String password;
+  } user;
+};
+
+struct FirebaseConfig {
+  String api_key;
+  String database_url;
+};
+
+class FirebaseData {
+public:
+  String errorReason() const { return String(error); }
+  String dataPath() const { return String(eventPath); }
+  String dataType() const { return String(eventType); }
+  String payload() const { return String(eventPayload); }
+  FirebaseJson &jsonObject() { return eventJson; }
+  bool streamAvailable() const { return eventAvailable; }
+
+  // Shim state
+  std::string error;
+  std::string eventPath;
+  std::string eventType;
+  std::string eventPayload;
+  FirebaseJson eventJson;
+  bool eventAvailable = false;
+  bool streaming = false;
+  std::string streamPath;
+  uint64_t connectedSince = 0;  // wifiConnectedAt() the TLS session belongs to
+  uint64_t streamEpoch = 0;     // Connection the stream last sent its snapshot on
+};
+
+class FirebaseRtdb {
+public:
+  bool getJSON(FirebaseData *data, const char *path);
+  bool updateNode(FirebaseData *data, const char *path, FirebaseJson *json);
+  bool setJSON(FirebaseData *data, const char *path, FirebaseJson *json);
+  bool pushJSON(FirebaseData *data, const char *path, FirebaseJson *json);
+  bool beginStream(FirebaseData *data, const char *path);
+  bool readStream(FirebaseData *data);
+};
+
+class FirebaseClass {
+public:
+  FirebaseRtdb RTDB;
+
+  void begin(FirebaseConfig *config, FirebaseAuth *auth);
+  void reconnectWiFi(bool enabled) { (void)enabled; }
+  bool ready();
+};
+
+extern FirebaseClass Firebase;
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef SIM_LITTLEFS_H
+#define SIM_LITTLEFS_H
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// LittleFS on the hub's spiffs partition, held in RAM. Files keep their
+// contents across a simulated reboot; opens and writes charge their flash
+// time (COST_FS_OPEN, COST_FS_BYTE in hub_env.h).
+
+typedef std::shared_ptr<std::vector<uint8_t> > FileContents;
+
+class File {
+public:
+  File() {}
+  File(FileContents contents, bool writable, size_t position)
+    : contents(contents), writable(writable), position(position) {}
+
+  explicit operator bool() const { return contents != nullptr; }
+  size_t read(uint8_t *buffer, size_t size);
+  size_t write(const uint8_t *buffer, size_t size);
+  bool seek(uint32_t offset);
+  size_t size() const { return contents != nullptr ? contents->size() : 0; }
+  void close() { contents = nullptr; }
+
+private:
+  FileContents contents;
+  bool writable = false;
+  size_t position = 0;
+};
+
+class LittleFSFS {
+public:
+  bool begin(bool formatOnFail);
+  File open(const char *path, const char *mode);
+  bool remove(const char *path);
+  bool exists(const char *path);
+  size_t totalBytes();  // Partition size, writes beyond it fail
+  size_t usedBytes();
+};
+
+extern LittleFSFS LittleFS;
+
+#endif
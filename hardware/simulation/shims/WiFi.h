@@ -0,0 +1,53 @@
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include <Arduino.h>
+#include "esp_wifi.h"
+
+// Station with one simulated access point (see hub_env.h). A connect
+// without a BSSID scans every channel first, which takes the radio away
+// from ESP-NOW as on the device; a connect to a cached BSSID and channel
+// skips the scan. Events arrive from the Wi-Fi event task.
+
+typedef enum {
+  ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP = 7
+} arduino_event_id_t;
+
+typedef arduino_event_id_t WiFiEvent_t;
+typedef void (*WiFiEventCb)(arduino_event_id_t event);
+
+typedef enum {
+  WIFI_OFF = 0,
+  WIFI_STA = 1,
+  WIFI_AP = 2,
+  WIFI_AP_STA = 3
+} wifi_mode_t;
+
+class IPAddress {
+public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : bytes{a, b, c, d} {}
+  uint8_t operator[](int index) const { return bytes[index]; }
+
+private:
+  uint8_t bytes[4];
+};
+
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t mode);
+  bool setSleep(bool enabled);
+  bool setAutoReconnect(bool enabled);
+  void onEvent(WiFiEventCb callback);
+  int begin(const char *ssid, const char *password, int32_t channel = 0, const uint8_t *bssid = NULL);
+  bool disconnect();
+  bool isConnected();
+  uint8_t *BSSID();
+  uint8_t channel();
+  IPAddress localIP();
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include <Arduino.h>
+
+// I2C master that only accounts for bus time: each transaction charges its
+// start, address, data and stop bits at the clock set with setClock(), the
+// way a blocking Wire.endTransmission() holds the caller.
+
+class TwoWire {
+public:
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+  bool setClock(uint32_t frequency);
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  size_t write(const uint8_t *data, size_t size);
+  uint8_t endTransmission(bool sendStop = true);
+
+private:
+  uint32_t clock = 100000;
+  size_t pending = 0;  // Bytes of the open transaction
+};
+
+extern TwoWire Wire;
+
+#endif
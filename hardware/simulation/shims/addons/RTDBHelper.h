@@ -0,0 +1,6 @@
+#ifndef SIM_RTDB_HELPER_H
+#define SIM_RTDB_HELPER_H
+
+// Printing helpers of the Firebase client; not used by the hub
+
+#endif
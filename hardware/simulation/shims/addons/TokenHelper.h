@@ -0,0 +1,6 @@
+#ifndef SIM_TOKEN_HELPER_H
+#define SIM_TOKEN_HELPER_H
+
+// Token status callbacks of the Firebase client; not used by the hub
+
+#endif
@@ -0,0 +1,179 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+#include "../hub_env.h"
+#include "../sim_clock.h"
+
+#define PIN_COUNT 40
+
+HardwareSerial Serial;
+EspClass ESP;
+EEPROMClass EEPROM;
+
+static sim::IoStats io;
+
+namespace sim {
+
+const IoStats &ioStats() {
+  return io;
+}
+
+IoStats &mutableIoStats() {
+  return io;
+}
+
+}  // namespace sim
+
+// ----- TIME -----
+unsigned long millis() {
+  return (unsigned long)(sim::now() / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)sim::now();
+}
+
+void delay(uint32_t ms) {
+  sim::sleepTask((uint64_t)ms * 1000);
+}
+
+void yield() {}
+
+int64_t esp_timer_get_time() {
+  return (int64_t)sim::now();
+}
+
+uint32_t EspClass::getCycleCount() {
+  return (uint32_t)(sim::now() * getCpuFrequencyMhz());
+}
+
+uint32_t getCpuFrequencyMhz() {
+  return 240;
+}
+
+uint32_t esp_random() {
+  return sim::random32();
+}
+
+// ----- PINS -----
+struct PinState {
+  int level;
+  void (*handler)(void *);
+  void *arg;
+};
+
+static PinState pins[PIN_COUNT];
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin < PIN_COUNT && mode == INPUT_PULLUP) {
+    pins[pin].level = HIGH;
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin < PIN_COUNT) {
+    pins[pin].level = value;
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < PIN_COUNT ? pins[pin].level : LOW;
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode) {
+  (void)mode;  // The buttons use CHANGE, the only mode modelled
+  if (pin < PIN_COUNT) {
+    pins[pin].handler = handler;
+    pins[pin].arg = arg;
+  }
+}
+
+void sim::setPin(uint8_t pin, int level) {
+  if (pin >= PIN_COUNT || pins[pin].level == level) {
+    return;
+  }
+  pins[pin].level = level;
+  if (pins[pin].handler != NULL) {
+    pins[pin].handler(pins[pin].arg);
+  }
+}
+
+// ----- MEMORY -----
+bool psramFound() {
+  return false;  // ESP32-WROOM-32 as on the hub board
+}
+
+void *ps_malloc(size_t size) {
+  return malloc(size);
+}
+
+// ----- TASKS -----
+BaseType_t xTaskCreatePinnedToCore(void (*function)(void *), const char *name, uint32_t stackSize,
+                                   void *parameter, unsigned int priority, TaskHandle_t *handle,
+                                   BaseType_t core) {
+  (void)stackSize;
+  (void)priority;
+  (void)core;
+  sim::startTask(function, parameter, name);
+  if (handle != NULL) {
+    *handle = NULL;
+  }
+  return 1;  // pdPASS
+}
+
+void vTaskDelay(TickType_t ticks) {
+  sim::sleepTask((uint64_t)ticks * 1000);
+}
+
+// ----- SERIAL -----
+// Lines from greenhouse_log.cpp start with "[seconds] L tag: "
+static std::string serialLine;
+static bool echo = false;
+
+void sim::serialEcho(bool enabled) {
+  echo = enabled;
+}
+
+static int lineLevel(const std::string &line) {
+  size_t close = line.find("] ");
+  if (line.empty() || line[0] != '[' || close == std::string::npos || close + 3 >= line.size()) {
+    return 0;
+  }
+  switch (line[close + 2]) {
+    case 'E': return 1;
+    case 'W': return 2;
+    case 'I': return 3;
+    case 'D': return 4;
+    default: return 0;
+  }
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (c == '\r') {
+    return 1;
+  }
+  if (c != '\n') {
+    serialLine += (char)c;
+    return 1;
+  }
+
+  io.logLines[lineLevel(serialLine)]++;
+  if (echo) {
+    printf("%12.3f hub %s\n", sim::now() / 1e6, serialLine.c_str());
+  }
+  serialLine.clear();
+  return 1;
+}
+
+// ----- CRC -----
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buffer, uint32_t length) {
+  crc = ~crc;
+  for (uint32_t i = 0; i < length; i++) {
+    crc ^= buffer[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
@@ -0,0 +1,144 @@
+#include <Adafruit_SSD1306.h>
+#include <Wire.h>
+#include "../hub_env.h"
+#include "../sim_clock.h"
+
+#define GLYPH_WIDTH 6  // 5 columns and a space, as the classic GFX font
+#define GLYPH_HEIGHT 8
+
+TwoWire Wire;
+
+// ----- I2C -----
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+  (void)sda;
+  (void)scl;
+  if (frequency != 0) {
+    clock = frequency;
+  }
+  return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency) {
+  clock = frequency;
+  return true;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  (void)address;
+  pending = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  (void)data;
+  pending++;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t size) {
+  (void)data;
+  pending += size;
+  return size;
+}
+
+// Start, address byte, data bytes with their ACK bits, stop
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  (void)sendStop;
+  uint64_t bits = (pending + 1) * 9 + 2;
+  uint64_t busTime = bits * 1000000 / clock;
+  sim::IoStats &io = sim::mutableIoStats();
+  io.i2cBytes += pending + 1;
+  io.i2cTime += busTime;
+  sim::spend(busTime);
+  pending = 0;
+  return 0;
+}
+
+// ----- SSD1306 -----
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t width, uint8_t height, TwoWire *wire, int8_t resetPin)
+  : width(width), height(height), wire(wire) {
+  (void)resetPin;
+  buffer = new uint8_t[width * height / 8]();
+}
+
+Adafruit_SSD1306::~Adafruit_SSD1306() {
+  delete[] buffer;
+}
+
+// The library sends its init sequence, then clears the panel with a full frame
+bool Adafruit_SSD1306::begin(uint8_t vccState, uint8_t i2cAddress) {
+  (void)vccState;
+  address = i2cAddress;
+  wire->setClock(400000);
+  for (int i = 0; i < 25; i++) {
+    wire->beginTransmission(address);
+    wire->write((uint8_t)0x00);
+    wire->write((uint8_t)0xAE);
+    wire->endTransmission();
+  }
+  wire->setClock(100000);
+  display();
+  return true;
+}
+
+void Adafruit_SSD1306::clearDisplay() {
+  memset(buffer, 0, width * height / 8);
+}
+
+void Adafruit_SSD1306::display() {
+  wire->setClock(400000);
+  wire->beginTransmission(address);
+  wire->write((uint8_t)0x00);
+  for (int i = 0; i < 6; i++) {
+    wire->write((uint8_t)0x21);  // Window commands
+  }
+  wire->endTransmission();
+
+  size_t size = width * height / 8;
+  for (size_t sent = 0; sent < size; sent += 31) {
+    size_t count = std::min((size_t)31, size - sent);
+    wire->beginTransmission(address);
+    wire->write((uint8_t)0x40);
+    wire->write(buffer + sent, count);
+    wire->endTransmission();
+  }
+  wire->setClock(100000);
+}
+
+void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, bool on) {
+  if (x < 0 || y < 0 || x >= width || y >= height) {
+    return;
+  }
+  uint8_t &byte = buffer[x + (y / 8) * width];
+  uint8_t bit = 1 << (y & 7);
+  byte = on ? (byte | bit) : (byte & ~bit);
+}
+
+size_t Adafruit_SSD1306::write(uint8_t c) {
+  if (c == '\n') {
+    cursorX = 0;
+    cursorY += GLYPH_HEIGHT * textSize;
+    return 1;
+  }
+  if (c == '\r') {
+    return 1;
+  }
+
+  // A distinct 5x7 pattern per character code
+  uint32_t pattern = (c * 2654435761u) ^ (c << 7);
+  for (int column = 0; column < 5; column++) {
+    uint8_t bits = c == ' ' ? 0 : (uint8_t)((pattern >> (column * 5)) | (c >> column)) & 0x7F;
+    for (int row = 0; row < 7; row++) {
+      if (((bits >> row) & 1) == 0) {
+        continue;  // No background color set, as in the firmware
+      }
+      for (int sx = 0; sx < textSize; sx++) {
+        for (int sy = 0; sy < textSize; sy++) {
+          drawPixel(cursorX + column * textSize + sx, cursorY + row * textSize + sy,
+                    textColor == SSD1306_WHITE);
+        }
+      }
+    }
+  }
+  cursorX += GLYPH_WIDTH * textSize;
+  return 1;
+}
@@ -0,0 +1,12 @@
+#ifndef SIM_ESP_TASK_WDT_H
+#define SIM_ESP_TASK_WDT_H
+
+#include "esp_system.h"
+
+// The simulation has no watchdog; a stalled task shows up in the loop
+// timing report instead
+inline esp_err_t esp_task_wdt_init(uint32_t timeout, bool panic) { (void)timeout; (void)panic; return ESP_OK; }
+inline esp_err_t esp_task_wdt_add(void *task) { (void)task; return ESP_OK; }
+inline esp_err_t esp_task_wdt_reset() { return ESP_OK; }
+
+#endif
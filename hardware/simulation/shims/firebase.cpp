@@ -0,0 +1,534 @@
+#include <Firebase_ESP_Client.h>
+#include <ctype.h>
+#include <deque>
+#include "../hub_env.h"
+#include "../sim_clock.h"
+
+#define STREAM_EVENT_OVERHEAD 48  // "event: patch\ndata: {"path":...,"data":...}\n\n" framing
+#define OFFLINE_FAIL_TIME 5000    // A request without a connection fails at once
+
+FirebaseClass Firebase;
+
+// ----- JSON -----
+JsonValue *JsonValue::find(const std::string &key) {
+  for (auto &member : members) {
+    if (member.first == key) {
+      return &member.second;
+    }
+  }
+  return NULL;
+}
+
+JsonValue &JsonValue::member(const std::string &key) {
+  if (kind != OBJECT) {
+    *this = JsonValue();
+    kind = OBJECT;
+  }
+  JsonValue *existing = find(key);
+  if (existing != NULL) {
+    return *existing;
+  }
+  members.push_back(std::make_pair(key, JsonValue()));
+  return members.back().second;
+}
+
+void JsonValue::erase(const std::string &key) {
+  for (size_t i = 0; i < members.size(); i++) {
+    if (members[i].first == key) {
+      members.erase(members.begin() + i);
+      return;
+    }
+  }
+}
+
+static std::vector<std::string> splitPath(const std::string &path) {
+  std::vector<std::string> parts;
+  size_t start = 0;
+  while (start <= path.size()) {
+    size_t end = path.find('/', start);
+    if (end == std::string::npos) {
+      end = path.size();
+    }
+    if (end > start) {
+      parts.push_back(path.substr(start, end - start));
+    }
+    start = end + 1;
+  }
+  return parts;
+}
+
+JsonValue *JsonValue::atPath(const std::string &path) {
+  JsonValue *node = this;
+  for (const std::string &part : splitPath(path)) {
+    node = node->kind == OBJECT ? node->find(part) : NULL;
+    if (node == NULL) {
+      return NULL;
+    }
+  }
+  return node;
+}
+
+JsonValue &JsonValue::makePath(const std::string &path) {
+  JsonValue *node = this;
+  for (const std::string &part : splitPath(path)) {
+    node = &node->member(part);
+  }
+  return *node;
+}
+
+static void appendString(std::string &out, const std::string &text) {
+  out += '"';
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+    }
+    out += c;
+  }
+  out += '"';
+}
+
+std::string JsonValue::serialize() const {
+  char number[32];
+  std::string out;
+  switch (kind) {
+    case NUL:
+      return "null";
+    case INT:
+      snprintf(number, sizeof(number), "%.0f", this->number);
+      return number;
+    case FLOAT:
+      snprintf(number, sizeof(number), "%.7g", this->number);
+      return number;
+    case BOOLEAN:
+      return this->number != 0 ? "true" : "false";
+    case STRING:
+      appendString(out, text);
+      return out;
+    case OBJECT:
+      out = "{";
+      for (size_t i = 0; i < members.size(); i++) {
+        if (i > 0) out += ',';
+        appendString(out, members[i].first);
+        out += ':';
+        out += members[i].second.serialize();
+      }
+      return out + "}";
+    case ARRAY:
+      out = "[";
+      for (size_t i = 0; i < items.size(); i++) {
+        if (i > 0) out += ',';
+        out += items[i].serialize();
+      }
+      return out + "]";
+  }
+  return out;
+}
+
+static void skipSpace(const char *&text) {
+  while (isspace((unsigned char)*text)) text++;
+}
+
+static bool parseString(const char *&text, std::string &out) {
+  if (*text != '"') {
+    return false;
+  }
+  text++;
+  while (*text != '\0' && *text != '"') {
+    if (*text == '\\' && text[1] != '\0') {
+      text++;
+    }
+    out += *text++;
+  }
+  if (*text != '"') {
+    return false;
+  }
+  text++;
+  return true;
+}
+
+bool JsonValue::parse(const char *&text) {
+  *this = JsonValue();
+  skipSpace(text);
+
+  if (*text == '{') {
+    kind = OBJECT;
+    text++;
+    skipSpace(text);
+    if (*text == '}') {
+      text++;
+      return true;
+    }
+    for (;;) {
+      std::string key;
+      skipSpace(text);
+      if (!parseString(text, key)) return false;
+      skipSpace(text);
+      if (*text++ != ':') return false;
+      JsonValue value;
+      if (!value.parse(text)) return false;
+      members.push_back(std::make_pair(key, value));
+      skipSpace(text);
+      if (*text == ',') { text++; continue; }
+      if (*text == '}') { text++; return true; }
+      return false;
+    }
+  }
+
+  if (*text == '[') {
+    kind = ARRAY;
+    text++;
+    skipSpace(text);
+    if (*text == ']') {
+      text++;
+      return true;
+    }
+    for (;;) {
+      JsonValue value;
+      if (!value.parse(text)) return false;
+      items.push_back(value);
+      skipSpace(text);
+      if (*text == ',') { text++; continue; }
+      if (*text == ']') { text++; return true; }
+      return false;
+    }
+  }
+
+  if (*text == '"') {
+    kind = STRING;
+    return parseString(text, this->text);
+  }
+  if (strncmp(text, "null", 4) == 0) {
+    text += 4;
+    return true;
+  }
+  if (strncmp(text, "true", 4) == 0 || strncmp(text, "false", 5) == 0) {
+    kind = BOOLEAN;
+    number = *text == 't';
+    text += *text == 't' ? 4 : 5;
+    return true;
+  }
+
+  char *end;
+  number = strtod(text, &end);
+  if (end == text) {
+    return false;
+  }
+  kind = INT;
+  for (const char *c = text; c < end; c++) {
+    if (*c == '.' || *c == 'e' || *c == 'E') kind = FLOAT;
+  }
+  text = end;
+  return true;
+}
+
+const char *JsonValue::typeName() const {
+  static const char *names[] = {"null", "int", "float", "boolean", "string", "object", "array"};
+  return names[kind];
+}
+
+static JsonValue numberValue(JsonValue::Kind kind, double number) {
+  JsonValue value;
+  value.kind = kind;
+  value.number = number;
+  return value;
+}
+
+JsonValue jsonFrom(int value) { return numberValue(JsonValue::INT, value); }
+JsonValue jsonFrom(unsigned int value) { return numberValue(JsonValue::INT, value); }
+JsonValue jsonFrom(long value) { return numberValue(JsonValue::INT, value); }
+JsonValue jsonFrom(unsigned long value) { return numberValue(JsonValue::INT, value); }
+JsonValue jsonFrom(float value) { return numberValue(JsonValue::FLOAT, value); }
+JsonValue jsonFrom(double value) { return numberValue(JsonValue::FLOAT, value); }
+JsonValue jsonFrom(bool value) { return numberValue(JsonValue::BOOLEAN, value); }
+
+JsonValue jsonFrom(const char *value) {
+  JsonValue json;
+  if (value != NULL) {
+    json.kind = JsonValue::STRING;
+    json.text = value;
+  }
+  return json;
+}
+
+JsonValue jsonFrom(const String &value) {
+  return jsonFrom(value.c_str());
+}
+
+bool FirebaseJson::get(FirebaseJsonData &result, const char *path) {
+  const JsonValue *value = root.atPath(path);
+  result = FirebaseJsonData();
+  if (value == NULL) {
+    return false;
+  }
+
+  result.success = true;
+  result.type = value->typeName();
+  if (value->kind == JsonValue::STRING) {
+    result.stringValue = value->text;
+    result.number = strtod(value->text.c_str(), NULL);
+  } else {
+    result.stringValue = value->serialize();
+    result.number = value->number;
+  }
+  return true;
+}
+
+bool FirebaseJson::setJsonData(const char *text) {
+  JsonValue parsed;
+  if (!parsed.parse(text) || parsed.kind != JsonValue::OBJECT) {
+    return false;
+  }
+  root = parsed;
+  return true;
+}
+
+// ----- BACKEND -----
+struct StreamEvent {
+  uint64_t arrival;
+  std::string path;  // Below /greenhouses
+  JsonValue data;
+};
+
+static JsonValue database;
+static std::deque<StreamEvent> streamEvents;
+static sim::CloudStats stats;
+static double failureRate = 0.01;
+static uint64_t pushCounter = 0;
+static bool firebaseBegun = false;
+static uint64_t firebaseBegunAt = 0;
+
+static sim::CloudEndpoint endpointFor(const char *path) {
+  if (strncmp(path, "/history", 8) == 0) return sim::CLOUD_HISTORY;
+  if (strncmp(path, "/log", 4) == 0) return sim::CLOUD_LOG;
+  if (strncmp(path, "/system", 7) == 0) return sim::CLOUD_SYSTEM;
+  return sim::CLOUD_GREENHOUSES;
+}
+
+static uint64_t halfTrip() {
+  return COST_HTTP_RTT / 2 + (uint64_t)(sim::randomUnit() * COST_HTTP_RTT / 4);
+}
+
+// Waits out one request on the data object's connection; the task is
+// blocked on the socket meanwhile, so other events run
+static bool request(FirebaseData *data, sim::CloudEndpoint endpoint, size_t bodyBytes) {
+  stats.requests[endpoint]++;
+  if (!sim::wifiLinkUp()) {
+    stats.failures[endpoint]++;
+    data->error = "connection lost";
+    sim::sleepTask(OFFLINE_FAIL_TIME);
+    return false;
+  }
+
+  uint64_t connection = sim::wifiConnectedAt();
+  uint64_t wait = 2 * halfTrip() + bodyBytes * COST_HTTP_BYTE;
+  if (data->connectedSince != connection) {
+    wait += COST_TLS_HANDSHAKE;
+    data->connectedSince = connection;
+  }
+  stats.wireBytes[endpoint] += bodyBytes + HTTP_REQUEST_OVERHEAD + HTTP_RESPONSE_OVERHEAD;
+  sim::sleepTask(wait);
+
+  if (!sim::wifiLinkUp() || sim::wifiConnectedAt() != connection) {
+    stats.failures[endpoint]++;
+    data->error = "connection lost";
+    return false;
+  }
+  if (sim::randomUnit() < failureRate) {
+    stats.failures[endpoint]++;
+    data->error = "response payload read timed out";
+    return false;
+  }
+  stats.payloadBytes[endpoint] += bodyBytes;
+  data->error.clear();
+  return true;
+}
+
+static void deleteAt(const std::string &path) {
+  std::vector<std::string> parts = splitPath(path);
+  if (parts.empty()) {
+    database = JsonValue();
+    return;
+  }
+  std::string parentPath;
+  for (size_t i = 0; i + 1 < parts.size(); i++) {
+    parentPath += "/" + parts[i];
+  }
+  JsonValue *parent = database.atPath(parentPath);
+  if (parent != NULL && parent->kind == JsonValue::OBJECT) {
+    parent->erase(parts.back());
+  }
+}
+
+static void writeAt(const std::string &path, const JsonValue &value) {
+  if (value.kind == JsonValue::NUL) {
+    deleteAt(path);
+  } else {
+    database.makePath(path) = value;
+  }
+}
+
+// Writes below /greenhouses reach the stream after the trip down
+static void notifyStream(const std::string &path, const JsonValue &data) {
+  static const std::string root = "/greenhouses";
+  if (path.compare(0, root.size(), root) != 0) {
+    return;
+  }
+  std::string relative = path.substr(root.size());
+  if (relative.empty()) {
+    relative = "/";
+  }
+  streamEvents.push_back(StreamEvent{sim::now() + halfTrip(), relative, data});
+}
+
+bool FirebaseRtdb::getJSON(FirebaseData *data, const char *path) {
+  if (!request(data, endpointFor(path), 0)) {
+    return false;
+  }
+  JsonValue *node = database.atPath(path);
+  JsonValue value = node != NULL ? *node : JsonValue();
+  std::string body = value.serialize();
+  // The answer is downloaded, not uploaded; count it with the payloads
+  stats.payloadBytes[endpointFor(path)] += body.size();
+  stats.wireBytes[endpointFor(path)] += body.size();
+  data->eventType = value.kind == JsonValue::OBJECT ? "json" : value.typeName();
+  data->eventPayload = body;
+  data->eventJson.clear();
+  if (value.kind == JsonValue::OBJECT) {
+    data->eventJson.root = value;
+  }
+  return true;
+}
+
+bool FirebaseRtdb::updateNode(FirebaseData *data, const char *path, FirebaseJson *json) {
+  std::string body = json->root.serialize();
+  if (!request(data, endpointFor(path), body.size())) {
+    return false;
+  }
+  for (const auto &member : json->root.members) {
+    writeAt(std::string(path) + "/" + member.first, member.second);
+  }
+  notifyStream(path, json->root);
+  return true;
+}
+
+bool FirebaseRtdb::setJSON(FirebaseData *data, const char *path, FirebaseJson *json) {
+  std::string body = json->root.serialize();
+  if (!request(data, endpointFor(path), body.size())) {
+    return false;
+  }
+  writeAt(path, json->root);
+  notifyStream(path, json->root);
+  return true;
+}
+
+bool FirebaseRtdb::pushJSON(FirebaseData *data, const char *path, FirebaseJson *json) {
+  std::string body = json->root.serialize();
+  sim::CloudEndpoint endpoint = endpointFor(path);
+  if (!request(data, endpoint, body.size())) {
+    return false;
+  }
+  char key[24];
+  snprintf(key, sizeof(key), "/-N%010llu", (unsigned long long)++pushCounter);
+  writeAt(std::string(path) + key, json->root);
+
+  const JsonValue *types = json->root.atPath("records/type");
+  if (endpoint == sim::CLOUD_LOG && types != NULL) {
+    stats.logRecords += types->items.size();
+  }
+  return true;
+}
+
+bool FirebaseRtdb::beginStream(FirebaseData *data, const char *path) {
+  if (!request(data, sim::CLOUD_STREAM, 0)) {
+    return false;
+  }
+  data->streaming = true;
+  data->streamPath = path;
+  data->streamEpoch = 0;
+  return true;
+}
+
+static void deliver(FirebaseData *data, const std::string &path, const JsonValue &value) {
+  data->eventPath = path;
+  data->eventType = value.kind == JsonValue::OBJECT ? "json" : value.typeName();
+  data->eventPayload = value.serialize();
+  data->eventJson.clear();
+  if (value.kind == JsonValue::OBJECT) {
+    data->eventJson.root = value;
+  }
+  data->eventAvailable = true;
+  stats.payloadBytes[sim::CLOUD_STREAM] += data->eventPayload.size();
+  stats.wireBytes[sim::CLOUD_STREAM] += data->eventPayload.size() + path.size() + STREAM_EVENT_OVERHEAD;
+}
+
+bool FirebaseRtdb::readStream(FirebaseData *data) {
+  data->eventAvailable = false;
+  if (!data->streaming) {
+    data->error = "stream not started";
+    return false;
+  }
+  if (!sim::wifiLinkUp()) {
+    data->error = "connection lost";
+    return false;
+  }
+
+  // Events written while the connection was down are lost; the library
+  // reconnects and the server starts with a put of the whole tree
+  if (data->streamEpoch != sim::wifiConnectedAt()) {
+    if (!request(data, sim::CLOUD_STREAM, 0)) {
+      return false;
+    }
+    data->streamEpoch = sim::wifiConnectedAt();
+    streamEvents.clear();
+    JsonValue *tree = database.atPath(data->streamPath);
+    deliver(data, "/", tree != NULL ? *tree : JsonValue());
+    return true;
+  }
+
+  sim::spend(COST_STREAM_POLL);
+  if (!streamEvents.empty() && streamEvents.front().arrival <= sim::now()) {
+    StreamEvent event = streamEvents.front();
+    streamEvents.pop_front();
+    deliver(data, event.path, event.data);
+  }
+  return true;
+}
+
+void FirebaseClass::begin(FirebaseConfig *config, FirebaseAuth *auth) {
+  (void)config;
+  (void)auth;
+  firebaseBegun = true;
+  firebaseBegunAt = sim::now();
+}
+
+bool FirebaseClass::ready() {
+  return firebaseBegun && sim::wifiLinkUp() && sim::now() >= firebaseBegunAt + FIREBASE_TOKEN_TIME;
+}
+
+namespace sim {
+
+void cloudSetFailureRate(double rate) {
+  failureRate = rate;
+}
+
+void cloudWrite(const char *path, const char *json) {
+  JsonValue value;
+  const char *text = json;
+  if (!value.parse(text)) {
+    fprintf(stderr, "cloudWrite: bad JSON for %s: %s\n", path, json);
+    abort();
+  }
+  std::string full = std::string("/greenhouses") + path;
+  writeAt(full, value);
+  notifyStream(full, value);
+}
+
+bool cloudHas(const char *path) {
+  return database.atPath(path) != NULL;
+}
+
+const CloudStats &cloudStats() {
+  return stats;
+}
+
+}  // namespace sim
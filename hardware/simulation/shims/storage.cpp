@@ -0,0 +1,167 @@
+#include <LittleFS.h>
+#include <esp_partition.h>
+#include <map>
+#include "../hub_env.h"
+#include "../sim_clock.h"
+
+#define FLASH_SECTOR_SIZE 4096
+
+LittleFSFS LittleFS;
+
+static sim::IoStats &io = sim::mutableIoStats();
+
+// ----- PARTITIONS -----
+// Data partitions of ../esp32_hub_firmware/partitions.csv
+static esp_partition_t partitions[] = {
+  {ESP_PARTITION_TYPE_DATA, 0x02, 0x9000, 0x5000, "nvs"},
+  {ESP_PARTITION_TYPE_DATA, 0x82, 0x290000, 0x15C000, "spiffs"},
+  {ESP_PARTITION_TYPE_DATA, 0x40, 0x3EC000, 0x4000, "settings"},
+};
+
+static std::map<const esp_partition_t *, std::vector<uint8_t> > contents;
+
+static std::vector<uint8_t> &flash(const esp_partition_t *partition) {
+  std::vector<uint8_t> &bytes = contents[partition];
+  if (bytes.empty()) {
+    bytes.assign(partition->size, 0xFF);  // Erased
+  }
+  return bytes;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype,
+                                                const char *label) {
+  for (const esp_partition_t &partition : partitions) {
+    if (partition.type == type &&
+        (subtype == ESP_PARTITION_SUBTYPE_ANY || partition.subtype == subtype) &&
+        (label == NULL || strcmp(partition.label, label) == 0)) {
+      return &partition;
+    }
+  }
+  return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *dst, size_t size) {
+  if (offset + size > partition->size) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  memcpy(dst, flash(partition).data() + offset, size);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset, const void *src, size_t size) {
+  if (offset + size > partition->size) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  std::vector<uint8_t> &bytes = flash(partition);
+  const uint8_t *data = (const uint8_t *)src;
+  for (size_t i = 0; i < size; i++) {
+    bytes[offset + i] &= data[i];  // NOR flash only clears bits
+  }
+  io.flashWrites++;
+  sim::spend(COST_FLASH_WRITE);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+  if (offset % FLASH_SECTOR_SIZE != 0 || size % FLASH_SECTOR_SIZE != 0 || offset + size > partition->size) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  memset(flash(partition).data() + offset, 0xFF, size);
+  io.flashErases += size / FLASH_SECTOR_SIZE;
+  sim::spend(COST_FLASH_ERASE * (size / FLASH_SECTOR_SIZE));
+  return ESP_OK;
+}
+
+// ----- LITTLEFS -----
+static std::map<std::string, FileContents> files;
+static bool mounted = false;
+
+static size_t usedBytes() {
+  size_t used = 0;
+  for (const auto &file : files) {
+    used += (file.second->size() + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE * FLASH_SECTOR_SIZE;
+  }
+  return used;
+}
+
+size_t File::read(uint8_t *buffer, size_t size) {
+  if (contents == nullptr || position >= contents->size()) {
+    return 0;
+  }
+  size_t count = std::min(size, contents->size() - position);
+  memcpy(buffer, contents->data() + position, count);
+  position += count;
+  sim::spend(count * COST_FS_BYTE / 10);
+  return count;
+}
+
+size_t File::write(const uint8_t *buffer, size_t size) {
+  if (contents == nullptr || !writable) {
+    return 0;
+  }
+  if (position + size > contents->size() && ::usedBytes() + size > LittleFS.totalBytes()) {
+    return 0;
+  }
+  if (position + size > contents->size()) {
+    contents->resize(position + size);
+  }
+  memcpy(contents->data() + position, buffer, size);
+  position += size;
+  io.fsBytesWritten += size;
+  sim::spend(size * COST_FS_BYTE);
+  return size;
+}
+
+bool File::seek(uint32_t offset) {
+  if (contents == nullptr || offset > contents->size()) {
+    return false;
+  }
+  position = offset;
+  return true;
+}
+
+bool LittleFSFS::begin(bool formatOnFail) {
+  (void)formatOnFail;  // The RAM image always mounts
+  mounted = true;
+  return true;
+}
+
+File LittleFSFS::open(const char *path, const char *mode) {
+  if (!mounted) {
+    return File();
+  }
+  sim::spend(COST_FS_OPEN);
+
+  auto found = files.find(path);
+  bool exists = found != files.end();
+  if (mode[0] == 'r') {
+    if (!exists) {
+      return File();
+    }
+    return File(found->second, mode[1] == '+', 0);
+  }
+
+  if (!exists || mode[0] == 'w') {
+    files[path] = std::make_shared<std::vector<uint8_t> >();
+  }
+  FileContents contents = files[path];
+  return File(contents, true, mode[0] == 'a' ? contents->size() : 0);
+}
+
+bool LittleFSFS::remove(const char *path) {
+  sim::spend(COST_FS_OPEN);
+  return files.erase(path) > 0;
+}
+
+bool LittleFSFS::exists(const char *path) {
+  return files.count(path) > 0;
+}
+
+size_t LittleFSFS::totalBytes() {
+  return 0x15C000;
+}
+
+size_t LittleFSFS::usedBytes() {
+  return ::usedBytes();
+}
@@ -0,0 +1,174 @@
+#include <ESPAsyncWebServer.h>
+#include "../hub_env.h"
+#include "../sim_clock.h"
+
+#define WS_FRAME_OVERHEAD 4  // Header of a short unmasked text frame
+
+// Servers are constructed during static initialization, in any order
+static std::vector<AsyncWebServer *> &servers() {
+  static std::vector<AsyncWebServer *> list;
+  return list;
+}
+
+// ----- REQUEST -----
+AsyncWebServerRequest::~AsyncWebServerRequest() {
+  delete stream;
+}
+
+bool AsyncWebServerRequest::hasParam(const char *name, bool form) const {
+  return getParam(name, form) != NULL;
+}
+
+const AsyncWebParameter *AsyncWebServerRequest::getParam(const char *name, bool form) const {
+  for (const AsyncWebParameter &param : params) {
+    if (param.isPost() == form && param.name() == name) {
+      return &param;
+    }
+  }
+  return NULL;
+}
+
+bool AsyncWebServerRequest::hasHeader(const char *name) const {
+  for (const auto &header : headers) {
+    if (strcasecmp(header.first.c_str(), name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const String &AsyncWebServerRequest::header(const char *name) const {
+  static const String empty;
+  for (const auto &header : headers) {
+    if (strcasecmp(header.first.c_str(), name) == 0) {
+      return header.second;
+    }
+  }
+  return empty;
+}
+
+void AsyncWebServerRequest::send(int code, const char *contentType, const char *body) {
+  (void)contentType;
+  responseCode = code;
+  responseBody = body;
+}
+
+AsyncResponseStream *AsyncWebServerRequest::beginResponseStream(const char *contentType) {
+  delete stream;
+  stream = new AsyncResponseStream(contentType);
+  return stream;
+}
+
+void AsyncWebServerRequest::send(AsyncResponseStream *response) {
+  responseCode = 200;
+  responseBody = response->body;
+}
+
+void AsyncWebServerRequest::addParam(const char *name, const char *value, bool form) {
+  params.push_back(AsyncWebParameter(name, value, form));
+}
+
+void AsyncWebServerRequest::addHeader(const char *name, const char *value) {
+  headers.push_back(std::make_pair(String(name), String(value)));
+}
+
+// ----- SERVER -----
+AsyncWebServer::AsyncWebServer(uint16_t port) {
+  (void)port;
+  servers().push_back(this);
+}
+
+void AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction handler) {
+  routes.push_back(Route{uri, method, handler});
+}
+
+// A route matches its URI exactly or as a prefix followed by '/'
+void AsyncWebServer::handle(AsyncWebServerRequest *request) {
+  if (!started) {
+    return;
+  }
+  const std::string &url = request->url().str();
+  for (const Route &route : routes) {
+    bool uriMatches = url == route.uri ||
+                      (url.compare(0, route.uri.size(), route.uri) == 0 && url[route.uri.size()] == '/');
+    if (uriMatches && (route.method & request->method()) != 0) {
+      route.handler(request);
+      return;
+    }
+  }
+  if (notFound) {
+    notFound(request);
+  } else {
+    request->send(404, "text/plain", "");
+  }
+}
+
+bool AsyncWebServer::connectWebSocket(AsyncWebServerRequest *request) {
+  if (!started || webSocket == NULL || request->url().str() != webSocket->path) {
+    return false;
+  }
+  if (webSocket->handshake && !webSocket->handshake(request)) {
+    return false;
+  }
+  webSocket->clients++;
+  return true;
+}
+
+void AsyncWebSocket::textAll(const char *message, size_t length) {
+  (void)message;
+  bytesSent += (length + WS_FRAME_OVERHEAD) * clients;
+}
+
+// ----- SCENARIO SIDE -----
+namespace sim {
+
+static AsyncWebServerRequest *buildRequest(bool post, const char *url, const char *token,
+                                           const LocalParams &params) {
+  AsyncWebServerRequest *request = new AsyncWebServerRequest(post ? HTTP_POST : HTTP_GET, url);
+  if (token != NULL) {
+    std::string value = std::string("Bearer ") + token;
+    request->addHeader("Authorization", value.c_str());
+  }
+  for (const auto &param : params) {
+    request->addParam(param.first.c_str(), param.second.c_str(), post);
+  }
+  return request;
+}
+
+LocalResponse localRequest(bool post, const char *url, const char *token, const LocalParams &params) {
+  LocalResponse response = {0, ""};
+  if (!wifiLinkUp()) {
+    return response;  // Unreachable, the client times out
+  }
+  AsyncWebServerRequest *request = buildRequest(post, url, token, params);
+  for (AsyncWebServer *server : servers()) {
+    server->handle(request);
+  }
+  response.code = request->responseCode;
+  response.body = request->responseBody;
+  delete request;
+  return response;
+}
+
+bool localConnectWebSocket(const char *token) {
+  if (!wifiLinkUp()) {
+    return false;
+  }
+  AsyncWebServerRequest *request = buildRequest(false, "/ws", token, LocalParams());
+  bool accepted = false;
+  for (AsyncWebServer *server : servers()) {
+    accepted |= server->connectWebSocket(request);
+  }
+  delete request;
+  return accepted;
+}
+
+uint64_t localWebSocketBytes() {
+  uint64_t bytes = 0;
+  for (AsyncWebServer *server : servers()) {
+    bytes += server->webSocketBytes();
+  }
+  return bytes;
+}
+
+}  // namespace sim
@@ -0,0 +1,318 @@
+#include <WiFi.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "../hub_env.h"
+#include "../sim_clock.h"
+
+#define WIFI_CHANNELS 13
+
+static const uint8_t routerBssid[6] = {0x9C, 0x53, 0x22, 0x10, 0x20, 0x30};
+static const uint8_t hubMac[6] = {0x24, 0x0A, 0xC4, 0x5E, 0x00, 0x01};
+
+WiFiClass WiFi;
+
+// ----- ACCESS POINT AND STATION -----
+static uint8_t routerChannel = 6;
+static time_t wallClockAtBoot = 1760000000;
+static bool accessPointUp = true;
+
+static bool connected = false;
+static uint64_t connectedAt = 0;
+static uint64_t attempt = 0;  // Bumped by begin() and disconnect(), stale events check it
+static bool scanning = false;
+static uint64_t scanStartedAt = 0;
+static uint8_t homeChannel = 1;  // Channel when not scanning
+static bool clockSynced = false;
+static WiFiEventCb eventCallback = NULL;
+
+static void fireEvent(arduino_event_id_t event) {
+  if (eventCallback != NULL) {
+    eventCallback(event);
+  }
+}
+
+// The scan dwells on each channel in turn; ESP-NOW frames are not heard meanwhile
+static uint8_t currentChannel() {
+  if (scanning) {
+    uint64_t dwell = WIFI_SCAN_TIME / WIFI_CHANNELS;
+    return (uint8_t)(1 + ((sim::now() - scanStartedAt) / dwell) % WIFI_CHANNELS);
+  }
+  return homeChannel;
+}
+
+static void connectionLost() {
+  if (!connected) {
+    return;
+  }
+  connected = false;
+  fireEvent(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+}
+
+static void associate(uint64_t id) {
+  sim::after(WIFI_CONNECT_TIME, [id]() {
+    if (id != attempt) {
+      return;
+    }
+    if (!accessPointUp || homeChannel != routerChannel) {
+      sim::after(WIFI_FAIL_TIME - WIFI_CONNECT_TIME, [id]() {
+        if (id == attempt) {
+          fireEvent(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+        }
+      });
+      return;
+    }
+
+    connected = true;
+    connectedAt = sim::now();
+    fireEvent(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    if (!clockSynced) {
+      sim::after(SNTP_DELAY, []() { clockSynced = connected; });
+    }
+  });
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+  (void)mode;
+  return true;
+}
+
+bool WiFiClass::setSleep(bool enabled) {
+  (void)enabled;
+  return true;
+}
+
+bool WiFiClass::setAutoReconnect(bool enabled) {
+  (void)enabled;  // The hub paces reconnects itself; nothing reconnects here
+  return true;
+}
+
+void WiFiClass::onEvent(WiFiEventCb callback) {
+  eventCallback = callback;
+}
+
+int WiFiClass::begin(const char *ssid, const char *password, int32_t channel, const uint8_t *bssid) {
+  (void)ssid;
+  (void)password;
+  uint64_t id = ++attempt;
+  connected = false;
+
+  if (channel != 0 && bssid != NULL) {
+    scanning = false;
+    homeChannel = (uint8_t)channel;  // A router that moved meanwhile is not found there
+    associate(id);
+    return 0;
+  }
+
+  scanning = true;
+  scanStartedAt = sim::now();
+  sim::after(WIFI_SCAN_TIME, [id]() {
+    if (id != attempt) {
+      return;
+    }
+    scanning = false;
+    if (accessPointUp) {
+      homeChannel = routerChannel;
+    }
+    associate(id);
+  });
+  return 0;
+}
+
+bool WiFiClass::disconnect() {
+  attempt++;
+  scanning = false;
+  if (connected) {
+    // Reported from the event task, after the call returns
+    connected = false;
+    sim::after(1000, []() { fireEvent(ARDUINO_EVENT_WIFI_STA_DISCONNECTED); });
+  }
+  return true;
+}
+
+bool WiFiClass::isConnected() {
+  return connected;
+}
+
+uint8_t *WiFiClass::BSSID() {
+  static uint8_t bssid[6];
+  memcpy(bssid, routerBssid, 6);
+  return bssid;
+}
+
+uint8_t WiFiClass::channel() {
+  return currentChannel();
+}
+
+IPAddress WiFiClass::localIP() {
+  return connected ? IPAddress(192, 168, 1, 50) : IPAddress();
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second) {
+  (void)second;
+  if (primary < 1 || primary > WIFI_CHANNELS) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  homeChannel = primary;
+  return ESP_OK;
+}
+
+namespace sim {
+
+void wifiConfigure(uint8_t channel, time_t wallClock) {
+  routerChannel = channel;
+  wallClockAtBoot = wallClock;
+}
+
+void wifiSetAccessPoint(bool up) {
+  accessPointUp = up;
+  if (!up && connected) {
+    // Beacon loss, noticed after a few missed beacons
+    sim::after(300000, []() {
+      if (!accessPointUp) {
+        connectionLost();
+      }
+    });
+  }
+}
+
+time_t wallClock() {
+  return wallClockAtBoot + (time_t)(sim::now() / 1000000);
+}
+
+bool wifiLinkUp() {
+  return connected;
+}
+
+uint64_t wifiConnectedAt() {
+  return connectedAt;
+}
+
+}  // namespace sim
+
+// ----- TIME -----
+// The firmware calls time(); the link wraps it (-Wl,--wrap=time) so it
+// follows the simulated clock. Before the first SNTP answer the ESP32
+// counts from 0 at boot.
+extern "C" time_t __wrap_time(time_t *out) {
+  time_t seconds = (time_t)(sim::now() / 1000000);
+  if (clockSynced) {
+    seconds += wallClockAtBoot;
+  }
+  if (out != NULL) {
+    *out = seconds;
+  }
+  return seconds;
+}
+
+void configTzTime(const char *timeZone, const char *server) {
+  (void)server;
+  setenv("TZ", timeZone, 1);
+  tzset();
+}
+
+// ----- ESP-NOW -----
+class HubRadio : public sim::RadioEndpoint {
+public:
+  esp_now_recv_cb_t receiveCallback = NULL;
+  esp_now_send_cb_t sendCallback = NULL;
+
+  HubRadio() {
+    memcpy(mac, hubMac, 6);
+    isHub = true;
+  }
+
+  uint8_t radioChannel() const override { return currentChannel(); }
+  bool radioListening() const override { return !scanning; }
+
+  void radioReceive(const uint8_t *from, const uint8_t *data, int len) override {
+    if (receiveCallback != NULL) {
+      receiveCallback(from, data, len);
+    }
+  }
+
+  void radioSendDone(const uint8_t *to, bool delivered) override {
+    if (sendCallback != NULL) {
+      sendCallback(to, delivered ? ESP_NOW_SEND_SUCCESS : ESP_NOW_SEND_FAIL);
+    }
+  }
+};
+
+static HubRadio hubRadio;
+static bool espNowReady = false;
+static std::vector<std::vector<uint8_t> > peers;
+
+static int findPeer(const uint8_t *mac) {
+  for (size_t i = 0; i < peers.size(); i++) {
+    if (memcmp(peers[i].data(), mac, 6) == 0) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+sim::RadioEndpoint &sim::hubRadio() {
+  return ::hubRadio;
+}
+
+esp_err_t esp_now_init() {
+  if (!espNowReady) {
+    sim::radioAttach(&hubRadio);
+    espNowReady = true;
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t callback) {
+  hubRadio.receiveCallback = callback;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t callback) {
+  hubRadio.sendCallback = callback;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t *peer) {
+  if (!espNowReady) {
+    return ESP_ERR_ESPNOW_NOT_INIT;
+  }
+  if (findPeer(peer->peer_addr) >= 0) {
+    return ESP_ERR_ESPNOW_EXIST;
+  }
+  if (peers.size() >= ESP_NOW_MAX_TOTAL_PEER_NUM) {
+    return ESP_ERR_ESPNOW_FULL;
+  }
+  peers.push_back(std::vector<uint8_t>(peer->peer_addr, peer->peer_addr + 6));
+  return ESP_OK;
+}
+
+esp_err_t esp_now_del_peer(const uint8_t *mac) {
+  int index = findPeer(mac);
+  if (index < 0) {
+    return ESP_ERR_ESPNOW_NOT_FOUND;
+  }
+  peers.erase(peers.begin() + index);
+  return ESP_OK;
+}
+
+bool esp_now_is_peer_exist(const uint8_t *mac) {
+  return findPeer(mac) >= 0;
+}
+
+esp_err_t esp_now_send(const uint8_t *mac, const uint8_t *data, size_t len) {
+  if (!espNowReady) {
+    return ESP_ERR_ESPNOW_NOT_INIT;
+  }
+  if (len == 0 || len > ESP_NOW_MAX_DATA_LEN) {
+    return ESP_ERR_ESPNOW_ARG;
+  }
+  if (findPeer(mac) < 0) {
+    return ESP_ERR_ESPNOW_NOT_FOUND;
+  }
+  sim::spend(COST_ESPNOW_SEND);
+  sim::radioSend(&hubRadio, mac, data, (int)len);
+  return ESP_OK;
+}
@@ -0,0 +1,140 @@
+#include "sim_clock.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <queue>
+#include <vector>
+#include <ucontext.h>
+
+#define TASK_STACK_SIZE (512 * 1024)  // Host code, printf included, needs more than the device stack
+
+namespace sim {
+
+struct Event {
+  uint64_t time;
+  uint64_t order;  // Events due together run in the order they were scheduled
+  std::function<void()> action;
+
+  bool operator>(const Event &other) const {
+    return time != other.time ? time > other.time : order > other.order;
+  }
+};
+
+struct Task {
+  const char *name;
+  void (*function)(void *);
+  void *parameter;
+  ucontext_t context;
+  std::vector<char> stack;
+};
+
+static std::priority_queue<Event, std::vector<Event>, std::greater<Event> > events;
+static uint64_t clock = 0;
+static uint64_t debt = 0;  // Charged by the running event
+static uint64_t nextOrder = 0;
+
+static ucontext_t schedulerContext;
+static Task *currentTask = NULL;
+
+static uint64_t randomState = 0x9E3779B97F4A7C15ULL;
+
+uint64_t now() {
+  return clock + debt;
+}
+
+void spend(uint64_t micros) {
+  debt += micros;
+}
+
+uint64_t charged() {
+  return debt;
+}
+
+void at(uint64_t time, std::function<void()> action) {
+  events.push(Event{time < clock ? clock : time, nextOrder++, action});
+}
+
+void runUntil(uint64_t end) {
+  while (!events.empty() && events.top().time <= end) {
+    Event event = events.top();
+    events.pop();
+    clock = event.time;
+    debt = 0;
+    event.action();
+  }
+  clock = end;
+  debt = 0;
+}
+
+static void resumeTask(Task *task) {
+  currentTask = task;
+  swapcontext(&schedulerContext, &task->context);
+  currentTask = NULL;
+}
+
+static void taskEntry(unsigned int high, unsigned int low) {
+  Task *task = (Task *)(((uintptr_t)high << 32) | low);
+  task->function(task->parameter);
+  fprintf(stderr, "Task %s returned\n", task->name);  // FreeRTOS would abort here too
+  abort();
+}
+
+void startTask(void (*function)(void *), void *parameter, const char *name) {
+  Task *task = new Task();
+  task->name = name;
+  task->function = function;
+  task->parameter = parameter;
+  task->stack.resize(TASK_STACK_SIZE);
+
+  getcontext(&task->context);
+  task->context.uc_stack.ss_sp = task->stack.data();
+  task->context.uc_stack.ss_size = task->stack.size();
+  task->context.uc_link = NULL;
+  uintptr_t address = (uintptr_t)task;
+  makecontext(&task->context, (void (*)())taskEntry, 2,
+              (unsigned int)(address >> 32), (unsigned int)address);
+
+  at(now(), [task]() { resumeTask(task); });
+}
+
+void sleepTask(uint64_t micros) {
+  if (currentTask == NULL) {
+    spend(micros);
+    return;
+  }
+
+  Task *task = currentTask;
+  at(now() + micros, [task]() { resumeTask(task); });
+  swapcontext(&task->context, &schedulerContext);
+}
+
+bool inTask() {
+  return currentTask != NULL;
+}
+
+void seedRandom(uint64_t seed) {
+  randomState = seed ^ 0x9E3779B97F4A7C15ULL;
+  if (randomState == 0) {
+    randomState = 1;
+  }
+}
+
+// xorshift64*
+uint32_t random32() {
+  randomState ^= randomState >> 12;
+  randomState ^= randomState << 25;
+  randomState ^= randomState >> 27;
+  return (uint32_t)((randomState * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+double randomUnit() {
+  return random32() / 4294967296.0;
+}
+
+double randomGaussian() {
+  double u = randomUnit();
+  double v = randomUnit();
+  return sqrt(-2.0 * log(u + 1e-12)) * cos(2 * M_PI * v);
+}
+
+}  // namespace sim
@@ -0,0 +1,43 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <stdint.h>
+#include <functional>
+
+// Discrete-event clock of the host simulation. Everything runs on one host
+// thread in virtual time: the hub's loop() passes, the FreeRTOS tasks, the
+// nodes and the radio are events in one queue, so a run with the same seed
+// always gives the same result.
+//
+// Code does not take time by itself. Shims charge what an operation costs
+// on the device (I2C bytes, flash erases, HTTP round trips) with spend(),
+// and now() includes the time charged so far by the running event. A task
+// blocked in vTaskDelay() or a call that spends time lets the other events
+// in between run, as the second core and the Wi-Fi task would.
+
+namespace sim {
+
+uint64_t now();                   // µs since the hub powered up
+void spend(uint64_t micros);      // Charges processing time to the running event
+uint64_t charged();               // Time charged by the running event so far
+
+void at(uint64_t time, std::function<void()> action);
+inline void after(uint64_t delay, std::function<void()> action) {
+  at(now() + delay, action);
+}
+void runUntil(uint64_t end);
+
+// FreeRTOS tasks run cooperatively, each on its own host stack
+void startTask(void (*function)(void *), void *parameter, const char *name);
+void sleepTask(uint64_t micros);  // Resumes after the charged time plus micros
+bool inTask();
+
+// Deterministic random numbers for the radio, the plants and esp_random()
+void seedRandom(uint64_t seed);
+uint32_t random32();
+double randomUnit();      // [0, 1)
+double randomGaussian();  // Mean 0, standard deviation 1
+
+}  // namespace sim
+
+#endif
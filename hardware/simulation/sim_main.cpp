@@ -0,0 +1,654 @@
+#include <Arduino.h>
+#include <greenhouse_protocol.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "globals.h"
+#include "metrics.h"
+#include "node_registry.h"
+#include "hub_env.h"
+#include "sim_clock.h"
+#include "sim_nodes.h"
+#include "sim_radio.h"
+
+// Host simulation of the hub and its nodes, see ../SIMULATION.md.
+// Runs a scripted day of dashboard, local API and button commands against
+// the unchanged firmware, then reports latencies, traffic and wear; exits
+// non-zero if a command never reached its node.
+
+static_assert(SIM_MAX_NODES == MAX_GREENHOUSES, "Simulated node ids follow the hub's limit");
+
+void setup();
+void loop();
+
+#define LOOP_IDLE_GAP 40          // µs between loop() passes, the idle task and the watchdog feed
+#define LOOP_MIN_PERIOD 1000      // µs; a pass takes a few µs, so passes are batched to this rate
+#define LOOP_HISTOGRAM_BINS 100000  // 1 µs bins up to 100 ms
+#define PROBE_TIMEOUT 600000000ULL  // µs until an undelivered command counts as lost
+#define BOOT_WALL_CLOCK 1759989600  // 2025-10-09 06:00 UTC, the run starts at dawn
+#define BUTTON_HOLD_TIME 180000     // µs from press to release
+#define SCENARIO_TAIL 15            // Minutes at the end without new commands, so they can complete
+
+// ----- OPTIONS -----
+struct Options {
+  int nodes = 6;
+  double hours = 24;
+  double loss = 0.05;
+  uint64_t seed = 1;
+  double outageStartMinutes = -1;  // Access point outage, none if negative
+  double outageMinutes = 0;
+  int routerChannel = 6;
+  bool verbose = false;
+  bool metrics = false;
+};
+
+static Options options;
+
+static void usage() {
+  fprintf(stderr,
+          "usage: greenhouse_sim [--nodes 1-%d] [--hours H] [--loss P] [--seed N]\n"
+          "                      [--outage-start-min M --outage-min M] [--router-channel 1-13]\n"
+          "                      [--verbose] [--metrics]\n",
+          SIM_MAX_NODES);
+}
+
+static bool parseOptions(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    const char *name = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (strcmp(name, "--verbose") == 0) {
+      options.verbose = true;
+    } else if (strcmp(name, "--metrics") == 0) {
+      options.metrics = true;
+    } else if (!hasValue) {
+      usage();
+      return false;
+    } else if (strcmp(name, "--nodes") == 0) {
+      options.nodes = atoi(argv[++i]);
+    } else if (strcmp(name, "--hours") == 0) {
+      options.hours = atof(argv[++i]);
+    } else if (strcmp(name, "--loss") == 0) {
+      options.loss = atof(argv[++i]);
+    } else if (strcmp(name, "--seed") == 0) {
+      options.seed = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(name, "--outage-start-min") == 0) {
+      options.outageStartMinutes = atof(argv[++i]);
+    } else if (strcmp(name, "--outage-min") == 0) {
+      options.outageMinutes = atof(argv[++i]);
+    } else if (strcmp(name, "--router-channel") == 0) {
+      options.routerChannel = atoi(argv[++i]);
+    } else {
+      usage();
+      return false;
+    }
+  }
+
+  // The hub's node bitmasks are 32 bits wide and ESP-NOW keeps at most 20
+  // peers, so MAX_GREENHOUSES is the fleet size the firmware supports
+  if (options.nodes > SIM_MAX_NODES) {
+    fprintf(stderr, "--nodes %d: the hub supports at most MAX_GREENHOUSES = %d nodes\n",
+            options.nodes, MAX_GREENHOUSES);
+    return false;
+  }
+  if (options.nodes < 1 || options.hours <= 0 || options.loss < 0 || options.loss >= 1 ||
+      options.routerChannel < 1 || options.routerChannel > 13) {
+    usage();
+    return false;
+  }
+  return true;
+}
+
+static uint64_t minutes(double value) {
+  return (uint64_t)(value * 60e6);
+}
+
+static bool inOutage(uint64_t time) {
+  if (options.outageStartMinutes < 0) {
+    return false;
+  }
+  // Commands sent right after the outage wait for the reconnect; keep them out
+  uint64_t start = minutes(options.outageStartMinutes);
+  return time + minutes(1) >= start && time < start + minutes(options.outageMinutes) + minutes(3);
+}
+
+// ----- HUB -----
+static std::vector<uint64_t> loopHistogram(LOOP_HISTOGRAM_BINS + 1);
+static uint64_t loopPasses = 0;
+static double loopSum = 0;
+static double loopSquares = 0;
+static uint64_t loopMax = 0;
+
+// Arduino's loopTask: setup() once, then loop() as fast as it returns
+static void hubTask(void *parameter) {
+  (void)parameter;
+  setup();
+  for (;;) {
+    uint64_t start = sim::now();
+    loop();
+    uint64_t pass = sim::now() - start;
+
+    loopHistogram[std::min(pass, (uint64_t)LOOP_HISTOGRAM_BINS)]++;
+    loopPasses++;
+    loopSum += pass;
+    loopSquares += (double)pass * pass;
+    loopMax = std::max(loopMax, pass);
+
+    sim::sleepTask(pass + LOOP_IDLE_GAP >= LOOP_MIN_PERIOD ? LOOP_IDLE_GAP : LOOP_MIN_PERIOD - pass);
+  }
+}
+
+static uint64_t loopPercentile(double fraction) {
+  uint64_t target = (uint64_t)ceil(loopPasses * fraction);
+  uint64_t seen = 0;
+  for (size_t bin = 0; bin < loopHistogram.size(); bin++) {
+    seen += loopHistogram[bin];
+    if (seen >= target && seen > 0) {
+      return bin;
+    }
+  }
+  return loopMax;
+}
+
+// ----- PROBES -----
+// A probe waits for the effect of one scripted command at one node
+enum ProbeKind {
+  PROBE_COMMAND,    // ControlFrame with manual command (and vent target)
+  PROBE_GROUP,      // GroupFrame addressing the node, or the ControlFrame sent instead
+  PROBE_THRESHOLD,  // Node applied the threshold from a ControlFrame
+  PROBE_MODE        // Node switched to the automatic mode value
+};
+
+enum ProbeClass {
+  CLASS_CLOUD_MANUAL,
+  CLASS_CLOUD_POSITION,
+  CLASS_CLOUD_THRESHOLD,
+  CLASS_CLOUD_MODE,
+  CLASS_LOCAL_MANUAL,
+  CLASS_BUTTON_GROUP,
+  CLASS_BUTTON_AUTO,
+  CLASS_OFFLINE_EDIT,
+  CLASS_COUNT
+};
+
+static const char *classNames[CLASS_COUNT] = {
+  "dashboard open/close", "dashboard vent target", "dashboard threshold", "dashboard mode",
+  "local API open/close", "button Open All", "button Auto Mode All",
+  "dashboard edit, offline"
+};
+
+struct Probe {
+  ProbeClass probeClass;
+  ProbeKind kind;
+  uint8_t nodeId;
+  char command;
+  uint8_t flags;
+  int ventTarget;
+  float value;
+  uint64_t start;
+  uint64_t done;
+  bool delivered;
+};
+
+static std::vector<Probe> probes;
+
+static void addProbe(ProbeClass probeClass, ProbeKind kind, uint8_t nodeId, char command, float value) {
+  Probe probe = {};
+  probe.probeClass = probeClass;
+  probe.kind = kind;
+  probe.nodeId = nodeId;
+  probe.command = command;
+  probe.ventTarget = command == 'P' ? (int)value : 0;
+  probe.flags = kind == PROBE_GROUP && command == 0 ? GROUP_FLAG_AUTO_MODE : 0;
+  probe.value = value;
+  probe.start = sim::now();
+  probes.push_back(probe);
+}
+
+static bool probeMatches(const Probe &probe, uint8_t type, const uint8_t *data, int len) {
+  if (probe.kind == PROBE_GROUP && type == FRAME_GROUP) {
+    GroupFrame frame;
+    readFrame(&frame, sizeof(frame), data, len);
+    return (frame.targetMask & (1UL << probe.nodeId)) != 0 && frame.manualCommand == probe.command &&
+           (frame.flags & probe.flags) == probe.flags;
+  }
+
+  if (type != FRAME_CONTROL) {
+    return false;
+  }
+  ControlFrame frame;
+  readFrame(&frame, sizeof(frame), data, len);
+  if (frame.header.nodeId != probe.nodeId) {
+    return false;
+  }
+  bool autoMode = (frame.flags & CONTROL_FLAG_AUTO_MODE) != 0;
+  switch (probe.kind) {
+    case PROBE_GROUP:
+      // Unicast fallback, when the peer table has no room for the broadcast peer
+      return probe.command != 0 ? frame.manualCommand == probe.command : autoMode;
+    case PROBE_COMMAND:
+      return frame.manualCommand == probe.command &&
+             (probe.command != 'P' || frame.ventTarget == probe.ventTarget);
+    case PROBE_THRESHOLD:
+      return fabs(fromFixed(frame.tempThreshold, CENTI_SCALE) - probe.value) < 0.01;
+    case PROBE_MODE:
+      return autoMode == (probe.value != 0);
+    default:
+      return false;
+  }
+}
+
+static void onDelivery(sim::RadioEndpoint *receiver, const uint8_t *data, int len) {
+  if (receiver->isHub) {
+    return;
+  }
+  sim::SimNodeBase *node = static_cast<sim::SimNodeBase *>(receiver);
+  uint8_t type = parseFrameType(data, len);
+  for (Probe &probe : probes) {
+    if (!probe.delivered && probe.nodeId == node->id && sim::now() - probe.start <= PROBE_TIMEOUT &&
+        probeMatches(probe, type, data, len)) {
+      probe.delivered = true;
+      probe.done = sim::now();
+    }
+  }
+}
+
+// ----- SCENARIO -----
+static bool nodeOnline(uint8_t nodeId) {
+  return greenhouses[nodeId].isOnline && millis() - greenhouses[nodeId].lastSeen <= 300000;
+}
+
+static void cloudManual(uint8_t nodeId, const char *action) {
+  char path[48];
+  char json[16];
+  snprintf(path, sizeof(path), "/%u/settings/manualControl", nodeId);
+  snprintf(json, sizeof(json), "\"%s\"", action);
+  addProbe(CLASS_CLOUD_MANUAL, PROBE_COMMAND, nodeId, manualCommandFor(action), 0);
+  sim::cloudWrite(path, json);
+}
+
+static void cloudVentTarget(uint8_t nodeId, int target) {
+  char path[48];
+  char json[8];
+  snprintf(path, sizeof(path), "/%u/settings/ventTarget", nodeId);
+  snprintf(json, sizeof(json), "%d", target);
+  addProbe(CLASS_CLOUD_POSITION, PROBE_COMMAND, nodeId, 'P', target);
+  sim::cloudWrite(path, json);
+}
+
+static void cloudThreshold(uint8_t nodeId, float threshold) {
+  char path[56];
+  char json[16];
+  snprintf(path, sizeof(path), "/%u/settings/temperatureThreshold", nodeId);
+  snprintf(json, sizeof(json), "%.1f", threshold);
+  addProbe(CLASS_CLOUD_THRESHOLD, PROBE_THRESHOLD, nodeId, 0, threshold);
+  sim::cloudWrite(path, json);
+}
+
+// Every greenhouse edited while the hub is offline. The stream's snapshot
+// after the reconnect carries all of it at once, more than cloudCommandQueue
+// holds.
+static void cloudEditAll() {
+  for (uint8_t id = 1; id <= sim::nodeCount(); id++) {
+    const GreenhouseSettings &settings = greenhouses[id].settings;
+    char path[56];
+    char json[16];
+    snprintf(path, sizeof(path), "/%u/settings/hysteresis", id);
+    snprintf(json, sizeof(json), "%.1f", settings.hysteresis == 2.0f ? 1.5 : 2.0);
+    sim::cloudWrite(path, json);
+
+    float threshold = settings.temperatureThreshold + 0.5f;
+    snprintf(path, sizeof(path), "/%u/settings/temperatureThreshold", id);
+    snprintf(json, sizeof(json), "%.1f", threshold);
+    addProbe(CLASS_OFFLINE_EDIT, PROBE_THRESHOLD, id, 0, threshold);
+    sim::cloudWrite(path, json);
+  }
+}
+
+// The dashboard writes the settings object, as its settings form does
+static void cloudSettingsForm(uint8_t nodeId, bool autoMode) {
+  char path[32];
+  char json[192];
+  snprintf(path, sizeof(path), "/%u/settings", nodeId);
+  snprintf(json, sizeof(json),
+           "{\"mode\":\"%s\",\"scheduleOpenHour\":8,\"scheduleOpenMinute\":30,"
+           "\"scheduleCloseHour\":19,\"scheduleCloseMinute\":0,\"scheduleEnabled\":true}",
+           autoMode ? "auto" : "manual");
+  addProbe(CLASS_CLOUD_MODE, PROBE_MODE, nodeId, 0, autoMode);
+  sim::cloudWrite(path, json);
+}
+
+static int localCommands = 0;
+static int localFailures = 0;
+static bool unauthorizedRejected = false;
+static bool webSocketAccepted = false;
+
+static void localManual(uint8_t nodeId, const char *action) {
+  char url[48];
+  snprintf(url, sizeof(url), "/api/greenhouses/%u/command", nodeId);
+  sim::LocalParams params;
+  params.push_back(std::make_pair(std::string("action"), std::string(action)));
+  sim::LocalResponse response = sim::localRequest(true, url, LOCAL_API_TOKEN, params);
+  localCommands++;
+  if (response.code / 100 == 2) {
+    addProbe(CLASS_LOCAL_MANUAL, PROBE_COMMAND, nodeId, manualCommandFor(action), 0);
+  } else {
+    localFailures++;
+    if (options.verbose) {
+      printf("local command to %u: %d %s\n", nodeId, response.code, response.body.c_str());
+    }
+  }
+}
+
+static void checkLocalAuth() {
+  sim::LocalParams params;
+  params.push_back(std::make_pair(std::string("action"), std::string("open")));
+  sim::LocalResponse response = sim::localRequest(true, "/api/greenhouses/1/command", "wrong-token", params);
+  unauthorizedRejected = response.code == 401;
+  webSocketAccepted = sim::localConnectWebSocket(LOCAL_API_TOKEN);
+}
+
+// A press with contact bounce on both edges; the buttons are active low
+static void pressButton(uint64_t time, uint8_t pin) {
+  static const uint64_t bounce[] = {0, 300, 700, 1500};
+  for (int i = 0; i < 4; i++) {
+    sim::at(time + bounce[i], [pin, i]() { sim::setPin(pin, i % 2 == 0 ? LOW : HIGH); });
+  }
+  sim::at(time + 1600, [pin]() { sim::setPin(pin, LOW); });
+  uint64_t release = time + BUTTON_HOLD_TIME;
+  for (int i = 0; i < 4; i++) {
+    sim::at(release + bounce[i], [pin, i]() { sim::setPin(pin, i % 2 == 0 ? HIGH : LOW); });
+  }
+  sim::at(release + 1600, [pin]() { sim::setPin(pin, HIGH); });
+}
+
+static void probeOnlineNodes(ProbeClass probeClass, char command) {
+  for (uint8_t id = 1; id <= sim::nodeCount(); id++) {
+    if (nodeOnline(id)) {
+      addProbe(probeClass, PROBE_GROUP, id, command, 0);
+    }
+  }
+}
+
+// SELECT three times reaches "Control All"; DOWN picks the entry
+static void controlAllFromButtons(uint64_t time, int downPresses, ProbeClass probeClass, char command) {
+  if (inOutage(time)) {
+    return;
+  }
+  const uint64_t gap = 600000;
+  uint64_t pressAt = time;
+  for (int i = 0; i < 3; i++, pressAt += gap) {
+    pressButton(pressAt, BUTTON_SELECT_PIN);
+  }
+  for (int i = 0; i < downPresses; i++, pressAt += gap) {
+    pressButton(pressAt, BUTTON_DOWN_PIN);
+  }
+  pressButton(pressAt, BUTTON_SELECT_PIN);
+  // The command goes out once SELECT is released; latency counts from the release
+  sim::at(pressAt + BUTTON_HOLD_TIME, [probeClass, command]() { probeOnlineNodes(probeClass, command); });
+}
+
+static void scheduleScenario(uint64_t runEnd) {
+  int count = sim::nodeCount();
+  uint64_t end = runEnd > minutes(SCENARIO_TAIL) ? runEnd - minutes(SCENARIO_TAIL) : 0;
+
+  // Dashboard open/close, a different node every half hour
+  int step = 0;
+  for (uint64_t time = minutes(20); time < end; time += minutes(30), step++) {
+    if (inOutage(time)) {
+      continue;
+    }
+    uint8_t nodeId = 1 + step % count;
+    const char *action = step % 2 == 0 ? "open" : "close";
+    sim::at(time, [nodeId, action]() { cloudManual(nodeId, action); });
+  }
+
+  // Local API commands, only to nodes the hub lists online
+  step = 0;
+  for (uint64_t time = minutes(35); time < end; time += minutes(45), step++) {
+    if (inOutage(time)) {
+      continue;
+    }
+    uint8_t nodeId = 1 + (step * 3) % count;
+    const char *action = step % 2 == 0 ? "close" : "open";
+    sim::at(time, [nodeId, action]() {
+      if (nodeOnline(nodeId)) {
+        localManual(nodeId, action);
+      }
+    });
+  }
+
+  // Thresholds, a vent target and the settings form, once each hour
+  step = 0;
+  for (uint64_t time = minutes(50); time < end; time += minutes(60), step++) {
+    if (inOutage(time)) {
+      continue;
+    }
+    uint8_t nodeId = 1 + (step * 7) % count;
+    float threshold = 24 + step % 5;
+    sim::at(time, [nodeId, threshold]() {
+      // Setting the current value changes nothing, so nothing is sent
+      bool same = greenhouses[nodeId].settings.temperatureThreshold == threshold;
+      cloudThreshold(nodeId, same ? threshold + 0.5f : threshold);
+    });
+    if (time + minutes(5) < end) {
+      sim::at(time + minutes(5), [nodeId]() { cloudVentTarget(nodeId, 40); });
+    }
+    uint8_t formNode = count >= 3 ? 3 : 1;
+    if (time + minutes(10) < end) {
+      // Toggles the mode, the buttons may have changed it in between
+      sim::at(time + minutes(10), [formNode]() {
+        cloudSettingsForm(formNode, !greenhouses[formNode].settings.autoMode);
+      });
+    }
+  }
+
+  sim::at(minutes(12), checkLocalAuth);
+
+  controlAllFromButtons(minutes(15), 0, CLASS_BUTTON_GROUP, 'O');
+  controlAllFromButtons(std::min(end * 2 / 3, minutes(170)), 2, CLASS_BUTTON_AUTO, 0);
+
+  if (options.outageStartMinutes >= 0) {
+    sim::at(minutes(options.outageStartMinutes), []() { sim::wifiSetAccessPoint(false); });
+    sim::at(minutes(options.outageStartMinutes + options.outageMinutes), []() { sim::wifiSetAccessPoint(true); });
+    if (options.outageMinutes >= 2) {
+      sim::at(minutes(options.outageStartMinutes + options.outageMinutes - 1), cloudEditAll);
+    }
+  }
+
+  // A power cut at one node; it must pair again and pick up its settings
+  if (count >= 2) {
+    sim::at(runEnd / 2, []() { sim::rebootNode(2); });
+  }
+}
+
+// ----- REPORT -----
+static double percentile(std::vector<double> values, double fraction) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  size_t index = (size_t)ceil(values.size() * fraction);
+  return values[index == 0 ? 0 : index - 1];
+}
+
+static int reportLatencies() {
+  int lost = 0;
+  printf("\nCommand latency to the node, ms\n");
+  printf("  %-24s %6s %6s %9s %9s %9s %9s\n", "command", "sent", "rcvd", "mean", "p50", "p95", "max");
+  for (int c = 0; c < CLASS_COUNT; c++) {
+    std::vector<double> latencies;
+    int sent = 0;
+    double sum = 0;
+    for (const Probe &probe : probes) {
+      if (probe.probeClass != c) {
+        continue;
+      }
+      sent++;
+      if (probe.delivered) {
+        double latency = (probe.done - probe.start) / 1000.0;
+        latencies.push_back(latency);
+        sum += latency;
+        if (options.verbose && latency > 10000) {
+          printf("  slow: %s to node %u at %.1f min, %.1f s\n", classNames[c], probe.nodeId,
+                 probe.start / 60e6, latency / 1000);
+        }
+      } else {
+        lost++;
+        if (options.verbose) {
+          printf("  lost: %s to node %u at %.1f min\n", classNames[c], probe.nodeId, probe.start / 60e6);
+        }
+      }
+    }
+    if (sent == 0) {
+      continue;
+    }
+    printf("  %-24s %6d %6zu %9.1f %9.1f %9.1f %9.1f\n", classNames[c], sent, latencies.size(),
+           latencies.empty() ? 0 : sum / latencies.size(), percentile(latencies, 0.5),
+           percentile(latencies, 0.95), percentile(latencies, 1.0));
+  }
+  return lost;
+}
+
+static void reportRadio(double seconds) {
+  static const char *frameNames[8] = {"", "sensor", "control", "ack", "group", "schedule", "beacon", "discover"};
+  const sim::RadioStats &radio = sim::radioStats();
+  uint64_t total = 0;
+  printf("\nESP-NOW frames (each esp_now_send() once)\n");
+  printf("  %-10s %10s %10s %10s\n", "type", "sent", "per s", "delivered");
+  for (int type = 1; type < 8; type++) {
+    total += radio.framesSent[type];
+    printf("  %-10s %10llu %10.3f %10llu\n", frameNames[type], (unsigned long long)radio.framesSent[type],
+           radio.framesSent[type] / seconds, (unsigned long long)radio.framesDelivered[type]);
+  }
+  printf("  %-10s %10llu %10.3f\n", "all", (unsigned long long)total, total / seconds);
+  printf("  peak %llu frames/s, %llu attempts, %llu unicast failures, airtime %.3f%%\n",
+         (unsigned long long)radio.peakFramesPerSecond, (unsigned long long)radio.attempts,
+         (unsigned long long)radio.unicastFailures, radio.airtime / (seconds * 1e6) * 100);
+}
+
+static void reportCloud(double hours) {
+  static const char *endpointNames[sim::CLOUD_ENDPOINTS] = {"greenhouses", "history", "log", "system", "stream"};
+  const sim::CloudStats &cloud = sim::cloudStats();
+  printf("\nFirebase traffic per hour\n");
+  printf("  %-12s %10s %10s %12s %12s\n", "endpoint", "requests", "failed", "payload B", "wire B");
+  uint64_t payload = 0;
+  uint64_t wire = 0;
+  for (int e = 0; e < sim::CLOUD_ENDPOINTS; e++) {
+    payload += cloud.payloadBytes[e];
+    wire += cloud.wireBytes[e];
+    printf("  %-12s %10.1f %10.1f %12.0f %12.0f\n", endpointNames[e], cloud.requests[e] / hours,
+           cloud.failures[e] / hours, cloud.payloadBytes[e] / hours, cloud.wireBytes[e] / hours);
+  }
+  printf("  %-12s %10s %10s %12.0f %12.0f\n", "all", "", "", payload / hours, wire / hours);
+  printf("  log records stored: %llu; local WebSocket: %.0f B/h\n", (unsigned long long)cloud.logRecords,
+         sim::localWebSocketBytes() / hours);
+}
+
+static void reportNodes(double days) {
+  printf("\nNodes\n");
+  printf("  %-4s %-8s %6s %9s %9s %9s %8s %8s %9s %8s\n", "id", "weather", "loss", "cycles/d", "starts/d",
+         "run s/d", "min C", "max C", "hot min", "commits");
+  for (uint8_t id = 1; id <= sim::nodeCount(); id++) {
+    sim::SimNodeBase *node = sim::node(id);
+    sim::NodeView view = node->view();
+    printf("  %-4u %-8s %6.3f %9.1f %9.1f %9.0f %8.1f %8.1f %9.1f %8llu\n", id, sim::weatherName(node->weather),
+           node->baseLoss, view.motorCycles / days, node->stats.relayStarts / days,
+           node->stats.motorMillis / 1000.0 / days, node->stats.minTemperature, node->stats.maxTemperature,
+           node->stats.overheatSeconds / 60, (unsigned long long)node->stats.eepromCommits);
+  }
+}
+
+static void reportLoop() {
+  double mean = loopPasses > 0 ? loopSum / loopPasses : 0;
+  double variance = loopPasses > 0 ? loopSquares / loopPasses - mean * mean : 0;
+  printf("\nHub loop() pass, µs (charged device time)\n");
+  printf("  passes %llu, mean %.1f, sd %.1f, p50 %llu, p99 %llu, p99.9 %llu, max %llu\n",
+         (unsigned long long)loopPasses, mean, sqrt(variance > 0 ? variance : 0),
+         (unsigned long long)loopPercentile(0.5), (unsigned long long)loopPercentile(0.99),
+         (unsigned long long)loopPercentile(0.999), (unsigned long long)loopMax);
+
+  const sim::IoStats &io = sim::ioStats();
+  printf("\nHub I/O\n");
+  printf("  I2C %llu bytes, %.1f s on the bus; settings flash %llu writes, %llu sector erases; "
+         "LittleFS %llu bytes written\n",
+         (unsigned long long)io.i2cBytes, io.i2cTime / 1e6, (unsigned long long)io.flashWrites,
+         (unsigned long long)io.flashErases, (unsigned long long)io.fsBytesWritten);
+  printf("  log lines: E %llu, W %llu, I %llu, D %llu, other %llu\n", (unsigned long long)io.logLines[1],
+         (unsigned long long)io.logLines[2], (unsigned long long)io.logLines[3],
+         (unsigned long long)io.logLines[4], (unsigned long long)io.logLines[0]);
+}
+
+// Conditions every run must meet, whatever the loss
+static int checkRun(int lostProbes) {
+  int failures = 0;
+  auto expect = [&failures](bool condition, const char *what) {
+    if (!condition) {
+      printf("FAILED: %s\n", what);
+      failures++;
+    }
+  };
+
+  expect(activeNodeCount == sim::nodeCount(), "every node registered at the hub");
+  expect(lostProbes == 0, "every command reached its node");
+  expect(localFailures == 0, "local API commands accepted");
+  expect(unauthorizedRejected, "local API rejects a wrong token");
+  expect(webSocketAccepted, "WebSocket accepts the token");
+  for (uint8_t id = 1; id <= sim::nodeCount(); id++) {
+    char path[40];
+    snprintf(path, sizeof(path), "/greenhouses/%u/currentData", id);
+    if (!sim::cloudHas(path)) {
+      printf("FAILED: node %u has no currentData in Firebase\n", id);
+      failures++;
+    }
+  }
+  expect(sim::cloudStats().requests[sim::CLOUD_HISTORY] > 0, "history pushed to Firebase");
+  expect(sim::cloudStats().logRecords > 0, "log records pushed to Firebase");
+  return failures;
+}
+
+int main(int argc, char **argv) {
+  if (!parseOptions(argc, argv)) {
+    return 2;
+  }
+
+  sim::seedRandom(options.seed);
+  sim::serialEcho(options.verbose);
+  sim::wifiConfigure(options.routerChannel, BOOT_WALL_CLOCK);
+  sim::radioOnDelivery(onDelivery);
+  sim::createNodes(options.nodes, options.loss);
+  sim::startTask(hubTask, NULL, "loopTask");
+
+  uint64_t end = (uint64_t)(options.hours * 3600e6);
+  scheduleScenario(end);
+  sim::runUntil(end);
+
+  double seconds = end / 1e6;
+  printf("greenhouse_sim: %d nodes, %.1f h, loss %.3f, seed %llu", options.nodes, options.hours, options.loss,
+         (unsigned long long)options.seed);
+  if (options.outageStartMinutes >= 0) {
+    printf(", access point down at %.0f min for %.0f min", options.outageStartMinutes, options.outageMinutes);
+  }
+  printf("\n");
+
+  int lost = reportLatencies();
+  reportRadio(seconds);
+  reportCloud(seconds / 3600);
+  reportNodes(seconds / 86400);
+  reportLoop();
+
+  if (options.metrics) {
+    static char metrics[METRICS_JSON_MAX];
+    if (formatMetricsJson(metrics, sizeof(metrics)) > 0) {
+      printf("\nHub metrics\n%s\n", metrics);
+    }
+  }
+
+  int failures = checkRun(lost);
+  printf("\n%s\n", failures == 0 ? "PASSED" : "FAILED");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,348 @@
+#include "sim_nodes.h"
+#include "hub_env.h"
+#include "sim_clock.h"
+#include <math.h>
+#include <string.h>
+#include <new>
+#include <utility>
+
+// The nodes share the host process with the hub, and with it the log ring,
+// so their modules are compiled out the way a sketch would silence them
+#define LOG_NODE_LEVEL LOG_LEVEL_NONE
+#define LOG_SENSOR_LEVEL LOG_LEVEL_NONE
+#define LOG_VENT_LEVEL LOG_LEVEL_NONE
+#define LOG_LINK_LEVEL LOG_LEVEL_NONE
+
+#include <node_core.h>
+
+#define NODE_LOOP_PERIOD 100000  // µs, the delay(100) of the node sketches
+#define NODE_BOOT_SPREAD 8000000 // Nodes power up within the first 8 s
+#define SENSOR_SPIKE_CHANCE 0.002
+
+namespace sim {
+
+static SimNodeBase *nodes[SIM_MAX_NODES + 1];
+static int createdNodes = 0;
+
+// ----- WEATHER -----
+struct WeatherProfile {
+  const char *name;
+  double meanTemperature;  // Outside, daily mean, °C
+  double dailySwing;       // Half the day-night difference
+  double solarGain;        // Inside minus outside at noon, vent closed, clear sky
+};
+
+static const WeatherProfile profiles[] = {
+  {"sunny", 18, 6, 18},
+  {"cloudy", 13, 3, 14},
+  {"heatwave", 29, 7, 20},
+};
+
+const char *weatherName(Weather weather) {
+  return profiles[weather].name;
+}
+
+static double hourOfDay() {
+  time_t now = wallClock();
+  struct tm local;
+  localtime_r(&now, &local);
+  return local.tm_hour + local.tm_min / 60.0 + local.tm_sec / 3600.0;
+}
+
+double outsideTemperature(Weather weather) {
+  const WeatherProfile &profile = profiles[weather];
+  return profile.meanTemperature + profile.dailySwing * cos(2 * M_PI * (hourOfDay() - 15) / 24);
+}
+
+static double sunshine() {
+  double hour = hourOfDay();
+  return hour > 6 && hour < 20 ? sin(M_PI * (hour - 6) / 14) : 0;
+}
+
+// ----- PLANT -----
+void SimNodeBase::setupPlant(uint8_t nodeId, double loss) {
+  id = nodeId;
+  weather = (Weather)(nodeId % 3);
+  baseLoss = loss * (0.5 + (nodeId % 5) / 4.0);  // 0.5 to 1.5 times the given loss
+  mac[0] = 0x30;
+  mac[1] = 0xAE;
+  mac[2] = 0xA4;
+  mac[3] = 0x10;
+  mac[4] = 0x00;
+  mac[5] = nodeId;
+
+  temperatureOffset = (randomUnit() - 0.5) * 3;
+  limitSwitches = nodeId % 2 == 0;
+  motorSpeed = 100.0 / 30000 * (1 + (randomUnit() - 0.5) * 0.06);
+  cloudFactor = 1;
+  temperature = outsideTemperature(weather) + temperatureOffset;
+  plantUpdatedAt = now();
+  stats.minTemperature = temperature;
+  stats.maxTemperature = temperature;
+  memset(eeprom, 0xFF, sizeof(eeprom));  // Never written
+  channel = 1;
+  nextFadeChange = now() + (uint64_t)(-log(1 - randomUnit()) * FADE_GOOD_MEAN * 1e6);
+}
+
+// Exact for a constant equilibrium over the step; called at most every few seconds
+void SimNodeBase::updatePlant() {
+  uint64_t current = now();
+  double seconds = (current - plantUpdatedAt) / 1e6;
+  if (seconds <= 0) {
+    return;
+  }
+
+  if (motorDirection != 0) {
+    ventPosition += motorDirection * motorSpeed * seconds * 1000;
+    ventPosition = ventPosition < 0 ? 0 : (ventPosition > 100 ? 100 : ventPosition);
+  }
+
+  if (weather == WEATHER_CLOUDY) {
+    cloudFactor += randomGaussian() * 0.05 * sqrt(seconds / 60);
+    cloudFactor = cloudFactor < 0.1 ? 0.1 : (cloudFactor > 1 ? 1 : cloudFactor);
+  }
+
+  double gain = profiles[weather].solarGain * sunshine() * cloudFactor;
+  double equilibrium = outsideTemperature(weather) + temperatureOffset +
+                       gain * (1 - PLANT_VENT_GAIN_CUT * ventPosition / 100);
+  temperature = equilibrium + (temperature - equilibrium) * exp(-seconds / PLANT_TIME_CONSTANT);
+
+  stats.minTemperature = fmin(stats.minTemperature, temperature);
+  stats.maxTemperature = fmax(stats.maxTemperature, temperature);
+  NodeView current_view = view();
+  if (temperature > current_view.threshold + 3) {
+    stats.overheatSeconds += seconds;
+  }
+  plantUpdatedAt = current;
+}
+
+void SimNodeBase::readSensor(float &t, float &h, float &p) {
+  updatePlant();
+  double measured = temperature + randomGaussian() * 0.05;
+  if (randomUnit() < SENSOR_SPIKE_CHANCE) {
+    measured += randomUnit() < 0.5 ? -8 : 8;  // I2C glitch or a drop of water
+  }
+  double humidity = 75 - 1.8 * (temperature - 20) + randomGaussian() * 0.5;
+  t = (float)measured;
+  h = (float)(humidity < 15 ? 15 : (humidity > 99 ? 99 : humidity));
+  p = (float)(1013 + 4 * sin(2 * M_PI * now() / 86400e6 / 3) + randomGaussian() * 0.1);
+}
+
+void SimNodeBase::setRelays(int8_t direction) {
+  updatePlant();
+  if (motorDirection != 0) {
+    stats.motorMillis += (now() - motorStartedAt) / 1000;
+  }
+  if (direction != 0 && motorDirection == 0) {
+    stats.relayStarts++;
+  }
+  motorDirection = direction;
+  motorStartedAt = now();
+}
+
+bool SimNodeBase::endStopReached(int8_t direction) {
+  if (!limitSwitches || direction == 0) {
+    return false;
+  }
+  updatePlant();
+  return direction > 0 ? ventPosition >= 100 : ventPosition <= 0;
+}
+
+double SimNodeBase::linkLoss() {
+  while (now() >= nextFadeChange) {
+    fading = !fading;
+    double mean = fading ? FADE_BAD_MEAN : FADE_GOOD_MEAN;
+    nextFadeChange += (uint64_t)(-log(1 - randomUnit()) * mean * 1e6) + 1;
+  }
+  return fading ? FADE_LOSS : baseLoss;
+}
+
+// ----- NODECORE GLUE -----
+// Hardware for NodeCore, see node_hardware.h for the interface
+class SimHardware {
+public:
+  SimNodeBase *plant;
+
+  void begin() {}
+  bool initSensor() { return true; }
+  void readSensor(float &temperature, float &humidity, float &pressure) {
+    plant->readSensor(temperature, humidity, pressure);
+  }
+  void setRelays(int8_t direction) { plant->setRelays(direction); }
+  bool endStopReached(int8_t direction) { return plant->endStopReached(direction); }
+
+  template <typename T>
+  void loadSettings(T &settings) { memcpy(&settings, plant->eeprom, sizeof(T)); }
+  template <typename T>
+  void saveSettings(const T &settings) { store(0, settings); }
+  template <typename T>
+  void loadStats(T &stats) { memcpy(&stats, plant->eeprom + NODE_STATS_ADDRESS, sizeof(T)); }
+  template <typename T>
+  void saveStats(const T &stats) { store(NODE_STATS_ADDRESS, stats); }
+
+private:
+  template <typename T>
+  void store(int address, const T &value) {
+    memcpy(plant->eeprom + address, &value, sizeof(T));
+    plant->stats.eepromCommits++;
+  }
+};
+
+template <uint8_t Id>
+SimNodeBase *&nodeInstance() {
+  static SimNodeBase *instance;
+  return instance;
+}
+
+// Board traits of one simulated node; the static calls reach its instance
+template <uint8_t Id>
+struct SimBoard {
+  static constexpr uint8_t nodeId = Id;
+  static constexpr uint8_t relayOpenPin = 16;
+  static constexpr uint8_t relayClosePin = 17;
+  static constexpr uint8_t sdaPin = 21;
+  static constexpr uint8_t sclPin = 22;
+  static constexpr int8_t limitOpenPin = Id % 2 == 0 ? 34 : -1;
+  static constexpr int8_t limitClosedPin = Id % 2 == 0 ? 35 : -1;
+  static constexpr uint32_t motorTravelTime = 30000;
+  static constexpr uint32_t motorCooldownTime = 60000;
+  static constexpr uint32_t sensorReadInterval = 10000;
+  static constexpr uint32_t controlCheckInterval = 5000;
+  static constexpr uint32_t hubTimeout = 300000;
+  static constexpr bool predictiveControl = Id % 4 == 3;
+
+  static unsigned long now() {
+    return (unsigned long)((sim::now() - nodeInstance<Id>()->bootedAt) / 1000);
+  }
+
+  static bool send(const uint8_t *data, size_t len) {
+    SimNodeBase *node = nodeInstance<Id>();
+    if (!node->hubKnown) {
+      return false;
+    }
+    radioSend(node, node->hubMac, data, (int)len);
+    return true;
+  }
+
+  static bool broadcast(const uint8_t *data, size_t len) {
+    radioSend(nodeInstance<Id>(), broadcastAddress, data, (int)len);
+    return true;
+  }
+
+  static void setChannel(uint8_t channel) {
+    nodeInstance<Id>()->channel = channel;
+  }
+
+  static bool setHub(const uint8_t *mac, uint8_t channel) {
+    SimNodeBase *node = nodeInstance<Id>();
+    memcpy(node->hubMac, mac, 6);
+    node->hubKnown = true;
+    node->channel = channel;
+    return true;
+  }
+
+  static void indicate(uint8_t blinks) {
+    (void)blinks;
+  }
+};
+
+// No constructors, so new SimNode<Id>() zero-initializes everything as
+// static storage does on the device
+template <uint8_t Id>
+class SimNode : public SimNodeBase {
+public:
+  typedef NodeCore<SimBoard<Id>, SimHardware> Core;
+  Core core;
+
+  void boot() override {
+    core.~Core();
+    new (&core) Core();
+    core.hardware.plant = this;
+    hubKnown = false;
+    channel = 1;
+    bootedAt = now();
+    core.begin(false);
+  }
+
+  void step() override {
+    core.loop();
+  }
+
+  NodeView view() const override {
+    NodeView view;
+    view.threshold = core.state.settings.temperatureThreshold;
+    view.autoMode = core.state.settings.autoMode;
+    view.paired = core.state.paired;
+    view.channel = core.state.channel;
+    view.estimatedPosition = core.state.vent.position;
+    view.motorCycles = core.state.actuator.motorCycles;
+    view.motorSeconds = core.state.actuator.motorSeconds;
+    return view;
+  }
+
+  void coreReceive(const uint8_t *from, const uint8_t *data, int len) override {
+    core.onFrame(from, data, len);
+  }
+
+  void coreSendDone(const uint8_t *to, bool delivered) override {
+    core.onSendResult(to, delivered);
+  }
+};
+
+template <uint8_t Id>
+static SimNodeBase *newNode() {
+  SimNode<Id> *node = new SimNode<Id>();
+  nodeInstance<Id>() = node;
+  return node;
+}
+
+template <uint8_t... Offsets>
+static SimNodeBase *newNode(uint8_t id, std::integer_sequence<uint8_t, Offsets...>) {
+  SimNodeBase *node = NULL;
+  ((node = id == Offsets + 1 ? newNode<Offsets + 1>() : node), ...);
+  return node;
+}
+
+static void scheduleLoop(SimNodeBase *node, uint64_t bootedAt) {
+  at(now() + NODE_LOOP_PERIOD, [node, bootedAt]() {
+    if (node->bootedAt != bootedAt) {
+      return;  // Rebooted meanwhile, the new boot runs its own loop
+    }
+    node->step();
+    scheduleLoop(node, bootedAt);
+  });
+}
+
+static void powerUp(SimNodeBase *node) {
+  node->boot();
+  scheduleLoop(node, node->bootedAt);
+}
+
+void createNodes(int count, double loss) {
+  for (uint8_t id = 1; id <= count && id <= SIM_MAX_NODES; id++) {
+    SimNodeBase *node = newNode(id, std::make_integer_sequence<uint8_t, SIM_MAX_NODES>());
+    node->setupPlant(id, loss);
+    radioAttach(node);
+    nodes[id] = node;
+    createdNodes++;
+    after((uint64_t)(randomUnit() * NODE_BOOT_SPREAD), [node]() { powerUp(node); });
+  }
+}
+
+int nodeCount() {
+  return createdNodes;
+}
+
+SimNodeBase *node(uint8_t id) {
+  return id >= 1 && id <= SIM_MAX_NODES ? nodes[id] : NULL;
+}
+
+void rebootNode(uint8_t id) {
+  SimNodeBase *target = node(id);
+  if (target != NULL) {
+    target->setRelays(0);  // Power cut stops the motor
+    powerUp(target);
+  }
+}
+
+}  // namespace sim
@@ -0,0 +1,119 @@
+#ifndef SIM_NODES_H
+#define SIM_NODES_H
+
+#include <stdint.h>
+#include "sim_radio.h"
+
+// The simulated greenhouses. Each runs the unchanged NodeCore from
+// GreenhouseNodeCore as NodeCore<SimBoard<id>, SimHardware> (sim_nodes.cpp)
+// on a plant model:
+//
+// - Air temperature relaxes toward an equilibrium with a 20 minute time
+//   constant. The equilibrium is the outside temperature plus solar gain,
+//   and an open vent removes up to three quarters of the gain.
+// - Outside temperature and sun follow the time of day of the simulated
+//   wall clock, in one of three profiles chosen by node id: sunny, cloudy
+//   (the sun comes and goes) and heatwave.
+// - The BME280 readings add noise and, rarely, a spike; the sensor filter
+//   in NodeCore is expected to reject those.
+// - The vent motor moves the real vent at its own speed, a few percent off
+//   the nominal travel time, so the position estimate drifts as on a real
+//   vent. Even node ids have limit switches.
+//
+// Links lose frames at a per-node base rate with fades: now and then a
+// node's link turns bad for a few tens of seconds (two-state Gilbert-Elliott
+// model).
+
+#define SIM_MAX_NODES 20  // MAX_GREENHOUSES of the hub, see sim_main.cpp
+
+#define PLANT_TIME_CONSTANT 1200.0  // s
+#define PLANT_VENT_GAIN_CUT 0.75    // Share of the solar gain a fully open vent removes
+#define FADE_GOOD_MEAN 1800.0       // s between fades, on average
+#define FADE_BAD_MEAN 20.0          // s a fade lasts, on average
+#define FADE_LOSS 0.9               // Loss per attempt during a fade
+
+namespace sim {
+
+enum Weather {
+  WEATHER_SUNNY,
+  WEATHER_CLOUDY,
+  WEATHER_HEATWAVE
+};
+
+// What the scenario and the report read from a node's NodeCore
+struct NodeView {
+  float threshold;
+  bool autoMode;
+  bool paired;
+  uint8_t channel;
+  uint8_t estimatedPosition;
+  uint32_t motorCycles;   // As counted by NodeCore
+  uint32_t motorSeconds;
+};
+
+struct PlantStats {
+  uint64_t relayStarts;    // Motor starts seen at the relays
+  uint64_t motorMillis;    // Relay on time
+  uint64_t eepromCommits;
+  double minTemperature;
+  double maxTemperature;
+  double overheatSeconds;  // Above threshold + 3 °C
+};
+
+class SimNodeBase : public RadioEndpoint {
+public:
+  uint8_t id;
+  Weather weather;
+  double baseLoss;
+  PlantStats stats;
+
+  // ----- PLANT -----
+  double temperature;        // Air inside, °C
+  double ventPosition;       // Real opening, percent
+  int8_t motorDirection;
+  double motorSpeed;         // Percent per ms
+  bool limitSwitches;
+  double temperatureOffset;  // Site difference, °C
+  double cloudFactor;        // 0 overcast to 1 clear
+  uint64_t plantUpdatedAt;   // sim::now() of the last integration step
+  uint64_t motorStartedAt;
+  uint8_t eeprom[512];
+
+  // ----- RADIO -----
+  uint8_t channel;
+  uint8_t hubMac[6];
+  bool hubKnown;
+  bool fading;
+  uint64_t nextFadeChange;
+  uint64_t bootedAt;  // sim::now() of the last boot, the node's millis() count from it
+
+  virtual ~SimNodeBase() {}
+  virtual void boot() = 0;  // Starts NodeCore from scratch; the EEPROM is kept
+  virtual void step() = 0;  // One pass of the sketch loop
+  virtual NodeView view() const = 0;
+  virtual void coreReceive(const uint8_t *from, const uint8_t *data, int len) = 0;
+  virtual void coreSendDone(const uint8_t *to, bool delivered) = 0;
+
+  void setupPlant(uint8_t nodeId, double loss);
+  void updatePlant();
+  void readSensor(float &temperature, float &humidity, float &pressure);
+  void setRelays(int8_t direction);
+  bool endStopReached(int8_t direction);
+
+  uint8_t radioChannel() const override { return channel; }
+  double linkLoss() override;
+  void radioReceive(const uint8_t *from, const uint8_t *data, int len) override { coreReceive(from, data, len); }
+  void radioSendDone(const uint8_t *to, bool delivered) override { coreSendDone(to, delivered); }
+};
+
+void createNodes(int count, double loss);  // Ids 1 to count, booting over the first seconds
+int nodeCount();
+SimNodeBase *node(uint8_t id);             // NULL if not created
+void rebootNode(uint8_t id);               // Power cycle
+
+double outsideTemperature(Weather weather);  // Now, °C
+const char *weatherName(Weather weather);
+
+}  // namespace sim
+
+#endif
@@ -0,0 +1,141 @@
+#include "sim_radio.h"
+#include "sim_clock.h"
+#include <string.h>
+#include <memory>
+#include <vector>
+
+namespace sim {
+
+const uint8_t broadcastAddress[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+static std::vector<RadioEndpoint *> endpoints;
+static uint64_t channelBusyUntil[15];
+static RadioStats stats;
+static uint64_t statsSecond = 0;
+static uint64_t framesThisSecond = 0;
+static void (*deliveryHook)(RadioEndpoint *, const uint8_t *, int) = NULL;
+
+typedef std::shared_ptr<std::vector<uint8_t> > Payload;
+
+void radioAttach(RadioEndpoint *endpoint) {
+  endpoints.push_back(endpoint);
+}
+
+const RadioStats &radioStats() {
+  return stats;
+}
+
+void radioOnDelivery(void (*hook)(RadioEndpoint *, const uint8_t *, int)) {
+  deliveryHook = hook;
+}
+
+static uint64_t airtime(int len) {
+  return RADIO_PREAMBLE + (uint64_t)(len + RADIO_FRAME_OVERHEAD) * 8;
+}
+
+static double pathLoss(RadioEndpoint *a, RadioEndpoint *b) {
+  return 1.0 - (1.0 - a->linkLoss()) * (1.0 - b->linkLoss());
+}
+
+static bool hears(RadioEndpoint *receiver, uint8_t channel) {
+  return receiver->radioListening() && receiver->radioChannel() == channel;
+}
+
+static void deliver(RadioEndpoint *receiver, const uint8_t *from, const Payload &payload) {
+  const uint8_t *data = payload->data();
+  int len = (int)payload->size();
+  if (data[0] < 8) {
+    stats.framesDelivered[data[0]]++;
+  }
+  receiver->radioReceive(from, data, len);
+  if (deliveryHook != NULL) {
+    deliveryHook(receiver, data, len);
+  }
+}
+
+static void countFrame(uint64_t start) {
+  uint64_t second = start / 1000000;
+  if (second != statsSecond) {
+    statsSecond = second;
+    framesThisSecond = 0;
+  }
+  framesThisSecond++;
+  if (framesThisSecond > stats.peakFramesPerSecond) {
+    stats.peakFramesPerSecond = framesThisSecond;
+  }
+}
+
+void radioSend(RadioEndpoint *from, const uint8_t *to, const uint8_t *data, int len) {
+  if (len <= 0) {
+    return;
+  }
+  if (data[0] < 8) {
+    stats.framesSent[data[0]]++;
+  }
+
+  uint8_t channel = from->radioChannel();
+  uint64_t start = now() > channelBusyUntil[channel] ? now() : channelBusyUntil[channel];
+  uint64_t duration = airtime(len);
+  Payload payload = std::make_shared<std::vector<uint8_t> >(data, data + len);
+  std::shared_ptr<std::vector<uint8_t> > source = std::make_shared<std::vector<uint8_t> >(from->mac, from->mac + 6);
+  std::vector<uint8_t> target(to, to + 6);
+  countFrame(start);
+
+  if (memcmp(to, broadcastAddress, 6) == 0) {
+    stats.attempts++;
+    stats.airtime += duration;
+    channelBusyUntil[channel] = start + duration;
+    at(start + duration, [from, channel, payload, source]() {
+      for (RadioEndpoint *receiver : endpoints) {
+        if (receiver != from && hears(receiver, channel) && randomUnit() >= pathLoss(from, receiver)) {
+          deliver(receiver, source->data(), payload);
+        }
+      }
+      from->radioSendDone(broadcastAddress, true);
+    });
+    return;
+  }
+
+  RadioEndpoint *receiver = NULL;
+  for (RadioEndpoint *endpoint : endpoints) {
+    if (endpoint != from && memcmp(endpoint->mac, to, 6) == 0) {
+      receiver = endpoint;
+    }
+  }
+
+  // Attempts are decided up front against the receiver's channel now
+  uint64_t ackTime = airtime(14);
+  uint64_t time = start;
+  uint64_t deliveredAt = 0;
+  bool acknowledged = false;
+  for (int attempt = 0; attempt < RADIO_UNICAST_ATTEMPTS && !acknowledged; attempt++) {
+    if (attempt > 0) {
+      time += RADIO_RETRY_GAP;
+    }
+    stats.attempts++;
+    stats.airtime += duration;
+    time += duration;
+
+    double loss = receiver != NULL ? pathLoss(from, receiver) : 1.0;
+    bool received = receiver != NULL && hears(receiver, channel) && randomUnit() >= loss;
+    if (received && deliveredAt == 0) {
+      deliveredAt = time;
+    }
+    if (received && randomUnit() >= loss) {
+      acknowledged = true;
+      time += ackTime;
+      stats.airtime += ackTime;
+    }
+  }
+  channelBusyUntil[channel] = time;
+
+  if (deliveredAt != 0) {
+    at(deliveredAt, [receiver, payload, source]() { deliver(receiver, source->data(), payload); });
+  }
+  if (!acknowledged) {
+    stats.unicastFailures++;
+  }
+  at(time, [from, target, acknowledged]() { from->radioSendDone(target.data(), acknowledged); });
+}
+
+}  // namespace sim
@@ -0,0 +1,57 @@
+#ifndef SIM_RADIO_H
+#define SIM_RADIO_H
+
+#include <stdint.h>
+
+// ESP-NOW medium shared by the hub and the simulated nodes.
+//
+// A frame occupies its channel for its airtime at 1 Mbit/s; frames on one
+// channel are sent one after the other. An endpoint hears a frame only when
+// it listens on the sender's channel. Every attempt is lost with the link
+// loss of both ends, so a bad node link hurts its frames in both directions.
+// Unicast frames are acknowledged and retried up to RADIO_UNICAST_ATTEMPTS
+// times; losing only the acknowledgement delivers the frame but reports a
+// failure to the sender, as on the air. Broadcasts go out once and always
+// report success, like esp_now_send() does.
+
+#define RADIO_UNICAST_ATTEMPTS 4
+#define RADIO_RETRY_GAP 300       // µs between a lost attempt and its retry
+#define RADIO_FRAME_OVERHEAD 50   // MAC header, vendor action header and FCS, bytes
+#define RADIO_PREAMBLE 192        // Long preamble, µs
+
+namespace sim {
+
+class RadioEndpoint {
+public:
+  uint8_t mac[6];
+  bool isHub = false;
+
+  virtual ~RadioEndpoint() {}
+  virtual uint8_t radioChannel() const = 0;
+  virtual bool radioListening() const { return true; }
+  virtual double linkLoss() { return 0; }  // Per attempt, right now
+  virtual void radioReceive(const uint8_t *from, const uint8_t *data, int len) = 0;
+  virtual void radioSendDone(const uint8_t *to, bool delivered) = 0;
+};
+
+struct RadioStats {
+  uint64_t framesSent[8];         // By FrameType, each esp_now_send() once
+  uint64_t framesDelivered[8];
+  uint64_t attempts;              // Transmissions on the air, retries included
+  uint64_t unicastFailures;       // Reported as failed to the sender
+  uint64_t airtime;               // µs, all channels
+  uint64_t peakFramesPerSecond;   // Busiest second
+};
+
+extern const uint8_t broadcastAddress[6];
+
+void radioAttach(RadioEndpoint *endpoint);
+void radioSend(RadioEndpoint *from, const uint8_t *to, const uint8_t *data, int len);
+const RadioStats &radioStats();
+
+// Called after each frame handed to a receiver, for the latency probes
+void radioOnDelivery(void (*hook)(RadioEndpoint *receiver, const uint8_t *data, int len));
+
+}  // namespace sim
+
+#endif